@@ -0,0 +1,61 @@
+/** A minimal benchmark harness. Benchmarks register themselves and report the time per processed item and the heap allocations per iteration.
+	Usage: runBenchmarks [filter] [-json <file>], where the JSON file receives the results for comparing between commits.
+	@file bench.h */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stddef.h>
+
+/** Passed to a benchmark to time its inner loop. */
+class BenchState {
+public:
+	/** The number of items processed per iteration, set by the benchmark to get a time per item. */
+	size_t items;
+
+	BenchState(long iterations) : items(1), iterations(iterations), remaining(iterations), started(0), elapsed(0), allocations(0) {}
+
+	/** Returns \c true while iterations remain. The first call starts the clock and the last one stops it,
+		so setup before the loop is not timed. */
+	bool keepRunning();
+
+	/** Returns the number of iterations to run. */
+	long getIterations() const { return iterations; }
+
+	/** Returns the measured time in nanoseconds. */
+	double getElapsed() const { return elapsed; }
+
+	/** Returns the number of heap allocations made while timed, or \c -1 if they cannot be counted on this platform. */
+	long getAllocations() const { return allocations; }
+
+private:
+	long iterations, remaining;
+	double started, elapsed;
+	long allocations;
+};
+
+struct Benchmark {
+	const char *group, *name;
+	void (*function)(BenchState &state);
+	Benchmark *next;
+
+	Benchmark(const char *group, const char *name, void (*function)(BenchState &state));
+};
+
+/** Defines and registers a benchmark. The body must loop <tt>while (state.keepRunning())</tt>. */
+#define BENCHMARK(group, name) \
+	static void bench_##group##_##name(BenchState &state); \
+	static Benchmark bench_##group##_##name##_registration(#group, #name, bench_##group##_##name); \
+	static void bench_##group##_##name(BenchState &state)
+
+/** Keeps the compiler from optimizing away a computed value. */
+template <class T> inline void doNotOptimize(const T &value) {
+#ifdef __GNUC__
+	asm volatile("" : : "r,m"(value) : "memory");
+#else
+	static const void *volatile sink;
+	sink = &value;
+#endif
+}
+
+#endif
@@ -0,0 +1,54 @@
+#include "bench.h"
+#include <atlas.h>
+#include <stdlib.h>
+#include <vector>
+
+// Glyph and icon sized rectangles
+static void makeSizes(std::vector<int> &sizes, int count) {
+	srand(1);
+	for (int i = 0; i < 2 * count; i++) sizes.push_back(8 + rand() % 56);
+}
+
+BENCHMARK(Atlas, Insert4096) {
+	const int count = 4096;
+	std::vector<int> sizes;
+	makeSizes(sizes, count);
+	while (state.keepRunning()) {
+		struct atlas *atlas = create_atlas(2048, 2048, 0, 1);
+		for (int i = 0; i < count; i++) atlas_insert(atlas, sizes[2 * i], sizes[2 * i + 1]);
+		destroy_atlas(atlas);
+	}
+	state.items = count;
+}
+
+BENCHMARK(Atlas, RemoveAndReinsert) {
+	const int count = 4096;
+	std::vector<int> sizes, ids;
+	makeSizes(sizes, count);
+	struct atlas *atlas = create_atlas(2048, 2048, 0, 1);
+	for (int i = 0; i < count; i++) ids.push_back(atlas_insert(atlas, sizes[2 * i], sizes[2 * i + 1]));
+	int next = 0;
+	while (state.keepRunning()) {
+		// Replace a random sprite with one of another size, as streamed-in content would
+		int victim = rand() % count;
+		atlas_remove(atlas, ids[victim]);
+		ids[victim] = atlas_insert(atlas, sizes[next], sizes[next + 1]);
+		next = (next + 2) % (2 * count);
+	}
+	destroy_atlas(atlas);
+}
+
+BENCHMARK(Atlas, Lookup) {
+	const int count = 4096;
+	std::vector<int> sizes;
+	makeSizes(sizes, count);
+	struct atlas *atlas = create_atlas(2048, 2048, 0, 1);
+	for (int i = 0; i < count; i++) atlas_insert(atlas, sizes[2 * i], sizes[2 * i + 1]);
+	float sum = 0;
+	while (state.keepRunning()) {
+		for (int i = 0; i < count; i++) sum += atlas_get(atlas, i)->u0;
+	}
+	state.items = count;
+	if (sum < 0) abort();
+	destroy_atlas(atlas);
+}
@@ -0,0 +1,53 @@
+#include "bench.h"
+#include <bcn.h>
+#include <math.h>
+#include <stdlib.h>
+#include <vector>
+
+// A photo-like 1024x1024 image of smooth gradients and noise
+static std::vector<unsigned char> makeImage(unsigned int size) {
+	std::vector<unsigned char> rgba(size * size * 4);
+	for (unsigned int y = 0; y < size; y++) {
+		for (unsigned int x = 0; x < size; x++) {
+			unsigned char *p = &rgba[4 * (y * size + x)];
+			p[0] = (unsigned char) (x * 255 / size + rand() % 8);
+			p[1] = (unsigned char) (128 + 100 * sin(x * 0.02 + y * 0.01));
+			p[2] = (unsigned char) (y * 255 / size);
+			p[3] = (unsigned char) (255 - (x ^ y) % 64);
+		}
+	}
+	return rgba;
+}
+
+static void encode(BenchState &state, enum bcn_format format, int flags, struct threadpool *pool) {
+	const unsigned int size = 1024;
+	std::vector<unsigned char> rgba = makeImage(size), blocks(size * size);
+	while (state.keepRunning()) bcn_encode(format, &rgba[0], size, size, size * 4, &blocks[0], flags, pool);
+	state.items = size * size / 16; // Blocks
+}
+
+BENCHMARK(BCn, EncodeBC1Fast) {
+	encode(state, BCN_BC1, 0, 0);
+}
+
+BENCHMARK(BCn, EncodeBC1Quality) {
+	encode(state, BCN_BC1, BCN_QUALITY, 0);
+}
+
+BENCHMARK(BCn, EncodeBC3Fast) {
+	encode(state, BCN_BC3, 0, 0);
+}
+
+BENCHMARK(BCn, EncodeBC3FastThreaded) {
+	struct threadpool *pool = create_threadpool(0);
+	encode(state, BCN_BC3, 0, pool);
+	destroy_threadpool(pool);
+}
+
+BENCHMARK(BCn, DecodeBC3) {
+	const unsigned int size = 1024;
+	std::vector<unsigned char> rgba = makeImage(size), blocks(size * size);
+	bcn_encode(BCN_BC3, &rgba[0], size, size, size * 4, &blocks[0], 0, 0);
+	while (state.keepRunning()) bcn_decode(BCN_BC3, &blocks[0], size, size, &rgba[0], size * 4, 0);
+	state.items = size * size / 16;
+}
@@ -0,0 +1,199 @@
+#include "bench.h"
+#include <bmfont.h>
+#include <textlayout.h>
+#include <sdf.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+static void put(std::vector<char> &data, uint32_t value, int bytes) {
+	for (int i = 0; i < bytes; i++) data.push_back((char) (value >> 8 * i));
+}
+
+// Builds a binary BMFont file of printable ASCII with kerning between all letters
+static std::vector<char> makeFont() {
+	std::vector<char> data(4);
+	memcpy(&data[0], "BMF\003", 4);
+	data.push_back(2);
+	put(data, 15, 4);
+	put(data, 20, 2);
+	put(data, 16, 2);
+	put(data, 256, 2);
+	put(data, 256, 2);
+	put(data, 1, 2);
+	put(data, 0, 5);
+	data.push_back(3);
+	put(data, 7, 4);
+	data.insert(data.end(), "p0.dds", "p0.dds" + 7);
+
+	data.push_back(4);
+	put(data, 20 * 95, 4);
+	for (uint32_t c = 32; c < 127; c++) {
+		put(data, c, 4);
+		put(data, (c - 32) % 16 * 16, 2);
+		put(data, (c - 32) / 16 * 16, 2);
+		put(data, 8 + c % 5, 2);
+		put(data, 14, 2);
+		put(data, 0, 2);
+		put(data, 2, 2);
+		put(data, 9 + c % 5, 2);
+		data.push_back(0);
+		data.push_back(15);
+	}
+
+	std::string letters = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+	data.push_back(5);
+	put(data, 10 * letters.size() * letters.size() / 4, 4);
+	for (size_t a = 0; a < letters.size(); a++) {
+		for (size_t b = 0; b < letters.size(); b++) {
+			if ((a + b) % 4 != 0) continue;
+			put(data, letters[a], 4);
+			put(data, letters[b], 4);
+			put(data, (uint32_t) -1, 2);
+		}
+	}
+	data.push_back(0);
+	return data;
+}
+
+static const char *TEXT = "The quick brown fox jumps over the lazy dog. AVATAR Wavy Type, LT Kerning: To Yo We. ";
+
+BENCHMARK(BMFont, Parse) {
+	std::vector<char> data = makeFont();
+	while (state.keepRunning()) destroy_bmfont(create_bmfont(&data[0]));
+}
+
+BENCHMARK(BMFont, OpenBaked) {
+	std::vector<char> data = makeFont();
+	struct bmfont *font = create_bmfont(&data[0]), opened;
+	size_t size;
+	char *baked = bmfont_bake(font, &size);
+	while (state.keepRunning()) bmfont_open_baked(baked, size, &opened);
+	free(baked);
+	destroy_bmfont(font);
+}
+
+BENCHMARK(BMFont, DistanceFieldPage) {
+	// Glyph-like strokes on a 1024x1024 page, shrunk to 256x256
+	const unsigned int size = 1024;
+	std::vector<unsigned char> page(size * size), field(size / 4 * (size / 4));
+	for (unsigned int y = 0; y < size; y++) {
+		for (unsigned int x = 0; x < size; x++) page[y * size + x] = (x % 64 < 12 || (y + x / 3) % 64 < 10) && y % 64 > 6 ? 255 : 0;
+	}
+	struct threadpool *pool = create_threadpool(0);
+	while (state.keepRunning()) sdf_generate(&page[0], size, size, size, 4, 32, &field[0], pool);
+	destroy_threadpool(pool);
+	state.items = size * size;
+}
+
+BENCHMARK(BMFont, GlyphLookup) {
+	// Mostly hits, with misses in and beyond the blocks of the font
+	std::vector<char> data = makeFont();
+	struct bmfont *font = create_bmfont(&data[0]);
+	std::vector<unsigned int> codepoints(4096);
+	srand(1);
+	for (size_t i = 0; i < codepoints.size(); i++) codepoints[i] = rand() % 8 != 0 ? 32 + rand() % 95 : rand() % 0x20000;
+	unsigned int found = 0;
+	while (state.keepRunning()) {
+		for (size_t i = 0; i < codepoints.size(); i++) found += bmfont_get_glyph(font, codepoints[i]) != 0;
+	}
+	doNotOptimize(found);
+	state.items = codepoints.size();
+	destroy_bmfont(font);
+}
+
+BENCHMARK(BMFont, MeasureText) {
+	std::vector<char> data = makeFont();
+	struct bmfont *font = create_bmfont(&data[0]);
+	std::string text;
+	while (text.size() < 4096) text += TEXT;
+	int width = 0;
+	while (state.keepRunning()) {
+		unsigned int previous = 0;
+		for (size_t i = 0; i < text.size(); i++) {
+			unsigned int index = bmfont_get_index(font, (unsigned char) text[i]);
+			width += font->glyphs[index].xadvance + bmfont_get_index_kerning(font, previous, index);
+			previous = index;
+		}
+	}
+	state.items = text.size(); // Characters
+	if (width == 0) abort();
+	destroy_bmfont(font);
+}
+
+BENCHMARK(BMFont, LayoutChatLog) {
+	std::vector<char> data = makeFont();
+	struct bmfont *font = create_bmfont(&data[0]);
+	std::string text;
+	for (int line = 0; text.size() < 65536; line++) {
+		text += TEXT;
+		if (line % 8 == 0) text += "na\xC3\xAFve caf\xC3\xA9 \xE2\x80\x94 ";
+		text += '\n';
+	}
+	struct text_quads *quads = create_text_quads((unsigned int) text.size());
+	while (state.keepRunning()) {
+		float x = 0, y = 0;
+		quads->count = 0;
+		bmfont_layout(font, text.data(), text.size(), &x, &y, quads);
+	}
+	state.items = quads->count; // Glyphs
+	destroy_text_quads(quads);
+	destroy_bmfont(font);
+}
+
+// A chat log of 100k messages of varying length
+static struct text_document *makeLog(struct bmfont *font, float width, unsigned int messages) {
+	struct text_document *document = create_text_document(font, width);
+	size_t length = strlen(TEXT);
+	for (unsigned int i = 0; i < messages; i++) text_document_append(document, TEXT, 20 + i * 7 % (length - 20));
+	return document;
+}
+
+BENCHMARK(TextLayout, AppendChatLog) {
+	std::vector<char> data = makeFont();
+	struct bmfont *font = create_bmfont(&data[0]);
+	while (state.keepRunning()) destroy_text_document(makeLog(font, 300, 100000));
+	state.items = 100000; // Messages
+	destroy_bmfont(font);
+}
+
+BENCHMARK(TextLayout, ResizeChatLog) {
+	std::vector<char> data = makeFont();
+	struct bmfont *font = create_bmfont(&data[0]);
+	struct text_document *document = makeLog(font, 300, 100000);
+	float width = 300;
+	while (state.keepRunning()) text_document_set_width(document, width = width == 300 ? 301 : 300);
+	state.items = 100000;
+	destroy_text_document(document);
+	destroy_bmfont(font);
+}
+
+BENCHMARK(TextLayout, RewrapChatLog) {
+	std::vector<char> data = makeFont();
+	struct bmfont *font = create_bmfont(&data[0]);
+	struct text_document *document = makeLog(font, 300, 100000);
+	float width = 300;
+	while (state.keepRunning()) text_document_set_width(document, width = width == 300 ? 200 : 300);
+	state.items = 100000;
+	destroy_text_document(document);
+	destroy_bmfont(font);
+}
+
+BENCHMARK(TextLayout, LineAt) {
+	std::vector<char> data = makeFont();
+	struct bmfont *font = create_bmfont(&data[0]);
+	struct text_document *document = makeLog(font, 300, 100000);
+	float height = (float) text_document_lines(document) * font->lineHeight, y = 0;
+	unsigned int paragraph, line, sum = 0;
+	while (state.keepRunning()) {
+		y += 7919.5f;
+		if (y >= height) y -= height;
+		text_document_line_at(document, y, &paragraph, &line);
+		sum += paragraph;
+	}
+	if (sum == 1) abort();
+	destroy_text_document(document);
+	destroy_bmfont(font);
+}
@@ -0,0 +1,49 @@
+#include "bench.h"
+#include <bitmap_dds.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <vector>
+
+static void put32(std::vector<char> &data, size_t offset, uint32_t value) {
+	memcpy(&data[offset], &value, sizeof value);
+}
+
+// Builds a compressed DDS file with a full mipmap chain of random blocks
+static std::vector<char> makeDDS(uint32_t size, const char *fourCC, int blockSize) {
+	uint32_t levels = 0;
+	size_t dataSize = 0;
+	for (uint32_t s = size; s > 0; s /= 2, levels++) dataSize += ((s + 3) / 4) * ((s + 3) / 4) * blockSize;
+	std::vector<char> data(4 + 124 + dataSize);
+	memcpy(&data[0], "DDS ", 4);
+	put32(data, 4, 124);
+	put32(data, 8, 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000);
+	put32(data, 12, size);
+	put32(data, 16, size);
+	put32(data, 28, levels);
+	put32(data, 76, 32);
+	put32(data, 80, 0x4);
+	memcpy(&data[84], fourCC, 4);
+	for (size_t i = 128; i < data.size(); i++) data[i] = (char) rand();
+	return data;
+}
+
+static void flipAtlas(BenchState &state, const char *fourCC, int blockSize) {
+	std::vector<char> data = makeDDS(4096, fourCC, blockSize);
+	struct dds_image image;
+	dds_parse(&data[0], data.size(), &image);
+	while (state.keepRunning()) dds_flip(&image, &data[0]);
+	state.items = data.size() - 128; // Bytes
+}
+
+BENCHMARK(DDS, FlipDXT1Atlas4K) {
+	flipAtlas(state, "DXT1", 8);
+}
+
+BENCHMARK(DDS, FlipDXT3Atlas4K) {
+	flipAtlas(state, "DXT3", 16);
+}
+
+BENCHMARK(DDS, FlipDXT5Atlas4K) {
+	flipAtlas(state, "DXT5", 16);
+}
@@ -0,0 +1,184 @@
+#include "bench.h"
+#include <gridlayout.h>
+#include <stdlib.h>
+#include <vector>
+
+/** A widget with fixed intrinsic sizes. */
+struct box {
+	struct widget widget;
+	float minWidth, maxWidth, minHeight, maxHeight;
+};
+
+static float boxMinWidth(struct widget *widget) { return ((struct box *) widget)->minWidth; }
+static float boxMaxWidth(struct widget *widget) { return ((struct box *) widget)->maxWidth; }
+static float boxMinHeight(struct widget *widget) { return ((struct box *) widget)->minHeight; }
+static float boxMaxHeight(struct widget *widget) { return ((struct box *) widget)->maxHeight; }
+
+/** Returns a random track: fixed, intrinsic or flexible in the given percentages. */
+static struct size makeTrack(int intrinsicPercent, int flexPercent) {
+	int kind = rand() % 100;
+	struct size size = AUTO;
+	if (kind < intrinsicPercent) {
+		if (rand() % 2 == 0) size.max = 40.0f + rand() % 60;
+	}
+	else if (kind < intrinsicPercent + flexPercent) {
+		size.min = (float) (rand() % 20);
+		size.max = FLEX(0.1f * (1 + rand() % 10));
+	}
+	else size.min = size.max = 20.0f + rand() % 80;
+	return size;
+}
+
+/** A grid of random tracks filled row by row with items of random spans. */
+struct SyntheticGrid {
+	std::vector<struct size> columns, rows;
+	std::vector<struct box> boxes;
+	std::vector<struct item> items;
+	struct gridlayout grid;
+
+	SyntheticGrid(int columnCount, int rowCount, int maxSpan, int intrinsicPercent, int flexPercent) {
+		srand(1);
+		for (int i = 0; i < columnCount; i++) columns.push_back(makeTrack(intrinsicPercent, flexPercent));
+		for (int i = 0; i < rowCount; i++) rows.push_back(makeTrack(intrinsicPercent, flexPercent));
+		for (int row = 0; row < rowCount; row++) {
+			for (int column = 0; column < columnCount;) {
+				int colspan = 1 + rand() % maxSpan, rowspan = rand() % 8 == 0 ? 1 + rand() % maxSpan : 1;
+				struct box box = { { 0 }, 10.0f + rand() % 50, 0, 10.0f + rand() % 20, 0 };
+				box.maxWidth = box.minWidth + rand() % 100;
+				box.maxHeight = box.minHeight + rand() % 20;
+				boxes.push_back(box);
+				struct item item = { column, row, colspan, rowspan, 1 << rand() % 5, 1, 1, 0 };
+				items.push_back(item);
+				column += colspan;
+			}
+		}
+		for (size_t i = 0; i < items.size(); i++) items[i].widget = &boxes[i].widget;
+		struct gridlayout zero = {};
+		grid = zero;
+		grid.columns = columnCount;
+		grid.rows = rowCount;
+		grid.templateColumns = &columns[0];
+		grid.templateRows = &rows[0];
+		grid.items = &items[0];
+		grid.itemCount = (int) items.size();
+		grid.minWidth = boxMinWidth;
+		grid.maxWidth = boxMaxWidth;
+		grid.minHeight = boxMinHeight;
+		grid.maxHeight = boxMaxHeight;
+	}
+
+	~SyntheticGrid() {
+		freeGridLayout(&grid);
+	}
+};
+
+/** Lays out a grid from scratch every iteration, measuring every item. */
+static void coldLayout(BenchState &state, int columns, int rows, int maxSpan) {
+	SyntheticGrid synthetic(columns, rows, maxSpan, 30, 20);
+	while (state.keepRunning()) {
+		freeGridLayout(&synthetic.grid);
+		layoutGrid(&synthetic.grid, 0, 0, 1920, 1080);
+	}
+	state.items = synthetic.items.size();
+}
+
+BENCHMARK(Grid, ColdLayout100) {
+	coldLayout(state, 10, 10, 1);
+}
+
+BENCHMARK(Grid, ColdLayout10k) {
+	coldLayout(state, 20, 500, 1);
+}
+
+BENCHMARK(Grid, ColdLayout100k) {
+	coldLayout(state, 20, 5000, 1);
+}
+
+BENCHMARK(Grid, ColdLayoutSpans10k) {
+	coldLayout(state, 40, 500, 4);
+}
+
+BENCHMARK(Grid, ColdLayoutInArena1k) {
+	SyntheticGrid synthetic(20, 50, 2, 30, 20);
+	std::vector<double> arena(gridLayoutSize(&synthetic.grid) / sizeof(double) + 1);
+	while (state.keepRunning()) {
+		initGridLayout(&synthetic.grid, &arena[0], arena.size() * sizeof(double));
+		layoutGrid(&synthetic.grid, 0, 0, 1920, 1080);
+	}
+	state.items = synthetic.items.size();
+}
+
+BENCHMARK(Grid, Resize10k) {
+	SyntheticGrid synthetic(20, 500, 2, 30, 20);
+	int i = 0;
+	while (state.keepRunning()) layoutGrid(&synthetic.grid, 0, 0, 1600.0f + i++ % 320, 1080);
+	state.items = synthetic.items.size();
+}
+
+BENCHMARK(Grid, RemeasureOnePercent10k) {
+	SyntheticGrid synthetic(20, 500, 2, 30, 20);
+	int next = 0;
+	while (state.keepRunning()) {
+		for (int i = 0; i < synthetic.grid.itemCount / 100; i++) {
+			next = (next + 7919) % synthetic.grid.itemCount;
+			synthetic.boxes[next].minWidth += 1;
+			invalidateGridItem(&synthetic.grid, next);
+		}
+		layoutGrid(&synthetic.grid, 0, 0, 1920, 1080);
+	}
+	state.items = synthetic.items.size();
+}
+
+BENCHMARK(Grid, NestedTreeResize) {
+	// An editor of 64 panels in a grid, each a grid of 160 widgets
+	const int panelCount = 64;
+	std::vector<SyntheticGrid *> panels;
+	std::vector<struct box> panelBoxes(panelCount);
+	std::vector<struct item> panelItems(panelCount);
+	for (int i = 0; i < panelCount; i++) {
+		panels.push_back(new SyntheticGrid(8, 20, 2, 40, 20));
+		struct item item = { i % 8, i / 8, 1, 1, 0, 1, 1, &panelBoxes[i].widget, &panels[i]->grid };
+		panelItems[i] = item;
+	}
+	struct size tracks[8];
+	for (int i = 0; i < 8; i++) tracks[i].min = 0, tracks[i].max = FLEX(1);
+	struct gridlayout root = {};
+	root.columns = root.rows = 8;
+	root.templateColumns = root.templateRows = tracks;
+	root.items = &panelItems[0];
+	root.itemCount = panelCount;
+	struct threadpool *pool = create_threadpool(0);
+	int i = 0;
+	while (state.keepRunning()) layoutGridTree(&root, 0, 0, 3840.0f + i++ % 200, 2160, pool);
+	destroy_threadpool(pool);
+	state.items = 0;
+	for (int i = 0; i < panelCount; i++) {
+		state.items += panels[i]->items.size();
+		delete panels[i];
+	}
+	freeGridLayout(&root);
+}
+
+/** Binds nothing, as the rows of the table share the same widgets. */
+static void bindRow(struct virtualgrid *grid, int row) {
+	(void) grid;
+	(void) row;
+}
+
+BENCHMARK(Grid, VirtualScrollMillionRows) {
+	SyntheticGrid synthetic(8, 1, 1, 0, 50);
+	struct virtualgrid table = {};
+	table.row = &synthetic.grid;
+	table.bindRow = bindRow;
+	table.rowHeight = 20;
+	setVirtualGridRows(&table, 1000000);
+	for (int row = 0; row < 1000000; row += 97) setVirtualGridRowHeight(&table, row, 35);
+	double scroll = 0;
+	int rows = 0;
+	while (state.keepRunning()) {
+		rows = layoutVirtualGrid(&table, 0, 0, 1920, 1080, scroll);
+		scroll = scroll < 1.9e7 ? scroll + 12345.5 : 0;
+	}
+	state.items = rows;
+	freeVirtualGrid(&table);
+}
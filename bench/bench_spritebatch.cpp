@@ -0,0 +1,61 @@
+#include "bench.h"
+#include <spritebatch.h>
+#include <stdlib.h>
+#include <vector>
+
+static const unsigned int SPRITES = 100000;
+
+/** The sprites of a frame spread over 4 programs, 64 textures and 16 depths, in random order. */
+struct SyntheticFrame {
+	std::vector<struct sprite_instance> sprites;
+	std::vector<GLuint> programs, textures;
+	std::vector<unsigned short> depths;
+
+	SyntheticFrame() : sprites(SPRITES), programs(SPRITES), textures(SPRITES), depths(SPRITES) {
+		srand(1);
+		for (unsigned int i = 0; i < SPRITES; i++) {
+			struct sprite_instance sprite = { (float) (rand() % 1920), (float) (rand() % 1080), 32, 32, 0, 0, 65535, 65535, { 255, 255, 255, 255 } };
+			sprites[i] = sprite;
+			programs[i] = 1 + rand() % 4;
+			textures[i] = 1 + rand() % 64;
+			depths[i] = (unsigned short) (rand() % 16);
+		}
+	}
+
+	void add(struct sprite_batch *batch) {
+		for (unsigned int i = 0; i < SPRITES; i++) sprite_batch_add(batch, programs[i], textures[i], depths[i], &sprites[i]);
+	}
+};
+
+// The CPU time per sprite of a frame: adding, sorting and writing the records
+BENCHMARK(SpriteBatch, Frame100k) {
+	SyntheticFrame frame;
+	struct sprite_batch *batch = create_sprite_batch(SPRITES);
+	std::vector<struct sprite_instance> instances(SPRITES);
+	state.items = SPRITES;
+	while (state.keepRunning()) {
+		frame.add(batch);
+		doNotOptimize(sprite_batch_prepare(batch, &instances[0]));
+		sprite_batch_clear(batch);
+	}
+	destroy_sprite_batch(batch);
+}
+
+// Sprites added already sorted, as by a scene kept in drawing order, where the sort finds runs of one texture
+BENCHMARK(SpriteBatch, SortedFrame100k) {
+	SyntheticFrame frame;
+	struct sprite_batch *batch = create_sprite_batch(SPRITES);
+	std::vector<struct sprite_instance> instances(SPRITES);
+	for (unsigned int i = 0; i < SPRITES; i++) {
+		frame.programs[i] = 1;
+		frame.textures[i] = 1 + i / 1000;
+		frame.depths[i] = 0;
+	}
+	state.items = SPRITES;
+	while (state.keepRunning()) {
+		frame.add(batch);
+		doNotOptimize(sprite_batch_prepare(batch, &instances[0]));
+		sprite_batch_clear(batch);
+	}
+	destroy_sprite_batch(batch);
+}
@@ -0,0 +1,111 @@
+#include "bench.h"
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <atomic>
+
+#ifdef __GLIBC__
+/* Count the allocations of the C and C++ code alike by replacing malloc, forwarding to the glibc functions.
+	operator new calls malloc in libstdc++. */
+extern "C" {
+	void *__libc_malloc(size_t size);
+	void *__libc_calloc(size_t count, size_t size);
+	void *__libc_realloc(void *pointer, size_t size);
+}
+
+static std::atomic<long> allocationCount(0);
+
+extern "C" void *malloc(size_t size) {
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+	return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size) {
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+	return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *pointer, size_t size) {
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+	return __libc_realloc(pointer, size);
+}
+
+static long countAllocations() {
+	return allocationCount.load(std::memory_order_relaxed);
+}
+#else
+static long countAllocations() {
+	return -1;
+}
+#endif
+
+/** The minimum time to run each benchmark for, in nanoseconds. */
+#define MIN_TIME 2e8
+
+static Benchmark *benchmarks = 0;
+
+static double now() {
+	return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool BenchState::keepRunning() {
+	if (remaining == iterations) {
+		allocations = countAllocations();
+		started = now();
+	}
+	if (remaining-- > 0) return true;
+	elapsed = now() - started;
+	long count = countAllocations();
+	allocations = count >= 0 ? count - allocations : -1;
+	return false;
+}
+
+Benchmark::Benchmark(const char *group, const char *name, void (*function)(BenchState &state)) : group(group), name(name), function(function) {
+	// Keep registration order
+	Benchmark **tail = &benchmarks;
+	while (*tail != 0) tail = &(*tail)->next;
+	*tail = this;
+	next = 0;
+}
+
+int main(int argc, char **argv) {
+	const char *filter = "", *jsonPath = 0;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-json") == 0 && i + 1 < argc) jsonPath = argv[++i];
+		else filter = argv[i];
+	}
+	FILE *json = 0;
+	if (jsonPath != 0 && (json = fopen(jsonPath, "w")) == 0) {
+		fprintf(stderr, "%s: cannot write file\n", jsonPath);
+		return 1;
+	}
+	if (json != 0) fprintf(json, "[");
+
+	printf("%-40s %12s %14s %12s %12s\n", "Benchmark", "Iterations", "ns/iteration", "ns/item", "allocs/iter");
+	int results = 0;
+	for (Benchmark *benchmark = benchmarks; benchmark != 0; benchmark = benchmark->next) {
+		char name[128];
+		snprintf(name, sizeof name, "%s.%s", benchmark->group, benchmark->name);
+		if (strstr(name, filter) == 0) continue;
+
+		// Grow the iteration count until the run is long enough to trust
+		for (long iterations = 1;; iterations *= 10) {
+			BenchState state(iterations);
+			benchmark->function(state);
+			if (state.getElapsed() < MIN_TIME && iterations < 1000000000) continue;
+			double perIteration = state.getElapsed() / iterations,
+				allocations = state.getAllocations() >= 0 ? (double) state.getAllocations() / iterations : -1;
+			printf("%-40s %12ld %14.1f %12.3f %12.2f\n", name, iterations, perIteration, perIteration / state.items, allocations);
+			if (json != 0) {
+				fprintf(json, "%s\n\t{ \"name\": \"%s\", \"iterations\": %ld, \"nsPerIteration\": %.1f, \"nsPerItem\": %.3f, \"items\": %lu, \"allocationsPerIteration\": %.2f }",
+					results++ > 0 ? "," : "", name, iterations, perIteration, perIteration / state.items, (unsigned long) state.items, allocations);
+			}
+			break;
+		}
+	}
+	if (json != 0) {
+		fprintf(json, "\n]\n");
+		fclose(json);
+	}
+	return 0;
+}
@@ -40,6 +40,14 @@ IF(CMAKE_SYSTEM_NAME MATCHES "Linux")
    ELSE (SSE41_TRUE)
       set(SSE4_1_FOUND false CACHE BOOL "SSE4.1 available on host")
    ENDIF (SSE41_TRUE)
+
+   STRING(REGEX REPLACE "^.*(avx2).*$" "\\1" SSE_THERE ${CPUINFO})
+   STRING(COMPARE EQUAL "avx2" "${SSE_THERE}" AVX2_TRUE)
+   IF (AVX2_TRUE)
+      set(AVX2_FOUND true CACHE BOOL "AVX2 available on host")
+   ELSE (AVX2_TRUE)
+      set(AVX2_FOUND false CACHE BOOL "AVX2 available on host")
+   ENDIF (AVX2_TRUE)
 ELSEIF(CMAKE_SYSTEM_NAME MATCHES "Darwin")
    EXEC_PROGRAM("/usr/sbin/sysctl -n machdep.cpu.features" OUTPUT_VARIABLE
       CPUINFO)
@@ -75,17 +83,30 @@ ELSEIF(CMAKE_SYSTEM_NAME MATCHES "Darwin")
    ELSE (SSE41_TRUE)
       set(SSE4_1_FOUND false CACHE BOOL "SSE4.1 available on host")
    ENDIF (SSE41_TRUE)
+
+   EXEC_PROGRAM("/usr/sbin/sysctl -n machdep.cpu.leaf7_features" OUTPUT_VARIABLE
+      CPUINFO)
+
+   STRING(REGEX REPLACE "^.*(AVX2).*$" "\\1" SSE_THERE ${CPUINFO})
+   STRING(COMPARE EQUAL "AVX2" "${SSE_THERE}" AVX2_TRUE)
+   IF (AVX2_TRUE)
+      set(AVX2_FOUND true CACHE BOOL "AVX2 available on host")
+   ELSE (AVX2_TRUE)
+      set(AVX2_FOUND false CACHE BOOL "AVX2 available on host")
+   ENDIF (AVX2_TRUE)
 ELSEIF(CMAKE_SYSTEM_NAME MATCHES "Windows")
    # TODO
    set(SSE2_FOUND   true  CACHE BOOL "SSE2 available on host")
    set(SSE3_FOUND   false CACHE BOOL "SSE3 available on host")
    set(SSSE3_FOUND  false CACHE BOOL "SSSE3 available on host")
    set(SSE4_1_FOUND false CACHE BOOL "SSE4.1 available on host")
+   set(AVX2_FOUND   false CACHE BOOL "AVX2 available on host")
 ELSE(CMAKE_SYSTEM_NAME MATCHES "Linux")
    set(SSE2_FOUND   true  CACHE BOOL "SSE2 available on host")
    set(SSE3_FOUND   false CACHE BOOL "SSE3 available on host")
    set(SSSE3_FOUND  false CACHE BOOL "SSSE3 available on host")
    set(SSE4_1_FOUND false CACHE BOOL "SSE4.1 available on host")
+   set(AVX2_FOUND   false CACHE BOOL "AVX2 available on host")
 ENDIF(CMAKE_SYSTEM_NAME MATCHES "Linux")
 
 if(NOT SSE2_FOUND)
@@ -100,5 +121,8 @@ endif(NOT SSSE3_FOUND)
 if(NOT SSE4_1_FOUND)
       MESSAGE(STATUS "Could not find hardware support for SSE4.1 on this machine.")
 endif(NOT SSE4_1_FOUND)
+if(NOT AVX2_FOUND)
+      MESSAGE(STATUS "Could not find hardware support for AVX2 on this machine.")
+endif(NOT AVX2_FOUND)
 
-mark_as_advanced(SSE2_FOUND SSE3_FOUND SSSE3_FOUND SSE4_1_FOUND)
\ No newline at end of file
+mark_as_advanced(SSE2_FOUND SSE3_FOUND SSSE3_FOUND SSE4_1_FOUND AVX2_FOUND)
\ No newline at end of file
@@ -0,0 +1,94 @@
+/** Packs many small images into large texture atlas pages at runtime.
+	Sprites are placed with a skyline packer, and the rectangles of removed sprites are reused by later insertions, so that the atlas never needs repacking.
+	@file atlas.h */
+
+#ifndef ATLAS_H
+#define ATLAS_H
+
+#include <stddef.h>
+#include <GL/glew.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	/** The placement of a sprite within the atlas. */
+	struct atlas_sprite {
+		int page, /**< The index of the atlas page, or \c -1 if the id is unused. */
+			x, /**< The left edge of the sprite on the page in pixels. */
+			y, /**< The bottom edge of the sprite on the page in pixels. */
+			width, /**< The width of the sprite in pixels. */
+			height; /**< The height of the sprite in pixels. */
+		float u0, /**< The texture coordinate of the left edge. */
+			v0, /**< The texture coordinate of the bottom edge. */
+			u1, /**< The texture coordinate of the right edge. */
+			v1; /**< The texture coordinate of the top edge. */
+	};
+
+	struct atlas;
+
+	/** Returns a new, empty atlas.
+		Pages are added as they fill up. If \a internalformat is a compressed format, sprites are aligned to 4x4 blocks.
+		@param pageWidth The width of every page in pixels
+		@param pageHeight The height of every page in pixels
+		@param internalformat The internal format of the page textures, or \c 0 to only pack rectangles without creating textures
+		@param padding The number of pixels to leave around every sprite, to keep filtering from bleeding between them
+		@return A new atlas, or \c 0 on failure */
+	struct atlas *create_atlas(int pageWidth, int pageHeight, GLenum internalformat, int padding);
+
+	/** Deletes the atlas and its page textures.
+		@param atlas The atlas to free */
+	void destroy_atlas(struct atlas *atlas);
+
+	/** Reserves room for a sprite.
+		@param atlas The atlas
+		@param width The width of the sprite in pixels
+		@param height The height of the sprite in pixels
+		@return The id of the sprite, or \c -1 if it is larger than a page */
+	int atlas_insert(struct atlas *atlas, int width, int height);
+
+	/** Reserves room for a sprite and copies uncompressed pixels into it.
+		Must be called on the thread owning the OpenGL context.
+		@param atlas The atlas, with an uncompressed internal format
+		@param width The width of the image in pixels
+		@param height The height of the image in pixels
+		@param format The pixel transfer format, e.g. \c GL_RGBA
+		@param type The pixel transfer type, e.g. \c GL_UNSIGNED_BYTE
+		@param pixels The pixels, bottom row first
+		@return The id of the sprite, or \c -1 on failure */
+	int atlas_add_image(struct atlas *atlas, int width, int height, GLenum format, GLenum type, const void *pixels);
+
+	/** Reserves room for the top level of a 2D DDS image and copies it into the atlas.
+		Compressed blocks are copied as-is into an atlas of the same format, and are decompressed into an uncompressed atlas.
+		Must be called on the thread owning the OpenGL context.
+		@param atlas The atlas
+		@param data The contents of the DDS file
+		@param size The size of the file in bytes
+		@param flags The DDS loading flags, e.g. ::DDS_FLIP_UVS
+		@return The id of the sprite, or \c -1 on failure */
+	int atlas_add_dds(struct atlas *atlas, const char *data, size_t size, int flags);
+
+	/** Frees the room of a sprite for later insertions. The id may be handed out again.
+		@param atlas The atlas
+		@param id The id of the sprite
+		@return \c 1 on success, or \c 0 if the id is unused or out of memory, in which case the sprite is kept */
+	int atlas_remove(struct atlas *atlas, int id);
+
+	/** Returns the placement of a sprite.
+		The pointer is invalidated by the next insertion.
+		@param atlas The atlas
+		@param id The id of the sprite
+		@return The placement, whose page is \c -1 if the id is not in use */
+	const struct atlas_sprite *atlas_get(const struct atlas *atlas, int id);
+
+	/** Returns the number of pages in the atlas. */
+	int atlas_page_count(const struct atlas *atlas);
+
+	/** Returns the texture of a page, or \c 0 if the atlas has no textures. */
+	GLuint atlas_page_texture(const struct atlas *atlas, int page);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
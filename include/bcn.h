@@ -0,0 +1,72 @@
+/** Software codec for BC1-BC5 (DXT1-DXT5, RGTC) block compressed images.
+	The decoder is used when the driver lacks the compressed format and for tooling, such as thumbnailing and validation.
+	The encoder is meant for offline texture builds.
+	@file bcn.h */
+
+#ifndef BCN_H
+#define BCN_H
+
+#include <stddef.h>
+#include "threadpool.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	enum bcn_format {
+		BCN_BC1, /**< DXT1, RGB with 1-bit alpha. */
+		BCN_BC2, /**< DXT3, RGB with explicit 4-bit alpha. */
+		BCN_BC3, /**< DXT5, RGB with interpolated alpha. */
+		BCN_BC4, /**< RGTC1, a single unsigned channel. */
+		BCN_BC5 /**< RGTC2, two unsigned channels. */
+	};
+
+	enum {
+		BCN_QUALITY = 1 /**< Fits the endpoints along the principal axis of the colors and refines them by least squares, instead of using the bounding box. */
+	};
+
+	/** Returns the size in bytes of a 4x4 block of the format. */
+	int bcn_block_size(enum bcn_format format);
+
+	/** Decodes a single 4x4 block into RGBA8 pixels.
+		Missing channels decode as \c 0, and alpha as \c 255.
+		@param format The format of the block
+		@param block The compressed block
+		@param rgba Receives the 16 pixels, row by row */
+	void bcn_decode_block(enum bcn_format format, const unsigned char *block, unsigned char rgba[64]);
+
+	/** Decodes an image into RGBA8 pixels, spreading the block rows across a thread pool.
+		@param format The format of the image
+		@param blocks The compressed blocks, row by row
+		@param width The width of the image in pixels
+		@param height The height of the image in pixels
+		@param rgba Receives the first row of pixels
+		@param stride The number of bytes between consecutive rows of \a rgba, negative to flip the image
+		@param pool The thread pool, or \c 0 to decode on the calling thread */
+	void bcn_decode(enum bcn_format format, const void *blocks, unsigned int width, unsigned int height, unsigned char *rgba, ptrdiff_t stride, struct threadpool *pool);
+
+	/** Encodes a single 4x4 block of RGBA8 pixels.
+		Only the channels stored by the format are read. BC1 makes pixels with alpha below one half transparent.
+		@param format The format of the block
+		@param rgba The 16 pixels, row by row
+		@param block Receives the compressed block
+		@param flags The encoding flags, e.g. ::BCN_QUALITY */
+	void bcn_encode_block(enum bcn_format format, const unsigned char rgba[64], unsigned char *block, int flags);
+
+	/** Encodes an image of RGBA8 pixels, spreading the block rows across a thread pool.
+		Partial blocks at the edges repeat the last row and column.
+		@param format The format to encode to
+		@param rgba The first row of pixels
+		@param width The width of the image in pixels
+		@param height The height of the image in pixels
+		@param stride The number of bytes between consecutive rows of \a rgba
+		@param blocks Receives the compressed blocks, row by row
+		@param flags The encoding flags, e.g. ::BCN_QUALITY
+		@param pool The thread pool, or \c 0 to encode on the calling thread */
+	void bcn_encode(enum bcn_format format, const unsigned char *rgba, unsigned int width, unsigned int height, ptrdiff_t stride, void *blocks, int flags, struct threadpool *pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -6,19 +6,158 @@
 
 #include <stddef.h>
 #include <GL/glew.h>
+#include "threadpool.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+	/** The maximum number of mipmap levels of a DDS image. */
+#define DDS_MAX_LEVELS 16
+
+	/** Returns the offset of the mipmap level \a mip of the face \a face from the start of the DDS file.
+		In arrays, the faces of the layer \c layer are numbered from <tt>layer * faces</tt>.
+		@def DDS_OFFSET(image, face, mip) */
+#define DDS_OFFSET(image, face, mip) ((image)->mipmaps[mip].offset + (size_t) (face) * (image)->faceSize)
+
+	/** Mipmap levels no larger than this form the mip tail, see ::dds_tail_level. */
+#define DDS_TAIL_SIZE 64
+
 	enum {
-		DDS_FLIP_UVS = 1 /**< Flips all UV coordinates along the y-axis. */
+		DDS_FLIP_UVS = 1, /**< Flips all UV coordinates along the y-axis. */
+		DDS_MIPMAPS = 2, /**< Generates the full mipmap chain when encoding. */
+		DDS_HIGH_QUALITY = 4 /**< Encodes slowly for the best quality, see ::BCN_QUALITY. */
 	};
 
+	/** A single mipmap level of a DDS image. */
+	struct dds_mipmap {
+		size_t offset, /**< The offset of the first face's level from the start of the file. */
+			size; /**< The size of the level in bytes. */
+		unsigned int width, /**< The width of the level in pixels. */
+			height, /**< The height of the level in pixels. */
+			depth; /**< The depth of the level in pixels. */
+	};
+
+	/** The layout of a DDS file, as described by its header. */
+	struct dds_image {
+		GLenum target, /**< The texture target, e.g. \c GL_TEXTURE_2D, \c GL_TEXTURE_CUBE_MAP or \c GL_TEXTURE_2D_ARRAY. */
+			internalformat, /**< The internal format of the texture. */
+			format, /**< The pixel transfer format of uncompressed data. */
+			type; /**< The pixel transfer type of uncompressed data. */
+		int compressed, /**< Non-zero if the pixel data is block compressed. */
+			bitsPerPixel, /**< The number of bits per pixel of uncompressed data. */
+			blockSize; /**< The size in bytes of a 4x4 block of compressed data. */
+		unsigned int width, /**< The width of the top level in pixels. */
+			height, /**< The height of the top level in pixels. */
+			depth, /**< The depth of the top level in pixels, \c 1 unless a volume texture. */
+			faces, /**< The number of faces, \c 6 for cube maps, otherwise \c 1. */
+			layers, /**< The number of array layers, \c 1 unless an array texture. */
+			levels; /**< The number of mipmap levels. */
+		size_t faceSize, /**< The number of bytes between the start of two consecutive faces. */
+			size; /**< The total size of the file in bytes. */
+		struct dds_mipmap mipmaps[DDS_MAX_LEVELS]; /**< The mipmap levels, from largest to smallest. */
+	};
+
+	/** Parses the header of a DDS file without touching OpenGL.
+		@param data The contents of the DDS file
+		@param size The number of readable bytes at \a data
+		@param image The descriptor to fill in
+		@return \c 1 if the file is a valid DDS file of a supported format, otherwise \c 0 */
+	int dds_parse(const char *data, size_t size, struct dds_image *image);
+
+	/** Flips compressed pixel data in place along the y-axis.
+		Uncompressed data is left untouched.
+		@param image The descriptor from ::dds_parse
+		@param data The contents of the DDS file */
+	void dds_flip(const struct dds_image *image, char *data);
+
+	/** Returns whether the driver supports the format of a parsed DDS file.
+		Must be called after the OpenGL extensions have been loaded, but may be called from any thread.
+		@param image The descriptor from ::dds_parse
+		@return \c 0 if the pixel data must be decompressed with ::dds_decompress before uploading */
+	int dds_is_supported(const struct dds_image *image);
+
+	/** Decodes block compressed pixel data into RGBA8 pixels on the CPU, without touching OpenGL.
+		@param image The descriptor from ::dds_parse
+		@param data The contents of the DDS file
+		@param flags The loading flags, e.g. ::DDS_FLIP_UVS
+		@param decompressed Receives the descriptor of the decoded pixel data
+		@param pool The thread pool to decode on, or \c 0 to decode on the calling thread
+		@return The decoded pixel data, to be freed with \c free, or \c 0 on failure */
+	char *dds_decompress(const struct dds_image *image, const char *data, int flags, struct dds_image *decompressed, struct threadpool *pool);
+
+	/** Block compresses an image of RGBA8 pixels into a DDS file in memory, without touching OpenGL.
+		@param rgba The pixels, row by row
+		@param width The width of the image in pixels
+		@param height The height of the image in pixels
+		@param internalformat The compressed format, one of the S3TC or RGTC formats read by ::dds_parse
+		@param flags The encoding flags, e.g. ::DDS_MIPMAPS or ::DDS_HIGH_QUALITY
+		@param size Receives the size of the file in bytes
+		@param pool The thread pool to encode on, or \c 0 to encode on the calling thread
+		@return The contents of the DDS file, to be freed with \c free, or \c 0 on failure */
+	char *dds_encode(const unsigned char *rgba, unsigned int width, unsigned int height, GLenum internalformat, int flags, size_t *size, struct threadpool *pool);
+
+	/** Defines a texture from a parsed DDS file. Must be called on the thread owning the OpenGL context.
+		Formats the driver lacks are decompressed on the calling thread.
+		@param image The descriptor from ::dds_parse
+		@param data The contents of the DDS file
+		@param texture The texture name to define, or \c 0 to generate a new one
+		@return The texture name, or \c 0 on failure */
+	GLuint dds_upload(const struct dds_image *image, const char *data, GLuint texture);
+
+	/** Defines a single mipmap level of every face of a bound 2D or cube map texture, or releases its memory if \a data is \c 0.
+		Lets levels of textures defined by ::dds_upload be streamed in and out.
+		@param image The descriptor from ::dds_parse
+		@param level The mipmap level
+		@param data The contents of the DDS file, or \c 0
+		@return The number of bytes of pixel data of the level */
+	size_t dds_upload_level(const struct dds_image *image, unsigned int level, const char *data);
+
+	/** Returns the largest level of the mip tail of a 2D or cube map image, made of the levels no larger than ::DDS_TAIL_SIZE,
+		which stay resident while larger levels are evicted. Returns \c 0 for volumes and arrays, whose levels are never evicted.
+		@param image The descriptor from ::dds_parse */
+	unsigned int dds_tail_level(const struct dds_image *image);
+
+	/** Releases the memory of the base level of a texture defined by ::dds_upload, making the next smaller level the base.
+		@param image The descriptor of the texture
+		@param texture The texture name
+		@param level The base level, less than ::dds_tail_level
+		@return The number of bytes of video memory released */
+	size_t dds_evict_level(const struct dds_image *image, GLuint texture, unsigned int level);
+
+	/** Uploads a level released by ::dds_evict_level back into a texture and makes it the base level.
+		@param image The descriptor of the texture
+		@param texture The texture name
+		@param level The level just above the base level
+		@param data The contents of the DDS file
+		@return The number of bytes uploaded */
+	size_t dds_restore_level(const struct dds_image *image, GLuint texture, unsigned int level, const char *data);
+
 	extern GLuint dds_load_texture_from_memory(const char *data, int *imageWidth, int *imageHeight, int flags);
 
+	/** Loads a DDS file by mapping it into memory and streaming it through a pixel unpack buffer into immutable texture storage.
+		The pixel data is copied once on the CPU, straight from the mapping into the buffer.
+		Where persistent mapping is supported, the buffer is kept mapped and reused by later loads on the thread,
+		growing to the largest file, until ::dds_release_staging_buffer.
+		@param path The path of the DDS file
+		@param imageWidth Receives the width of the image if non-zero
+		@param imageHeight Receives the height of the image if non-zero
+		@param flags The loading flags, e.g. ::DDS_FLIP_UVS
+		@return The texture name, or \c 0 on failure */
+	extern GLuint dds_load_texture_from_file(const char *path, int *imageWidth, int *imageHeight, int flags);
+
+	/** Deletes the pixel unpack buffer kept by ::dds_load_texture_from_file for the context current on the calling thread.
+		Must be called before that context is destroyed or another one is made current on the thread; later loads create it again. */
+	extern void dds_release_staging_buffer(void);
+
+	/** Reads a whole file into memory, e.g. to parse it with ::dds_parse away from the thread owning the context.
+		@param path The path of the file
+		@param size Set to the size of the file in bytes
+		@return The contents of the file, to be freed with \c free, or \c 0 on failure */
+	char *dds_read_file(const char *path, size_t *size);
+
 #ifdef __cplusplus
 }
 #endif
 
-#endif
\ No newline at end of file
+#endif
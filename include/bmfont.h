@@ -1,42 +1,75 @@
 /** Binary AngelCode BMFont file parser. Based on Matthias Mann's TWL BitmapFont class.
+	Parsed fonts can be baked into a runtime blob of their tables, which loads in place with no parsing or allocation,
+	as from a memory-mapped file. Baked blobs are specific to the version of the format and the byte order of the machine.
 	@file bmfont.h */
 
 #ifndef BMFONT_H
 #define BMFONT_H
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-#define LOG2_PAGE_SIZE 9
-#define PAGE_SIZE (1 << LOG2_PAGE_SIZE)
-#define	PAGES (0x10000 / PAGE_SIZE)
+	/** The number of bits of a codepoint resolved by the second level of the glyph map. */
+#define BMFONT_BLOCK_BITS 8
+	/** The number of codepoints covered by a block of the glyph map. */
+#define BMFONT_BLOCK_SIZE (1 << BMFONT_BLOCK_BITS)
+
+	struct atlas_sprite;
 
-	/** A single character in a front page. */
+	/** A single character in a font page. */
 	struct glyph {
-		int id, /**< The character id. */
-			x, /**< The left position of the character image in the texture. */
+		unsigned int id; /**< The character id. */
+		unsigned short x, /**< The left position of the character image in the texture. */
 			y, /**< The top position of the character image in the texture. */
 			width, /**< The width of the character image in the texture. */
-			height, /**< The height of the character image in the texture. */
-			xoffset, /**< How much the current position should be offset when copying the image from the texture to the screen. */
+			height; /**< The height of the character image in the texture. */
+		short xoffset, /**< How much the current position should be offset when copying the image from the texture to the screen. */
 			yoffset, /**< How much the current position should be offset when copying the image from the texture to the screen. */
-			xadvance, /**< How much the current position should be advanced after drawing the character. */
-			page; /**< The texture page where the character image is found. */
-		char **kerning; /**< The kerning information is used to adjust the distance between certain characters. */
+			xadvance; /**< How much the current position should be advanced after drawing the character. */
+		unsigned short page; /**< The texture page where the character image is found. */
 	};
 
-	/** An AngelCode BMFont. */
+	/** An AngelCode BMFont.
+		Glyphs are stored densely and found through a two-level map from codepoints to glyph indices, where index \c 0 means no glyph.
+		Kerning pairs are sorted by the glyph indices of the first and then second character, so that the pairs of a glyph are found by binary search. */
 	struct bmfont {
 		unsigned int lineHeight, /**< This is the distance in pixels between each line of text. */
 			base, /**< The number of pixels from the absolute top of the line to the base of the characters. */
+			scaleW, /**< The width of the texture pages in pixels. */
+			scaleH, /**< The height of the texture pages in pixels. */
+			spread, /**< The distance in texture pixels a distance field page spans on either side of the edges, or \c 0 for coverage pages. */
 			pages; /**< The number of texture pages included in the font. */
-		char **pageNames; /**< The texture file names. */
-		struct glyph *glyphs[PAGES]; /**< The characters. */
+		char *pageNames; /**< The texture file names, every one in ::pageNameStride bytes. Use ::bmfont_page_name. */
+		unsigned int pageNameStride; /**< The size of every page name, including the terminating zero. */
+		unsigned int glyphCount; /**< The number of glyphs, including the empty glyph at index \c 0. */
+		struct glyph *glyphs; /**< The characters, indexed by glyph index. */
+		unsigned int mapSize; /**< The number of entries in the map, up to the block of the highest codepoint. */
+		unsigned short *map; /**< The block of every ::BMFONT_BLOCK_SIZE codepoints, where block \c 0 has no glyphs. */
+		unsigned short *blocks; /**< The glyph index of every codepoint of every block. */
+		unsigned int *kerningStarts; /**< The first kerning pair of every glyph index, followed by the total number of pairs. */
+		unsigned short *kerningSeconds; /**< The glyph index of the second character of every pair. */
+		short *kerningAmounts; /**< The adjustment of every pair. */
+		const void *baked; /**< The baked blob the tables are in. */
+		void *storage; /**< The blob if owned by the font, or \c 0 if opened in place. */
+	};
+
+	/** Positioned glyph quads, stored as a structure of arrays with two entries per quad.
+		Positions are in pixels with y growing downwards, and texture coordinates expect the page images bottom row first, as loaded with ::DDS_FLIP_UVS. */
+	struct text_quads {
+		unsigned int count, /**< The number of quads. */
+			capacity; /**< The number of quads there is room for. */
+		float *x, /**< The left and right edge of every quad. */
+			*y, /**< The top and bottom edge of every quad. */
+			*u, /**< The texture coordinates of the left and right edge of every quad. */
+			*v; /**< The texture coordinates of the top and bottom edge of every quad. */
+		unsigned short *pages; /**< The font page of every quad. */
 	};
 
 	/** Returns a new \c struct bmfont from the specified AngelCode BMFont file.
-		@param data The textual representation of the font file
+		@param data The binary representation of the font file
 		@return A new font */
 	struct bmfont *create_bmfont(const char *data);
 
@@ -44,17 +77,107 @@ extern "C" {
 		@param font The font to free */
 	void destroy_bmfont(struct bmfont *font);
 
+	/** Returns the tables of a font as a baked blob, to be saved and loaded with ::bmfont_open_baked.
+		@param font The font
+		@param size Set to the size of the blob in bytes
+		@return The blob, to be freed with \c free, or \c 0 if out of memory */
+	char *bmfont_bake(const struct bmfont *font, size_t *size);
+
+	/** Opens a baked font in place, without allocating. The tables are checked once, so that corrupt data cannot be read out of bounds.
+		The data must outlive the font, and be writable for ::bmfont_move_pages, as by a private memory mapping.
+		@param data The baked blob, aligned to 4 bytes
+		@param size The size of the data in bytes
+		@param font Set to the font, which must not be passed to ::destroy_bmfont
+		@return \c 1 on success, or \c 0 if the data is not a valid blob of this version and byte order */
+	int bmfont_open_baked(const char *data, size_t size, struct bmfont *font);
+
+	/** Returns a new font from either a baked blob, used in place, or an AngelCode BMFont file, which is parsed.
+		A blob of another version or byte order is rejected, to be baked anew from the font file.
+		@param data The baked blob aligned to 4 bytes, which must outlive the font, or the font file followed by a zero byte
+		@param size The size of the data in bytes, including the zero byte of a font file
+		@return The font to free with ::destroy_bmfont, or \c 0 on failure */
+	struct bmfont *bmfont_open(const char *data, size_t size);
+
+	/** Returns the texture file name of a page.
+		@param font The font
+		@param page The index of the page
+		@return The file name, or \c 0 if there is no such page */
+	const char *bmfont_page_name(const struct bmfont *font, unsigned int page);
+
+	/** Returns the glyph index of a character, to look up its glyph and kerning without going through the map again.
+		@param font The font
+		@param codepoint The Unicode codepoint of the character
+		@return The glyph index, or \c 0 if the font lacks the character */
+	unsigned int bmfont_get_index(const struct bmfont *font, unsigned int codepoint);
+
 	/** Returns the character information from the struct bmfont.
 		@param font The font
-		@param c The character to lookup
-		@return The font's information on the character */
-	struct glyph bmfont_get_glyph(struct bmfont *font, char c);
+		@param codepoint The Unicode codepoint of the character to lookup
+		@return The font's information on the character, or \c 0 if the font lacks it */
+	const struct glyph *bmfont_get_glyph(const struct bmfont *font, unsigned int codepoint);
+
+	/** Returns the kerning between two glyphs.
+		@param font The font
+		@param first The glyph index of the left character
+		@param second The glyph index of the right character
+		@return The amount to add to the advance of the first character */
+	int bmfont_get_index_kerning(const struct bmfont *font, unsigned int first, unsigned int second);
+
+	/** Returns the kerning between two characters.
+		@param font The font
+		@param first The Unicode codepoint of the left character
+		@param second The Unicode codepoint of the right character
+		@return The amount to add to the advance of the first character */
+	int bmfont_get_kerning(const struct bmfont *font, unsigned int first, unsigned int second);
+
+	/** Marks the pages as signed distance fields made with ::sdf_generate, growing the glyph rectangles by the spread so that the outer ramp is drawn.
+		Fonts of distance field pages draw at any size, scaled in the shader, and should be generated with padding of at least the spread.
+		The pages may be shrunk by any factor, as texture coordinates are relative to the size of a page.
+		@param font The font
+		@param spread The spread of the distance fields in pixels of the pages at their size in the font file */
+	void bmfont_set_spread(struct bmfont *font, unsigned int spread);
+
+	/** Returns a new, empty list of quads.
+		@param capacity The number of quads to make room for
+		@return The quads, or \c 0 on failure */
+	struct text_quads *create_text_quads(unsigned int capacity);
+
+	/** Frees the quads.
+		@param quads The quads to free */
+	void destroy_text_quads(struct text_quads *quads);
 
-	/** Returns the kerning between the glyph and the character.
-		@param glyph The glyph with the kerning data
-		@param c The other character to find kerning between
-		@return The kerning */
-	int glyph_get_kerning(struct glyph glyph, char c);
+	/** Lays out UTF-8 text, appending a quad for every visible glyph with kerning applied.
+		A newline moves the pen to the start of the next line. Characters the font lacks are drawn as U+FFFD or '?', and malformed UTF-8 as U+FFFD.
+		@param font The font
+		@param text The UTF-8 text
+		@param length The length of the text in bytes
+		@param x The x-coordinate of the pen, moved past the text
+		@param y The y-coordinate of the top of the line, moved down by any newlines
+		@param quads The quads to append to
+		@return \c 1 on success, or \c 0 if out of memory */
+	int bmfont_layout(const struct bmfont *font, const char *text, size_t length, float *x, float *y, struct text_quads *quads);
+
+	/** Decodes the codepoint at the start of UTF-8 text, reading malformed sequences as U+FFFD one byte at a time.
+		@param text The UTF-8 text
+		@param length The length of the text in bytes, at least \c 1
+		@param codepoint Set to the decoded codepoint
+		@return The number of bytes read */
+	unsigned int bmfont_decode_utf8(const char *text, size_t length, unsigned int *codepoint);
+
+	/** Returns the width of the widest line of UTF-8 text, as far as the pen advances.
+		@param font The font
+		@param text The UTF-8 text
+		@param length The length of the text in bytes
+		@return The width in pixels */
+	float bmfont_measure(const struct bmfont *font, const char *text, size_t length);
+
+	/** Moves the glyphs to where the font's pages were packed into texture atlas pages.
+		The page images are expected to be inserted bottom row first, as OpenGL textures are.
+		@param font The font
+		@param sprites The placement of every page of the font
+		@param atlasWidth The width of the atlas pages
+		@param atlasHeight The height of the atlas pages */
+	void bmfont_move_pages(struct bmfont *font, const struct atlas_sprite *sprites, int atlasWidth, int atlasHeight);
 
 #ifdef __cplusplus
 }
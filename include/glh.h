@@ -67,26 +67,120 @@ extern "C" {
 
 	GLuint compile_shader(GLenum type, const char *source);
 
+	/* STATE */
+
+	/** The number of texture units whose \c GL_TEXTURE_2D binding is cached. */
+#define GLH_TEXTURE_UNITS 16
+
+	/** Declares a variable with a copy for every thread, such as state tied to the context current on the thread. */
+#ifdef _MSC_VER
+#define GLH_THREAD_LOCAL __declspec(thread)
+#else
+#define GLH_THREAD_LOCAL __thread
+#endif
+
+	/** The calls made and dropped by the state cache of the calling thread, counted since the thread started. */
+	struct glh_state_counters {
+		unsigned long issued, /**< The number of GL calls made. */
+			skipped; /**< The number of redundant GL calls dropped. */
+	};
+
+	/** Binds a program, unless the cache knows it is in use already.
+		Every thread has a cache of its own, holding the bindings of the context current on it. Making another context current on the thread,
+		bindings made around the cache, and bound objects deleted other than with ::destroy_mesh or the \c glh_delete functions,
+		must be followed by ::glh_reset_state.
+		@param program The program, or \c 0 */
+	void glh_use_program(GLuint program);
+
+	/** Binds a vertex array object, unless the cache knows it is bound already. The element array buffer binding is forgotten with the old one.
+		@param vertexArray The vertex array object, or \c 0 */
+	void glh_bind_vertex_array(GLuint vertexArray);
+
+	/** Binds a buffer, unless the cache knows it is bound already.
+		The array, element array, uniform and draw indirect buffer targets are cached, and other targets are always bound.
+		@param target The buffer target
+		@param buffer The buffer, or \c 0 */
+	void glh_bind_buffer(GLenum target, GLuint buffer);
+
+	/** Binds a range of a buffer to an indexed binding point, such as a uniform block binding, recording the general binding of the target it also sets.
+		@param target The buffer target, e.g. \c GL_UNIFORM_BUFFER
+		@param index The binding point
+		@param buffer The buffer
+		@param offset The offset of the range in bytes
+		@param size The size of the range in bytes */
+	void glh_bind_buffer_range(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+
+	/** Selects the texture unit that ::glh_bind_texture binds to, unless the cache knows it is selected already.
+		@param unit The index of the texture unit, starting at \c 0 rather than \c GL_TEXTURE0 */
+	void glh_active_texture(GLuint unit);
+
+	/** Binds a texture to the active texture unit, unless the cache knows it is bound already.
+		Only \c GL_TEXTURE_2D bindings of the first ::GLH_TEXTURE_UNITS units are cached, once the active unit is known.
+		@param target The texture target
+		@param texture The texture, or \c 0 */
+	void glh_bind_texture(GLenum target, GLuint texture);
+
+	/** Deletes vertex array objects, forgetting their cached bindings as the GL reverts them to \c 0.
+		@param count The number of vertex array objects
+		@param vertexArrays The vertex array objects to delete */
+	void glh_delete_vertex_arrays(GLsizei count, const GLuint *vertexArrays);
+
+	/** Deletes buffers, forgetting their cached bindings as the GL reverts them to \c 0.
+		@param count The number of buffers
+		@param buffers The buffers to delete */
+	void glh_delete_buffers(GLsizei count, const GLuint *buffers);
+
+	/** Deletes textures, forgetting their cached bindings as the GL reverts them to \c 0.
+		@param count The number of textures
+		@param textures The textures to delete */
+	void glh_delete_textures(GLsizei count, const GLuint *textures);
+
+	/** Forgets every cached binding, for after GL state was changed around the cache or another context was made current. */
+	void glh_reset_state(void);
+
+	/** Returns the number of calls made and avoided by the state cache, to measure the savings. */
+	struct glh_state_counters glh_get_state_counters(void);
+
 	/* MESH */
 
-	struct mesh { GLuint vbo, ibo; };
+	/** Vertex and index buffers, with a vertex array object of their layout once drawn or given one. */
+	struct mesh {
+		GLuint vbo, /**< The vertex buffer. */
+			ibo, /**< The index buffer, or \c 0 if not indexed. */
+			vao; /**< The vertex array object, or \c 0 until the layout is set. */
+	};
 
 	struct mesh * create_mesh(int indexed /* = GL_FALSE */);
 
+	/** Deletes the buffers and vertex array object of the mesh, forgetting their cached bindings.
+		@param mesh The mesh to free */
 	void destroy_mesh(struct mesh *mesh);
 
+	/** Records the layout of the vertices in the vertex array object of the mesh, replacing any previous layout.
+		The vertex array object is left bound.
+		@param mesh The mesh
+		@param attributes The float attributes, terminated by ::NULL_ATTRIB
+		@param stride The size of a vertex in bytes
+		@return \c 1 on success, or \c 0 if vertex array objects are not supported */
+	int mesh_set_layout(struct mesh *mesh, const struct attrib *attributes, GLsizei stride);
+
+	/** Runs \a stmt with the mesh bound for drawing. The layout is recorded in a vertex array object the first time, which is left bound afterwards.
+		Without vertex array object support, the attributes are enabled for \a stmt and disabled again after it. */
 #define with_mesh(mesh, attributes, stride, stmt) \
 	do { \
-		glBindBuffer(GL_ARRAY_BUFFER, mesh->vbo); \
-		int i; \
-		for (i = 0; attributes[i].size != 0; i++) { \
-			struct attrib attribute = attributes[i]; \
-			glEnableVertexAttribArray(attribute.location); \
-			glVertexAttribPointer(attribute.location, attribute.size, GL_FLOAT, GL_FALSE, stride, BUFFER_OFFSET(attribute.offset)); \
+		int i = 0, immediate = (mesh)->vao == 0 && !mesh_set_layout(mesh, attributes, stride); \
+		if (immediate) { \
+			glh_bind_buffer(GL_ARRAY_BUFFER, (mesh)->vbo); \
+			for (; attributes[i].size != 0; i++) { \
+				struct attrib attribute = attributes[i]; \
+				glEnableVertexAttribArray(attribute.location); \
+				glVertexAttribPointer(attribute.location, attribute.size, GL_FLOAT, GL_FALSE, stride, BUFFER_OFFSET(attribute.offset)); \
+			} \
+			if ((mesh)->ibo != 0) glh_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, (mesh)->ibo); \
 		} \
-		if (mesh->ibo != 0) glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->ibo); \
+		else glh_bind_vertex_array((mesh)->vao); \
 		stmt \
-		for (; i > 0; i--) glDisableVertexAttribArray(attributes[i].location); \
+		while (i-- > 0) glDisableVertexAttribArray(attributes[i].location); \
 	} while(0)
 
 #ifdef __cplusplus
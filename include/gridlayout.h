@@ -4,11 +4,14 @@
 #ifndef GRIDLAYOUT_H
 #define GRIDLAYOUT_H
 
+#include "threadpool.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 #include <float.h>
+#include <stddef.h>
 
 #define MIN_CONTENT FLT_MIN
 #define MAX_CONTENT FLT_MAX
@@ -48,8 +51,14 @@ extern "C" {
 		float fillX, /**< The percentage of the grid area's width to fill (\c 0-\c 1). */
 			fillY; /**< The percentage of the grid area's height to fill (\c 0-\c 1). */
 		struct widget *widget; /**< The widget. */
+		struct gridlayout *grid; /**< A grid nested in the widget, or \c 0. Its intrinsic sizes replace those of the callbacks and it fills the widget. */
 	};
 
+	struct gridcache;
+
+	/** A grid, which keeps the intrinsic sizes of its items and the sizes of its tracks between layouts.
+		Zero the grid before the first layout, and free it with ::freeGridLayout.
+		The state is allocated on the first layout, or placed in memory of the caller with ::initGridLayout. */
 	struct gridlayout {
 		int columns, /**< The number of columns. */
 			rows, /**< The number of rows. */
@@ -60,9 +69,25 @@ extern "C" {
 		float gridMinWidth, gridMinHeight, gridMaxWidth, gridMaxHeight,
 			(*minWidth)(struct widget *), (*minHeight)(struct widget *),
 			(*maxWidth)(struct widget *), (*maxHeight)(struct widget *);
+		struct gridcache *cache; /**< The state kept between layouts, or \c 0. */
+	};
+
+	/** A grid of many rows of the same layout, such as a data table, of which only the rows in view are laid out.
+		The rows have a default height, and may each be given another. Their offsets are kept in a Fenwick tree once they differ,
+		so that finding the rows in view takes logarithmic time. Zero the grid before use, and free it with ::freeVirtualGrid. */
+	struct virtualgrid {
+		struct gridlayout *row; /**< The layout of a row, laid out for every row in view in turn. */
+		void (*bindRow)(struct virtualgrid *grid, int row); /**< Points the widgets of the row layout at those showing a row, invalidating the items whose sizes change. */
+		void *user; /**< The data of the caller. */
+		int rowCount; /**< The number of rows, set with ::setVirtualGridRows. */
+		float rowHeight; /**< The default height of a row, to be set before any rows are given another height. */
+		int fitRows; /**< Non-zero to give every row the minimum height of the row layout when it comes into view. */
+		float *heights; /**< The height of every row, or \c 0 while all have the default height. */
+		double *tree; /**< The Fenwick tree of the row heights, indexed from \c 1. */
+		int capacity; /**< The number of rows there is room for in the tree. */
 	};
 
-	/** Positions and sizes children of the grid using the column and row templates.
+	/** Positions and sizes children of the grid using the column and row templates, and lays out any nested grids on the calling thread.
 		@param grid The grid
 		@param layoutX The grid's x-coordinate
 		@param layoutY The grid's y-coordinate
@@ -70,6 +95,80 @@ extern "C" {
 		@param layoutHeight The heigt of the parent container */
 	void layoutGrid(struct gridlayout *grid, float layoutX, float layoutY, float layoutWidth, float layoutHeight);
 
+	/** Lays out a tree of nested grids, measuring the intrinsic sizes of the grids from the bottom up and then positioning their items from the top down.
+		Nested grids are laid out within the widgets of their items, with sibling subtrees spread over the thread pool. A grid must be nested at most once.
+		@param grid The root grid
+		@param layoutX The grid's x-coordinate
+		@param layoutY The grid's y-coordinate
+		@param layoutWidth The width of the parent container
+		@param layoutHeight The height of the parent container
+		@param pool The thread pool, or \c 0 to lay out on the calling thread */
+	void layoutGridTree(struct gridlayout *grid, float layoutX, float layoutY, float layoutWidth, float layoutHeight, struct threadpool *pool);
+
+	/** Returns the size of the state the grid keeps between layouts, for ::initGridLayout.
+		@param grid The grid, with its numbers of columns, rows and items set
+		@return The size in bytes */
+	size_t gridLayoutSize(const struct gridlayout *grid);
+
+	/** Places the state the grid keeps between layouts in memory of the caller, such as a stack buffer or a frame arena, so that laying out does not allocate.
+		The memory is reused while it is large enough for the grid, and is not freed by ::freeGridLayout.
+		@param grid The grid
+		@param storage The memory, aligned for a pointer, which must outlive its use by the grid
+		@param size The size of the memory in bytes
+		@return \c 1 on success, or \c 0 if the memory is smaller than ::gridLayoutSize */
+	int initGridLayout(struct gridlayout *grid, void *storage, size_t size);
+
+	/** Makes the next layout size the tracks anew, after changing the templates or where the items are placed.
+		Changing the number of columns, rows or items, or the array of items, is detected without it.
+		@param grid The grid */
+	void invalidateGrid(struct gridlayout *grid);
+
+	/** Makes the next layout measure an item again, after its intrinsic sizes have changed.
+		The tracks are only sized anew if the sizes returned by the callbacks differ.
+		@param grid The grid
+		@param item The index of the item */
+	void invalidateGridItem(struct gridlayout *grid, int item);
+
+	/** Frees the state the grid keeps between layouts.
+		@param grid The grid */
+	void freeGridLayout(struct gridlayout *grid);
+
+	/** Changes the number of rows of a virtual grid, where added rows have the default height.
+		@param grid The virtual grid
+		@param rowCount The number of rows
+		@return \c 1 on success, or \c 0 if out of memory */
+	int setVirtualGridRows(struct virtualgrid *grid, int rowCount);
+
+	/** Gives a row of a virtual grid its own height, such as its measured height.
+		@param grid The virtual grid
+		@param row The index of the row
+		@param height The height of the row
+		@return \c 1 on success, or \c 0 if out of memory or there is no such row */
+	int setVirtualGridRowHeight(struct virtualgrid *grid, int row, float height);
+
+	/** Returns the height of a row of a virtual grid. */
+	float getVirtualGridRowHeight(const struct virtualgrid *grid, int row);
+
+	/** Returns the distance from the top of a virtual grid to a row, or the height of the grid for the number of rows. */
+	double getVirtualGridRowOffset(const struct virtualgrid *grid, int row);
+
+	/** Returns the row at a distance from the top of a virtual grid, or \c -1 if the distance is outside the grid. */
+	int getVirtualGridRowAt(const struct virtualgrid *grid, double y);
+
+	/** Lays out the rows of a virtual grid that are in view, binding each to the row layout in turn.
+		@param grid The virtual grid
+		@param layoutX The x-coordinate of the view
+		@param layoutY The y-coordinate of the view
+		@param layoutWidth The width of the view
+		@param layoutHeight The height of the view
+		@param scrollY The distance from the top of the grid to the top of the view
+		@return The number of rows laid out */
+	int layoutVirtualGrid(struct virtualgrid *grid, float layoutX, float layoutY, float layoutWidth, float layoutHeight, double scrollY);
+
+	/** Frees the row heights of a virtual grid, resetting all rows to the default height.
+		@param grid The virtual grid */
+	void freeVirtualGrid(struct virtualgrid *grid);
+
 #ifdef __cplusplus
 }
 #endif
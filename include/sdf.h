@@ -0,0 +1,33 @@
+/** Converts coverage bitmaps, such as the pages of a BMFont, into signed distance fields, which draw crisp edges at any scale.
+	The distances are exact Euclidean distances found in linear time, by the separable transform of Felzenszwalb and Huttenlocher.
+	@file sdf.h */
+
+#ifndef SDF_H
+#define SDF_H
+
+#include <stddef.h>
+#include "threadpool.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	/** Computes the signed distance field of a coverage bitmap, shrinking it by an integer factor.
+		Pixels with a coverage of at least one half are inside. The output maps the edge to \c 128,
+		distances of \a spread source pixels or more inside to \c 255 and outside to \c 0.
+		@param coverage The first row of the source pixels, one byte each
+		@param width The width of the source in pixels
+		@param height The height of the source in pixels
+		@param stride The number of bytes between consecutive rows of \a coverage
+		@param scale The factor to shrink the field by, where every output pixel averages \a scale by \a scale source pixels
+		@param spread The distance in source pixels covered on either side of the edge
+		@param distances Receives <tt>(width / scale) * (height / scale)</tt> bytes, row by row
+		@param pool The thread pool, or \c 0 to run on the calling thread
+		@return \c 1 on success, or \c 0 if out of memory or \a scale or \a spread is not positive */
+	int sdf_generate(const unsigned char *coverage, unsigned int width, unsigned int height, ptrdiff_t stride, unsigned int scale, float spread, unsigned char *distances, struct threadpool *pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
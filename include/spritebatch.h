@@ -0,0 +1,84 @@
+/** Draws the sprites of a frame with one instanced draw call per run of sprites sharing a program and a texture.
+	Sprites are sorted by depth, then program, then texture with a radix sort, and streamed as per-instance records through a ::stream_buffer.
+	Shaders draw a triangle strip of four vertices per instance, taking the corner from \c gl_VertexID, with the instance attributes at
+	::SPRITE_RECT_LOCATION, ::SPRITE_UV_LOCATION and ::SPRITE_COLOR_LOCATION.
+	@file spritebatch.h */
+
+#ifndef SPRITEBATCH_H
+#define SPRITEBATCH_H
+
+#include "glh.h"
+#include "streambuffer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	/** The attribute location of the \c vec4 rectangle of the sprite: x, y, width and height. */
+#define SPRITE_RECT_LOCATION 0
+	/** The attribute location of the \c vec4 texture coordinates of the sprite: the left, bottom, right and top edge. */
+#define SPRITE_UV_LOCATION 1
+	/** The attribute location of the \c vec4 color of the sprite. */
+#define SPRITE_COLOR_LOCATION 2
+	/** The number of distinct programs a batch can draw in a frame. */
+#define SPRITE_BATCH_PROGRAMS 256
+
+	/** The per-instance record of a sprite, as streamed to the GL. */
+	struct sprite_instance {
+		float x, /**< The left edge, in the units of the shader. */
+			y, /**< The top edge. */
+			width, /**< The width. */
+			height; /**< The height. */
+		unsigned short u0, /**< The texture coordinate of the left edge, normalized to \c 65535. */
+			v0, /**< The texture coordinate of the bottom edge, normalized to \c 65535. */
+			u1, /**< The texture coordinate of the right edge, normalized to \c 65535. */
+			v1; /**< The texture coordinate of the top edge, normalized to \c 65535. */
+		unsigned char color[4]; /**< The RGBA color, normalized to \c 255. */
+	};
+
+	struct sprite_batch;
+
+	/** Returns a new, empty batch.
+		@param capacity The number of sprites to make room for
+		@return The batch, or \c 0 on failure */
+	struct sprite_batch *create_sprite_batch(unsigned int capacity);
+
+	/** Deletes the batch and its vertex array object.
+		@param batch The batch to free */
+	void destroy_sprite_batch(struct sprite_batch *batch);
+
+	/** Adds a sprite to be drawn at the next ::sprite_batch_draw.
+		Sprites are drawn in increasing depth. Sprites of equal depth are grouped by program and texture,
+		keeping the order they were added in within a group, so overlapping sprites whose order matters need different depths.
+		@param batch The batch
+		@param program The shader program
+		@param texture The 2D texture, bound to the active texture unit
+		@param depth The depth of the sprite
+		@param sprite The instance record, which is copied
+		@return \c 1 on success, or \c 0 if out of memory or past ::SPRITE_BATCH_PROGRAMS programs */
+	int sprite_batch_add(struct sprite_batch *batch, GLuint program, GLuint texture, unsigned short depth, const struct sprite_instance *sprite);
+
+	/** Sorts the sprites into drawing order and writes their records, without touching the GL.
+		@param batch The batch
+		@param instances Set to the records of the sprites in drawing order, with room for every sprite
+		@return The number of draw calls the sprites need */
+	unsigned int sprite_batch_prepare(struct sprite_batch *batch, struct sprite_instance *instances);
+
+	/** Writes the sprites into the stream buffer and draws them, emptying the batch. Requires \c GL_ARB_base_instance.
+		@param batch The batch
+		@param stream The stream buffer to write the records into, whose frame the draws belong to
+		@return The number of draw calls made, or \c -1 if the stream buffer lacks room or base instances are not supported */
+	int sprite_batch_draw(struct sprite_batch *batch, struct stream_buffer *stream);
+
+	/** Removes every sprite from the batch without drawing.
+		@param batch The batch */
+	void sprite_batch_clear(struct sprite_batch *batch);
+
+	/** Returns the number of sprites in the batch. */
+	unsigned int sprite_batch_count(const struct sprite_batch *batch);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
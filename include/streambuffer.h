@@ -0,0 +1,57 @@
+/** Streams per-frame vertices, indices and uniform blocks through a persistently mapped buffer, without reallocating or stalling on the driver.
+	The buffer is split into a region per frame in flight, used as a ring. The commands of a frame are fenced when it ends,
+	and a region is written again only once the fence of its previous frame has signaled.
+	@file streambuffer.h */
+
+#ifndef STREAMBUFFER_H
+#define STREAMBUFFER_H
+
+#include <stddef.h>
+#include "glh.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	/** The number of frames the GL may be behind the writes. */
+#define STREAM_BUFFER_FRAMES 3
+
+	/** A ring of persistently mapped buffer regions. */
+	struct stream_buffer {
+		GLuint buffer; /**< The buffer, to bind to any target, e.g. with ::glh_bind_buffer or ::glh_bind_buffer_range. */
+		unsigned char *mapping; /**< The coherent mapping of the whole buffer. */
+		size_t frameSize, /**< The size of the region of every frame in bytes. */
+			used; /**< The number of bytes allocated from the region of the current frame. */
+		unsigned int frame; /**< The index of the region of the current frame. */
+		GLsync fences[STREAM_BUFFER_FRAMES]; /**< The fence of the last frame written to every region, or \c 0. */
+		GLint uniformAlignment; /**< The alignment of uniform buffer offsets in bytes. */
+		unsigned long stalls; /**< The number of times a region was still in use by the GL when written again. */
+	};
+
+	/** Returns a new stream buffer. Requires \c GL_ARB_buffer_storage and \c GL_ARB_sync.
+		@param frameSize The most bytes allocated in a frame
+		@return The stream buffer, or \c 0 on failure */
+	struct stream_buffer *create_stream_buffer(size_t frameSize);
+
+	/** Deletes the buffer, which the GL may still be reading from.
+		@param stream The stream buffer to free */
+	void destroy_stream_buffer(struct stream_buffer *stream);
+
+	/** Allocates memory from the region of the current frame, waiting first if the GL is still reading the region.
+		The memory is written straight into the buffer, and may be drawn from as soon as it is written.
+		@param stream The stream buffer
+		@param size The number of bytes
+		@param alignment The alignment of the offset in bytes, e.g. the size of a vertex or an index, or \c uniformAlignment for uniform blocks
+		@param offset Set to the offset of the memory in the buffer
+		@return The memory, or \c 0 if the region lacks room */
+	void *stream_buffer_alloc(struct stream_buffer *stream, size_t size, size_t alignment, GLintptr *offset);
+
+	/** Ends the frame once its draws are issued, fencing them and moving on to the next region.
+		@param stream The stream buffer */
+	void stream_buffer_end_frame(struct stream_buffer *stream);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
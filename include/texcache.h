@@ -0,0 +1,75 @@
+/** Shares DDS textures between their users, keyed by path and by content, and keeps them within a video memory budget.
+	@file texcache.h */
+
+#ifndef TEXCACHE_H
+#define TEXCACHE_H
+
+#include <stddef.h>
+#include <GL/glew.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	/** A shared handle to a cached texture. */
+	struct cached_texture {
+		GLuint texture; /**< The texture name, which stays the same while levels are evicted and restored. */
+		GLenum target; /**< The texture target. */
+		int width, /**< The width of the texture in pixels. */
+			height; /**< The height of the texture in pixels. */
+		size_t bytes; /**< The estimated number of bytes of video memory the resident levels occupy. */
+	};
+
+	struct texcache;
+
+	/** Returns a new texture cache.
+		@param budget The amount of video memory the textures may occupy in bytes, or \c 0 for no limit
+		@return A new texture cache, or \c 0 on failure */
+	struct texcache *create_texcache(size_t budget);
+
+	/** Deletes the cache along with every texture in it, whether released or not.
+		@param cache The cache to free */
+	void destroy_texcache(struct texcache *cache);
+
+	/** Returns a reference to the texture of a DDS file, loading it unless a file of the same path or contents is cached.
+		Must be called on the thread owning the OpenGL context.
+		@param cache The texture cache
+		@param path The path of the DDS file
+		@param flags The DDS loading flags, e.g. ::DDS_FLIP_UVS
+		@return The shared texture, or \c 0 on failure */
+	struct cached_texture *texcache_load_file(struct texcache *cache, const char *path, int flags);
+
+	/** Returns a reference to the texture of a DDS file in memory, uploading it unless the same contents are cached.
+		Must be called on the thread owning the OpenGL context.
+		@param cache The texture cache
+		@param data The contents of the DDS file
+		@param size The size of the file in bytes
+		@param flags The DDS loading flags, e.g. ::DDS_FLIP_UVS
+		@return The shared texture, or \c 0 on failure */
+	struct cached_texture *texcache_load_memory(struct texcache *cache, const char *data, size_t size, int flags);
+
+	/** Drops a reference to a texture. Textures without references stay cached until evicted.
+		@param cache The texture cache
+		@param texture The texture to release */
+	void texcache_release(struct texcache *cache, struct cached_texture *texture);
+
+	/** Marks a texture as the most recently used, so that it is the last to be evicted.
+		Evicted levels of textures loaded from files are read back in if they fit within the budget.
+		@param cache The texture cache
+		@param texture The texture that is used */
+	void texcache_touch(struct texcache *cache, struct cached_texture *texture);
+
+	/** Sets the amount of video memory the textures may occupy, evicting to stay within it.
+		Unreferenced textures are deleted first, least recently used first, and then the largest levels of textures in use down to their mip tails, see ::dds_tail_level.
+		@param cache The texture cache
+		@param budget The budget in bytes, or \c 0 for no limit */
+	void texcache_set_budget(struct texcache *cache, size_t budget);
+
+	/** Returns the estimated number of bytes of video memory used by the cached textures. */
+	size_t texcache_resident(const struct texcache *cache);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
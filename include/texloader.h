@@ -0,0 +1,86 @@
+/** Loads DDS textures in the background, reading and preparing them on worker threads and uploading them under a per-frame budget.
+	@file texloader.h */
+
+#ifndef TEXLOADER_H
+#define TEXLOADER_H
+
+#include <stddef.h>
+#include <GL/glew.h>
+#include "threadpool.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	enum {
+		TEXLOADER_PROGRESSIVE = 1 << 16 /**< Uploads the mip tail of levels up to ::DDS_TAIL_SIZE first and streams in larger levels over the following frames. May be combined with the DDS loading flags. Volumes and arrays are uploaded at once. */
+	};
+
+	enum texture_status {
+		TEXTURE_PENDING, /**< The texture is still being loaded. */
+		TEXTURE_READY, /**< The texture has been uploaded. */
+		TEXTURE_FAILED /**< The file could not be read or is not a supported DDS file. */
+	};
+
+	/** A handle to a texture that becomes valid once its upload has completed. */
+	struct streamed_texture {
+		GLuint texture; /**< The texture name, or the loader's placeholder until the upload has completed. */
+		GLenum target; /**< The texture target, valid once ready. */
+		int width, /**< The width of the texture in pixels, valid once ready. */
+			height; /**< The height of the texture in pixels, valid once ready. */
+		enum texture_status status; /**< The status of the load. */
+	};
+
+	struct texloader;
+
+	/** Returns a new texture loader.
+		@param pool The worker threads to read and prepare files on
+		@param placeholder The texture to hand out until a load completes, or \c 0
+		@return A new texture loader, or \c 0 on failure */
+	struct texloader *create_texloader(struct threadpool *pool, GLuint placeholder);
+
+	/** Waits for outstanding reads and then deletes the loader along with every texture loaded through it.
+		@param loader The loader to free */
+	void destroy_texloader(struct texloader *loader);
+
+	/** Starts loading a DDS file in the background. Returns immediately.
+		@param loader The texture loader
+		@param path The path of the DDS file
+		@param flags The DDS loading flags, e.g. ::DDS_FLIP_UVS, optionally combined with ::TEXLOADER_PROGRESSIVE
+		@return A handle to the texture, or \c 0 on failure */
+	struct streamed_texture *texloader_load(struct texloader *loader, const char *path, int flags);
+
+	/** Deletes a texture, cancelling its load if it is still pending.
+		@param loader The texture loader
+		@param texture The texture to release */
+	void texloader_release(struct texloader *loader, struct streamed_texture *texture);
+
+	/** Marks a texture as used this frame, so that its levels are the last to be evicted.
+		Evicted levels of a progressive texture are streamed back in once it is touched again.
+		@param loader The texture loader
+		@param texture The texture that is used */
+	void texloader_touch(struct texloader *loader, struct streamed_texture *texture);
+
+	/** Sets the amount of video memory progressive textures may occupy before their largest levels are evicted.
+		The mip tails are never evicted.
+		@param loader The texture loader
+		@param budget The budget in bytes, or \c 0 for no limit */
+	void texloader_set_budget(struct texloader *loader, size_t budget);
+
+	/** Returns the estimated number of bytes of video memory used by the loaded textures. */
+	size_t texloader_resident(const struct texloader *loader);
+
+	/** Uploads textures and levels that have finished loading, then evicts levels of unused progressive textures if over budget.
+		Call once per frame on the thread owning the OpenGL context.
+		At least one upload is made if any is ready, regardless of the budget.
+		@param loader The texture loader
+		@param byteBudget The maximum number of bytes to upload, or \c 0 for no limit
+		@param timeBudget The maximum number of milliseconds to spend, or \c 0 for no limit
+		@return The number of textures that became ready or failed */
+	int texloader_update(struct texloader *loader, size_t byteBudget, unsigned int timeBudget);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
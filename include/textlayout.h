@@ -0,0 +1,81 @@
+/** Word wraps large documents of BMFont text, such as logs and chat windows, without measuring the text again.
+	The advance widths of words are cached per paragraph. Edits and width changes wrap only the paragraphs whose line breaks change,
+	and the line counts of the paragraphs are kept in a Fenwick tree to find the line at a given height in logarithmic time.
+	@file textlayout.h */
+
+#ifndef TEXTLAYOUT_H
+#define TEXTLAYOUT_H
+
+#include <stddef.h>
+#include "bmfont.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	struct text_document;
+
+	/** Returns a new, empty document.
+		@param font The font, which must outlive the document
+		@param width The width to wrap lines at in pixels
+		@return The document, or \c 0 on failure */
+	struct text_document *create_text_document(const struct bmfont *font, float width);
+
+	/** Frees the document and its text.
+		@param document The document to free */
+	void destroy_text_document(struct text_document *document);
+
+	/** Appends paragraphs to the end of the document, one for every line of the text.
+		@param document The document
+		@param text The UTF-8 text
+		@param length The length of the text in bytes
+		@return \c 1 on success, or \c 0 if out of memory */
+	int text_document_append(struct text_document *document, const char *text, size_t length);
+
+	/** Replaces the text of a paragraph.
+		@param document The document
+		@param paragraph The index of the paragraph
+		@param text The UTF-8 text, without newlines
+		@param length The length of the text in bytes
+		@return \c 1 on success, or \c 0 if out of memory or the paragraph does not exist */
+	int text_document_set(struct text_document *document, unsigned int paragraph, const char *text, size_t length);
+
+	/** Changes the width to wrap lines at, wrapping the paragraphs whose line breaks change.
+		Words wider than the width are put on lines of their own.
+		@param document The document
+		@param width The width in pixels */
+	void text_document_set_width(struct text_document *document, float width);
+
+	/** Returns the number of paragraphs in the document. */
+	unsigned int text_document_paragraphs(const struct text_document *document);
+
+	/** Returns the number of wrapped lines in the document. */
+	unsigned int text_document_lines(const struct text_document *document);
+
+	/** Returns the index of the first line of a paragraph among all lines of the document.
+		@param document The document
+		@param paragraph The index of the paragraph, or the number of paragraphs for the total number of lines
+		@return The index of the line */
+	unsigned int text_document_first_line(const struct text_document *document, unsigned int paragraph);
+
+	/** Finds the line at a distance from the top of the document, for drawing only the lines in view.
+		@param document The document
+		@param y The distance from the top in pixels
+		@param paragraph Set to the index of the paragraph
+		@param line Set to the index of the line within the paragraph
+		@return \c 1 if a line is found, or \c 0 if \a y is outside the document */
+	int text_document_line_at(const struct text_document *document, float y, unsigned int *paragraph, unsigned int *line);
+
+	/** Returns the text of a wrapped line, without the spaces it was broken at.
+		@param document The document
+		@param paragraph The index of the paragraph
+		@param line The index of the line within the paragraph
+		@param length Set to the length of the text in bytes
+		@return The text of the line, or \c 0 if there is no such line */
+	const char *text_document_line(const struct text_document *document, unsigned int paragraph, unsigned int line, size_t *length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
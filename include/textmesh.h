@@ -0,0 +1,77 @@
+/** Renders BMFont text from vertex buffers, with one draw call per font page.
+	Vertices have a \c vec2 position followed by a \c vec2 texture coordinate, as produced by ::bmfont_layout.
+	@file textmesh.h */
+
+#ifndef TEXTMESH_H
+#define TEXTMESH_H
+
+#include <stddef.h>
+#include "glh.h"
+#include "bmfont.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	/** The vertices of laid-out text, grouped by font page. */
+	struct text_mesh {
+		const struct bmfont *font; /**< The font. */
+		struct mesh *mesh; /**< The vertex and index buffers. */
+		struct text_quads *quads; /**< The laid-out glyphs waiting to be uploaded. */
+		unsigned int *pageStarts; /**< The first quad of every font page in the buffers, followed by the number of quads. */
+		unsigned int capacity; /**< The number of quads the buffers have room for. */
+		GLenum usage; /**< The usage hint of the buffers. */
+		GLint position, /**< The location of the position attribute in the layout of the vertex array object. */
+			texCoord; /**< The location of the texture coordinate attribute in the layout of the vertex array object. */
+		int dirty; /**< Non-zero if the quads have changed since they were uploaded. */
+		char *text; /**< The text of a static mesh, to detect changes. */
+		size_t length; /**< The length of the text in bytes. */
+		float x, /**< The x-coordinate of the text of a static mesh. */
+			y; /**< The y-coordinate of the text of a static mesh. */
+	};
+
+	/** Returns a new mesh for static text, which is tessellated again only when the text changes.
+		@param font The font, which must outlive the mesh
+		@return The mesh, or \c 0 on failure */
+	struct text_mesh *create_text_mesh(const struct bmfont *font);
+
+	/** Returns a new batch for the dynamic text of a frame, which is streamed anew every time it is drawn.
+		@param font The font, which must outlive the batch
+		@return The batch, or \c 0 on failure */
+	struct text_mesh *create_text_batch(const struct bmfont *font);
+
+	/** Deletes the buffers of the mesh.
+		@param mesh The mesh or batch to free */
+	void destroy_text_mesh(struct text_mesh *mesh);
+
+	/** Sets the text of a static mesh, marking it dirty unless the text and position are unchanged.
+		@param mesh The static mesh
+		@param text The UTF-8 text
+		@param length The length of the text in bytes
+		@param x The x-coordinate of the start of the text
+		@param y The y-coordinate of the top of the first line
+		@return \c 1 on success, or \c 0 if out of memory */
+	int text_mesh_set(struct text_mesh *mesh, const char *text, size_t length, float x, float y);
+
+	/** Adds text to a batch, to be drawn with the rest at the next ::text_mesh_draw.
+		@param batch The batch
+		@param text The UTF-8 text
+		@param length The length of the text in bytes
+		@param x The x-coordinate of the start of the text
+		@param y The y-coordinate of the top of the first line
+		@return \c 1 on success, or \c 0 if out of memory */
+	int text_batch_add(struct text_mesh *batch, const char *text, size_t length, float x, float y);
+
+	/** Uploads the quads if they are dirty and draws them with one call per font page.
+		Batches are emptied afterwards. The shader program must be in use. The layout is kept in the vertex array object of the mesh, which is left bound.
+		@param mesh The mesh or batch
+		@param textures The texture of every font page, bound to the active texture unit in turn
+		@param position The attribute location of the position
+		@param texCoord The attribute location of the texture coordinate */
+	void text_mesh_draw(struct text_mesh *mesh, const GLuint *textures, GLint position, GLint texCoord);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,71 @@
+/** A fixed-size pool of worker threads and the synchronization primitives it is built on.
+	@file threadpool.h */
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <pthread.h>
+#endif
+
+	/** A mutual exclusion lock. */
+	struct mutex {
+#ifdef _WIN32
+		CRITICAL_SECTION handle;
+#else
+		pthread_mutex_t handle;
+#endif
+	};
+
+	void mutex_init(struct mutex *mutex);
+
+	void mutex_destroy(struct mutex *mutex);
+
+	void mutex_lock(struct mutex *mutex);
+
+	void mutex_unlock(struct mutex *mutex);
+
+	struct threadpool;
+
+	/** Returns a new pool of worker threads.
+		@param threads The number of threads, or \c 0 for one per processor
+		@return A new thread pool, or \c 0 on failure */
+	struct threadpool *create_threadpool(int threads);
+
+	/** Runs all queued tasks to completion and then stops the threads.
+		@param pool The pool to free */
+	void destroy_threadpool(struct threadpool *pool);
+
+	/** Returns the number of worker threads in the pool. */
+	int threadpool_size(const struct threadpool *pool);
+
+	/** Queues a function to be called on a worker thread.
+		@param pool The thread pool
+		@param function The function to call
+		@param arg The argument to pass to \a function
+		@return \c 1 if the task was queued, otherwise \c 0 */
+	int threadpool_submit(struct threadpool *pool, void (*function)(void *arg), void *arg);
+
+	/** Blocks until every queued task has finished.
+		@param pool The thread pool */
+	void threadpool_wait(struct threadpool *pool);
+
+	/** Calls \a function for every index in <tt>[0, count)</tt>, spread over the pool and the calling thread.
+		Returns once all calls have finished. May be called from within a task.
+		@param pool The thread pool, or \c 0 to run serially on the calling thread
+		@param count The number of indices
+		@param function The function to call
+		@param arg The first argument to pass to \a function */
+	void threadpool_parallel_for(struct threadpool *pool, int count, void (*function)(void *arg, int i), void *arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,435 @@
+#include "atlas.h"
+#include "bitmap_dds.h"
+#include "glh.h"
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+struct rect {
+	int x, y, width, height;
+};
+
+/** A horizontal segment of the skyline, the top of the packed area below it. */
+struct segment {
+	int x, y, width;
+};
+
+struct page {
+	struct segment *skyline; /**< The segments from left to right, spanning the width of the page. */
+	int segmentCount, segmentCapacity, lowest; /**< The height of the lowest segment, to skip pages that are full. */
+	struct rect *free; /**< Free rectangles below the skyline, left by removed sprites or passed over by the skyline. */
+	int freeCount, freeCapacity;
+	GLuint texture;
+};
+
+struct atlas {
+	int pageWidth, pageHeight, alignment, padding;
+	GLenum internalformat;
+	struct page *pages;
+	int pageCount;
+	struct atlas_sprite *sprites; /**< Indexed by id. The x of unused ids links to the next unused id. */
+	int spriteCount, spriteCapacity, freeSprite;
+	int minSize; /**< The smallest padded side of any sprite inserted so far. */
+};
+
+static const struct atlas_sprite unusedSprite = { -1, 0, 0, 0, 0, 0, 0, 0, 0 };
+
+static int isCompressed(GLenum internalformat) {
+	switch (internalformat) {
+	case GL_COMPRESSED_RGB_S3TC_DXT1_EXT: case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT: case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT: case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+	case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT: case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT: case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT: case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+	case GL_COMPRESSED_RED_RGTC1: case GL_COMPRESSED_SIGNED_RED_RGTC1: case GL_COMPRESSED_RG_RGTC2: case GL_COMPRESSED_SIGNED_RG_RGTC2:
+	case GL_COMPRESSED_RGBA_BPTC_UNORM: case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM: case GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT: case GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+/** Grows an array to hold at least \a count elements, doubling the capacity. */
+static int reserve(void **array, int *capacity, int count, size_t elementSize) {
+	if (count <= *capacity) return 1;
+	int newCapacity = *capacity > 0 ? *capacity * 2 : 16;
+	while (newCapacity < count) newCapacity *= 2;
+	void *grown = realloc(*array, newCapacity * elementSize);
+	if (grown == 0) return 0;
+	*array = grown;
+	*capacity = newCapacity;
+	return 1;
+}
+
+/** Records a free rectangle, unless it is too thin to ever hold a sprite as small as \a minSize. */
+static int addFreeRect(struct page *page, int x, int y, int width, int height, int minSize) {
+	if (width < minSize || height < minSize) return 1;
+	if (!reserve((void **) &page->free, &page->freeCapacity, page->freeCount + 1, sizeof(struct rect))) return 0;
+	page->free[page->freeCount++] = (struct rect) { x, y, width, height };
+	return 1;
+}
+
+/** Returns a freed rectangle to a page, merging it with free neighbours sharing a whole edge.
+	@return \c 0 if out of memory, leaving the page untouched */
+static int releaseRect(struct page *page, struct rect r) {
+	// Make room first, as merging changes the free rectangles
+	if (!reserve((void **) &page->free, &page->freeCapacity, page->freeCount + 1, sizeof(struct rect))) return 0;
+	for (int i = 0; i < page->freeCount;) {
+		struct rect *f = page->free + i;
+		if (f->x == r.x && f->width == r.width && (f->y + f->height == r.y || r.y + r.height == f->y)) {
+			r.height += f->height;
+			if (f->y < r.y) r.y = f->y;
+		}
+		else if (f->y == r.y && f->height == r.height && (f->x + f->width == r.x || r.x + r.width == f->x)) {
+			r.width += f->width;
+			if (f->x < r.x) r.x = f->x;
+		}
+		else {
+			i++;
+			continue;
+		}
+		// The merged rectangle may now border others; start over without the absorbed one
+		*f = page->free[--page->freeCount];
+		i = 0;
+	}
+	return addFreeRect(page, r.x, r.y, r.width, r.height, 1);
+}
+
+/** Finds the free rectangle that fits the size with the least area left over.
+	@return The index of the rectangle, or \c -1 if none fits */
+static int findFreeRect(const struct page *page, int width, int height, long *bestWaste) {
+	int best = -1;
+	for (int i = 0; i < page->freeCount; i++) {
+		const struct rect *f = page->free + i;
+		if (f->width < width || f->height < height) continue;
+		long waste = (long) f->width * f->height - (long) width * height;
+		if (waste < *bestWaste) {
+			*bestWaste = waste;
+			best = i;
+		}
+	}
+	return best;
+}
+
+/** Places the size in the bottom left corner of a free rectangle and splits the rest along the shorter leftover axis.
+	@return \c 0 if out of memory, leaving the page untouched */
+static int splitFreeRect(struct page *page, int index, int width, int height, int minSize, int *x, int *y) {
+	// The rectangle makes way for up to two
+	if (!reserve((void **) &page->free, &page->freeCapacity, page->freeCount + 1, sizeof(struct rect))) return 0;
+	struct rect f = page->free[index];
+	page->free[index] = page->free[--page->freeCount];
+	*x = f.x;
+	*y = f.y;
+	if (f.width - width < f.height - height) {
+		addFreeRect(page, f.x, f.y + height, f.width, f.height - height, minSize);
+		addFreeRect(page, f.x + width, f.y, f.width - width, height, minSize);
+	}
+	else {
+		addFreeRect(page, f.x + width, f.y, f.width - width, f.height, minSize);
+		addFreeRect(page, f.x, f.y + height, width, f.height - height, minSize);
+	}
+	return 1;
+}
+
+/** Returns the height at which a size rests on the skyline starting at a segment, or \c -1 if it does not fit on the page. */
+static int restSkyline(const struct page *page, int index, int width, int height, int pageWidth, int pageHeight) {
+	const struct segment *segment = page->skyline + index;
+	if (segment->x + width > pageWidth) return -1;
+	int y = 0;
+	for (int remaining = width; remaining > 0; segment++) {
+		if (segment->y > y) y = segment->y;
+		if (y + height > pageHeight) return -1;
+		remaining -= segment->width;
+	}
+	return y;
+}
+
+/** Finds the lowest place on the skyline, preferring narrower segments on ties.
+	@return The index of the segment to start at, or \c -1 if the size does not fit */
+static int findSkyline(const struct page *page, int width, int height, int pageWidth, int pageHeight, int *y) {
+	int best = -1, bestTop = pageHeight + 1, bestWidth = 0;
+	if (page->lowest + height > pageHeight) return -1;
+	for (int i = 0; i < page->segmentCount; i++) {
+		int rest = restSkyline(page, i, width, height, pageWidth, pageHeight);
+		if (rest < 0) continue;
+		int top = rest + height;
+		if (top < bestTop || (top == bestTop && page->skyline[i].width < bestWidth)) {
+			best = i;
+			bestTop = top;
+			bestWidth = page->skyline[i].width;
+			*y = rest;
+		}
+	}
+	return best;
+}
+
+/** Raises the skyline over the placed size, keeping the gaps left below it as free rectangles.
+	@return \c 0 if out of memory, leaving the page untouched */
+static int placeSkyline(struct page *page, int index, int width, int height, int y, int minSize) {
+	int x = page->skyline[index].x, right = x + width, covered = 0;
+	while (index + covered < page->segmentCount && page->skyline[index + covered].x < right) covered++;
+	// Make room for the new segment and a gap under every covered one before changing anything
+	if (!reserve((void **) &page->skyline, &page->segmentCapacity, page->segmentCount + 1, sizeof(struct segment))
+		|| !reserve((void **) &page->free, &page->freeCapacity, page->freeCount + covered, sizeof(struct rect))) return 0;
+	struct segment *skyline = page->skyline;
+	for (int i = index; i < index + covered; i++) {
+		int end = skyline[i].x + skyline[i].width;
+		addFreeRect(page, skyline[i].x, skyline[i].y, (end < right ? end : right) - skyline[i].x, y - skyline[i].y, minSize);
+	}
+
+	memmove(skyline + index + 1, skyline + index, (page->segmentCount - index) * sizeof(struct segment));
+	skyline[index] = (struct segment) { x, y + height, width };
+	page->segmentCount++;
+
+	// Trim the segments now covered by the new one
+	int i = index + 1;
+	while (i < page->segmentCount && skyline[i].x < right) {
+		int shrink = right - skyline[i].x;
+		if (shrink < skyline[i].width) {
+			skyline[i].x += shrink;
+			skyline[i].width -= shrink;
+			break;
+		}
+		memmove(skyline + i, skyline + i + 1, (page->segmentCount - i - 1) * sizeof(struct segment));
+		page->segmentCount--;
+	}
+
+	// Merge neighbours of equal height
+	for (i = index > 0 ? index - 1 : 0; i + 1 < page->segmentCount && i <= index + 1;) {
+		if (skyline[i].y == skyline[i + 1].y) {
+			skyline[i].width += skyline[i + 1].width;
+			memmove(skyline + i + 1, skyline + i + 2, (page->segmentCount - i - 2) * sizeof(struct segment));
+			page->segmentCount--;
+		}
+		else i++;
+	}
+
+	page->lowest = skyline[0].y;
+	for (i = 1; i < page->segmentCount; i++) if (skyline[i].y < page->lowest) page->lowest = skyline[i].y;
+	return 1;
+}
+
+static int addPage(struct atlas *atlas) {
+	struct page *pages = realloc(atlas->pages, (atlas->pageCount + 1) * sizeof(struct page));
+	if (pages == 0) return 0;
+	atlas->pages = pages;
+	struct page *page = pages + atlas->pageCount;
+	memset(page, 0, sizeof(struct page));
+	if (!reserve((void **) &page->skyline, &page->segmentCapacity, 1, sizeof(struct segment))) return 0;
+	page->skyline[0] = (struct segment) { 0, 0, atlas->pageWidth };
+	page->segmentCount = 1;
+
+	if (atlas->internalformat != 0) {
+		glGenTextures(1, &page->texture);
+		glh_bind_texture(GL_TEXTURE_2D, page->texture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		if (GLEW_ARB_texture_storage) glTexStorage2D(GL_TEXTURE_2D, 1, atlas->internalformat, atlas->pageWidth, atlas->pageHeight);
+		else glTexImage2D(GL_TEXTURE_2D, 0, atlas->internalformat, atlas->pageWidth, atlas->pageHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+	}
+	atlas->pageCount++;
+	return 1;
+}
+
+static void removeLastPage(struct atlas *atlas) {
+	struct page *page = atlas->pages + --atlas->pageCount;
+	if (page->texture != 0) glh_delete_textures(1, &page->texture);
+	free(page->skyline);
+	free(page->free);
+}
+
+static int align(int size, int alignment) {
+	return (size + alignment - 1) / alignment * alignment;
+}
+
+struct atlas *create_atlas(int pageWidth, int pageHeight, GLenum internalformat, int padding) {
+	if (pageWidth <= 0 || pageHeight <= 0 || padding < 0) return 0;
+	struct atlas *atlas = calloc(1, sizeof(struct atlas));
+	if (atlas == 0) return 0;
+	atlas->pageWidth = pageWidth;
+	atlas->pageHeight = pageHeight;
+	atlas->internalformat = internalformat;
+	// Compressed sprites must start and end on block boundaries to be copied as blocks
+	atlas->alignment = isCompressed(internalformat) ? 4 : 1;
+	atlas->padding = align(padding, atlas->alignment);
+	atlas->freeSprite = -1;
+	atlas->minSize = INT_MAX;
+	return atlas;
+}
+
+void destroy_atlas(struct atlas *atlas) {
+	for (int i = 0; i < atlas->pageCount; i++) {
+		struct page *page = atlas->pages + i;
+		if (page->texture != 0) glh_delete_textures(1, &page->texture);
+		free(page->skyline);
+		free(page->free);
+	}
+	free(atlas->pages);
+	free(atlas->sprites);
+	free(atlas);
+}
+
+/** Returns the rectangle a sprite occupies on its page, including padding and alignment.
+	Rooms start on the alignment, which lets a sprite sit anywhere within the last block of its room. */
+static struct rect getRect(const struct atlas *atlas, const struct atlas_sprite *sprite) {
+	struct rect r;
+	r.x = (sprite->x - atlas->padding) / atlas->alignment * atlas->alignment;
+	r.y = (sprite->y - atlas->padding) / atlas->alignment * atlas->alignment;
+	r.width = align(sprite->x + sprite->width + atlas->padding, atlas->alignment) - r.x;
+	r.height = align(sprite->y + sprite->height + atlas->padding, atlas->alignment) - r.y;
+	return r;
+}
+
+/** Sets the texture coordinates of a sprite from its position. */
+static void setTexCoords(const struct atlas *atlas, struct atlas_sprite *sprite) {
+	sprite->u0 = (float) sprite->x / atlas->pageWidth;
+	sprite->v0 = (float) sprite->y / atlas->pageHeight;
+	sprite->u1 = (float) (sprite->x + sprite->width) / atlas->pageWidth;
+	sprite->v1 = (float) (sprite->y + sprite->height) / atlas->pageHeight;
+}
+
+int atlas_insert(struct atlas *atlas, int width, int height) {
+	int w = align(width + 2 * atlas->padding, atlas->alignment), h = align(height + 2 * atlas->padding, atlas->alignment);
+	if (width <= 0 || height <= 0 || w > atlas->pageWidth || h > atlas->pageHeight) return -1;
+	if (w < atlas->minSize) atlas->minSize = w;
+	if (h < atlas->minSize) atlas->minSize = h;
+
+	// Take an id before placing, so that failure leaves the pages untouched
+	int id = atlas->freeSprite;
+	if (id < 0) {
+		if (!reserve((void **) &atlas->sprites, &atlas->spriteCapacity, atlas->spriteCount + 1, sizeof(struct atlas_sprite))) return -1;
+		id = atlas->spriteCount;
+	}
+
+	// Fill holes first, then rest on the skyline of the first page with room
+	int pageIndex = -1, x, y, best = -1, added = 0;
+	long bestWaste = (long) atlas->pageWidth * atlas->pageHeight;
+	for (int i = 0; i < atlas->pageCount; i++) {
+		int found = findFreeRect(atlas->pages + i, w, h, &bestWaste);
+		if (found >= 0) {
+			pageIndex = i;
+			best = found;
+		}
+	}
+	if (best >= 0) {
+		if (!splitFreeRect(atlas->pages + pageIndex, best, w, h, atlas->minSize, &x, &y)) return -1;
+	}
+	else {
+		for (pageIndex = 0; pageIndex < atlas->pageCount; pageIndex++) {
+			best = findSkyline(atlas->pages + pageIndex, w, h, atlas->pageWidth, atlas->pageHeight, &y);
+			if (best >= 0) break;
+		}
+		if (best < 0) {
+			if (!addPage(atlas)) return -1;
+			added = 1;
+			pageIndex = atlas->pageCount - 1;
+			best = 0;
+			y = 0;
+		}
+		struct page *page = atlas->pages + pageIndex;
+		x = page->skyline[best].x;
+		if (!placeSkyline(page, best, w, h, y, atlas->minSize)) {
+			// Drop a page added for the sprite, rather than keep it empty
+			if (added) removeLastPage(atlas);
+			return -1;
+		}
+	}
+
+	if (id == atlas->spriteCount) atlas->spriteCount++;
+	else atlas->freeSprite = atlas->sprites[id].x;
+	struct atlas_sprite *sprite = atlas->sprites + id;
+	sprite->page = pageIndex;
+	sprite->x = x + atlas->padding;
+	sprite->y = y + atlas->padding;
+	sprite->width = width;
+	sprite->height = height;
+	setTexCoords(atlas, sprite);
+	return id;
+}
+
+int atlas_add_image(struct atlas *atlas, int width, int height, GLenum format, GLenum type, const void *pixels) {
+	if (atlas->internalformat == 0 || atlas->alignment != 1) return -1;
+	int id = atlas_insert(atlas, width, height);
+	if (id < 0) return -1;
+	const struct atlas_sprite *sprite = atlas->sprites + id;
+	glh_bind_texture(GL_TEXTURE_2D, atlas->pages[sprite->page].texture);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, sprite->x, sprite->y, width, height, format, type, pixels);
+	return id;
+}
+
+/** Copies the top level of a 2D DDS image, flipped vertically, and describes the copy as a single level image. */
+static char *copyFlipped(struct dds_image *image, const char *data) {
+	const struct dds_mipmap *top = image->mipmaps;
+	char *pixels = malloc(top->size);
+	if (pixels == 0) return 0;
+	const char *source = data + top->offset;
+	image->levels = 1;
+	image->mipmaps[0].offset = 0;
+	if (image->compressed) {
+		memcpy(pixels, source, top->size);
+		dds_flip(image, pixels);
+	}
+	else {
+		size_t row = top->size / top->height;
+		for (unsigned int y = 0; y < top->height; y++) memcpy(pixels + y * row, source + (top->height - 1 - y) * row, row);
+	}
+	return pixels;
+}
+
+int atlas_add_dds(struct atlas *atlas, const char *data, size_t size, int flags) {
+	struct dds_image image;
+	if (atlas->internalformat == 0 || !dds_parse(data, size, &image) || image.target != GL_TEXTURE_2D) return -1;
+	image.levels = 1;
+	if (image.compressed && image.internalformat != atlas->internalformat) {
+		// Only decompressed images can be converted on upload
+		if (atlas->alignment != 1) return -1;
+		struct dds_image decompressed;
+		char *pixels = dds_decompress(&image, data, flags, &decompressed, 0);
+		if (pixels == 0) return -1;
+		int id = atlas_add_image(atlas, decompressed.width, decompressed.height, decompressed.format, decompressed.type, pixels);
+		free(pixels);
+		return id;
+	}
+	if (!image.compressed && atlas->alignment != 1) return -1;
+
+	char *flipped = 0;
+	const char *pixels = data + image.mipmaps[0].offset;
+	if ((flags & DDS_FLIP_UVS) && (pixels = flipped = copyFlipped(&image, data)) == 0) return -1;
+	int id;
+	if (image.compressed) {
+		if ((id = atlas_insert(atlas, image.width, image.height)) >= 0) {
+			// Whole blocks are copied, which the block aligned room has space for
+			struct atlas_sprite *sprite = atlas->sprites + id;
+			glh_bind_texture(GL_TEXTURE_2D, atlas->pages[sprite->page].texture);
+			glCompressedTexSubImage2D(GL_TEXTURE_2D, 0, sprite->x, sprite->y, align(image.width, 4), align(image.height, 4), image.internalformat, (GLsizei) image.mipmaps[0].size, pixels);
+			if (flipped != 0) {
+				// Flipping whole blocks moves the rows past the image from the top of the last block row to the bottom of the first
+				sprite->y += align(image.height, 4) - image.height;
+				setTexCoords(atlas, sprite);
+			}
+		}
+	}
+	else id = atlas_add_image(atlas, image.width, image.height, image.format, image.type, pixels);
+	free(flipped);
+	return id;
+}
+
+int atlas_remove(struct atlas *atlas, int id) {
+	if (id < 0 || id >= atlas->spriteCount || atlas->sprites[id].page < 0) return 0;
+	struct atlas_sprite *sprite = atlas->sprites + id;
+	if (!releaseRect(atlas->pages + sprite->page, getRect(atlas, sprite))) return 0;
+	sprite->page = -1;
+	sprite->x = atlas->freeSprite;
+	atlas->freeSprite = id;
+	return 1;
+}
+
+const struct atlas_sprite *atlas_get(const struct atlas *atlas, int id) {
+	if (id < 0 || id >= atlas->spriteCount || atlas->sprites[id].page < 0) return &unusedSprite;
+	return atlas->sprites + id;
+}
+
+int atlas_page_count(const struct atlas *atlas) {
+	return atlas->pageCount;
+}
+
+GLuint atlas_page_texture(const struct atlas *atlas, int page) {
+	return page >= 0 && page < atlas->pageCount ? atlas->pages[page].texture : 0;
+}
@@ -0,0 +1,455 @@
+#include "bcn.h"
+#include <string.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <math.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+#define MIN(a, b) (((a) < (b)) ? (a) : (b))
+#define MAX(a, b) (((a) > (b)) ? (a) : (b))
+#define CLAMP(x, lo, hi) MIN(MAX(x, lo), hi)
+
+#if defined(__SSSE3__) || defined(__AVX2__)
+/* Shuffle masks gathering a row of four pixels from a palette of four RGBA colors,
+	indexed by the byte of 2-bit indices of the row. */
+#define SHUFFLE_INDEX(r, j) (((r) >> 2 * (j) & 3) * 4)
+#define SHUFFLE_PIXEL(r, j) SHUFFLE_INDEX(r, j), SHUFFLE_INDEX(r, j) + 1, SHUFFLE_INDEX(r, j) + 2, SHUFFLE_INDEX(r, j) + 3
+#define SHUFFLE(r) { SHUFFLE_PIXEL(r, 0), SHUFFLE_PIXEL(r, 1), SHUFFLE_PIXEL(r, 2), SHUFFLE_PIXEL(r, 3) }
+#define SHUFFLE4(r) SHUFFLE(r), SHUFFLE(r + 1), SHUFFLE(r + 2), SHUFFLE(r + 3)
+#define SHUFFLE16(r) SHUFFLE4(r), SHUFFLE4(r + 4), SHUFFLE4(r + 8), SHUFFLE4(r + 12)
+#define SHUFFLE64(r) SHUFFLE16(r), SHUFFLE16(r + 16), SHUFFLE16(r + 32), SHUFFLE16(r + 48)
+
+static const unsigned char paletteShuffles[256][16] = { SHUFFLE64(0), SHUFFLE64(64), SHUFFLE64(128), SHUFFLE64(192) };
+#endif
+
+int bcn_block_size(enum bcn_format format) {
+	return format == BCN_BC1 || format == BCN_BC4 ? 8 : 16;
+}
+
+/** Computes the eight values interpolated between the endpoints of a BC3 alpha or BC4 block. */
+static void getAlphaPalette(unsigned int a0, unsigned int a1, unsigned char palette[8]) {
+	palette[0] = a0;
+	palette[1] = a1;
+	if (a0 > a1) {
+		for (int i = 1; i < 7; i++) palette[i + 1] = ((7 - i) * a0 + i * a1 + 3) / 7;
+	}
+	else {
+		for (int i = 1; i < 5; i++) palette[i + 1] = ((5 - i) * a0 + i * a1 + 2) / 5;
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+}
+
+/** Decodes the 16 3-bit indexed values of a BC3 alpha or BC4 block. */
+static void decodeAlpha(const unsigned char *block, unsigned char values[16]) {
+	unsigned char palette[8];
+	getAlphaPalette(block[0], block[1], palette);
+
+	uint64_t bits = 0;
+	for (int i = 7; i >= 2; i--) bits = bits << 8 | block[i];
+	for (int i = 0; i < 16; i++, bits >>= 3) values[i] = palette[bits & 7];
+}
+
+/** Computes the four RGBA colors of a BC1 color block with the 5:6:5 endpoints \a c0 and \a c1.
+	The punch-through alpha mode is only allowed in BC1 itself. */
+static void getColorPalette(unsigned int c0, unsigned int c1, int allowAlpha, unsigned char palette[16]) {
+	for (int i = 0; i < 2; i++) {
+		unsigned int c = i == 0 ? c0 : c1;
+		palette[4 * i] = (c >> 11) * 255 / 31;
+		palette[4 * i + 1] = (c >> 5 & 0x3f) * 255 / 63;
+		palette[4 * i + 2] = (c & 0x1f) * 255 / 31;
+		palette[4 * i + 3] = 255;
+	}
+	for (int k = 0; k < 3; k++) {
+		if (c0 > c1 || !allowAlpha) {
+			palette[8 + k] = (2 * palette[k] + palette[4 + k]) / 3;
+			palette[12 + k] = (palette[k] + 2 * palette[4 + k]) / 3;
+		}
+		else {
+			palette[8 + k] = (palette[k] + palette[4 + k]) / 2;
+			palette[12 + k] = 0;
+		}
+	}
+	palette[11] = 255;
+	palette[15] = c0 > c1 || !allowAlpha ? 255 : 0; // Transparent black
+}
+
+/** Decodes a BC1 color block. */
+static void decodeColor(const unsigned char *block, int allowAlpha, unsigned char rgba[64]) {
+	unsigned char palette[16];
+	getColorPalette(block[0] | block[1] << 8, block[2] | block[3] << 8, allowAlpha, palette);
+
+#if defined(__SSSE3__) || defined(__AVX2__)
+	__m128i colors = _mm_loadu_si128((const __m128i *) palette);
+	for (int row = 0; row < 4; row++) {
+		__m128i mask = _mm_loadu_si128((const __m128i *) paletteShuffles[block[4 + row]]);
+		_mm_storeu_si128((__m128i *) (rgba + 16 * row), _mm_shuffle_epi8(colors, mask));
+	}
+#else
+	for (int i = 0; i < 16; i++) memcpy(rgba + 4 * i, palette + 4 * (block[4 + i / 4] >> 2 * (i % 4) & 3), 4);
+#endif
+}
+
+void bcn_decode_block(enum bcn_format format, const unsigned char *block, unsigned char rgba[64]) {
+	unsigned char values[16];
+	switch (format) {
+	case BCN_BC1:
+		decodeColor(block, 1, rgba);
+		break;
+	case BCN_BC2:
+		decodeColor(block + 8, 0, rgba);
+		for (int i = 0; i < 16; i++) rgba[4 * i + 3] = (block[i / 2] >> 4 * (i % 2) & 0xf) * 17;
+		break;
+	case BCN_BC3:
+		decodeColor(block + 8, 0, rgba);
+		decodeAlpha(block, values);
+		for (int i = 0; i < 16; i++) rgba[4 * i + 3] = values[i];
+		break;
+	case BCN_BC4:
+	case BCN_BC5:
+		memset(rgba, 0, 64);
+		decodeAlpha(block, values);
+		for (int i = 0; i < 16; i++) rgba[4 * i] = values[i];
+		if (format == BCN_BC5) {
+			decodeAlpha(block + 8, values);
+			for (int i = 0; i < 16; i++) rgba[4 * i + 1] = values[i];
+		}
+		for (int i = 0; i < 16; i++) rgba[4 * i + 3] = 255;
+		break;
+	}
+}
+
+struct decode_job {
+	enum bcn_format format;
+	const unsigned char *blocks;
+	unsigned int width, height;
+	unsigned char *rgba;
+	ptrdiff_t stride;
+};
+
+static void decodeRow(void *arg, int y) {
+	const struct decode_job *job = arg;
+	int blockSize = bcn_block_size(job->format);
+	unsigned int blocksWide = (job->width + 3) / 4, rows = MIN(4, job->height - 4 * y);
+	const unsigned char *block = job->blocks + (size_t) y * blocksWide * blockSize;
+	unsigned char *row = job->rgba + 4 * y * job->stride;
+	for (unsigned int x = 0; x < blocksWide; x++, block += blockSize) {
+		unsigned char pixels[64];
+		bcn_decode_block(job->format, block, pixels);
+		// Blocks at the right and bottom edges may be partial
+		size_t columns = MIN(4, job->width - 4 * x);
+		for (unsigned int j = 0; j < rows; j++) memcpy(row + j * job->stride + 16 * x, pixels + 16 * j, 4 * columns);
+	}
+}
+
+void bcn_decode(enum bcn_format format, const void *blocks, unsigned int width, unsigned int height, unsigned char *rgba, ptrdiff_t stride, struct threadpool *pool) {
+	struct decode_job job = { format, blocks, width, height, rgba, stride };
+	threadpool_parallel_for(pool, (height + 3) / 4, decodeRow, &job);
+}
+
+/** Returns the squared distance between two RGB colors. */
+static int colorDistance(const unsigned char *a, const unsigned char *b) {
+	int dr = a[0] - b[0], dg = a[1] - b[1], db = a[2] - b[2];
+	return dr * dr + dg * dg + db * db;
+}
+
+/** Rounds an RGB color to 5:6:5. */
+static unsigned int to565(int r, int g, int b) {
+	r = CLAMP(r, 0, 255), g = CLAMP(g, 0, 255), b = CLAMP(b, 0, 255);
+	return (r * 31 + 127) / 255 << 11 | (g * 63 + 127) / 255 << 5 | (b * 31 + 127) / 255;
+}
+
+/** Finds the per-channel bounds of the opaque pixels of a block. */
+static void getBounds(const unsigned char rgba[64], int skipTransparent, unsigned char min[4], unsigned char max[4]) {
+#if defined(__SSE2__) || defined(_M_X64)
+	if (!skipTransparent) {
+		__m128i a = _mm_loadu_si128((const __m128i *) rgba), b = _mm_loadu_si128((const __m128i *) (rgba + 16)),
+			c = _mm_loadu_si128((const __m128i *) (rgba + 32)), d = _mm_loadu_si128((const __m128i *) (rgba + 48)),
+			lo = _mm_min_epu8(_mm_min_epu8(a, b), _mm_min_epu8(c, d)), hi = _mm_max_epu8(_mm_max_epu8(a, b), _mm_max_epu8(c, d));
+		lo = _mm_min_epu8(lo, _mm_shuffle_epi32(lo, _MM_SHUFFLE(1, 0, 3, 2)));
+		hi = _mm_max_epu8(hi, _mm_shuffle_epi32(hi, _MM_SHUFFLE(1, 0, 3, 2)));
+		lo = _mm_min_epu8(lo, _mm_shuffle_epi32(lo, _MM_SHUFFLE(2, 3, 0, 1)));
+		hi = _mm_max_epu8(hi, _mm_shuffle_epi32(hi, _MM_SHUFFLE(2, 3, 0, 1)));
+		int loBits = _mm_cvtsi128_si32(lo), hiBits = _mm_cvtsi128_si32(hi);
+		memcpy(min, &loBits, 4);
+		memcpy(max, &hiBits, 4);
+		return;
+	}
+#endif
+	memset(min, 255, 4);
+	memset(max, 0, 4);
+	for (int i = 0; i < 16; i++) {
+		const unsigned char *p = rgba + 4 * i;
+		if (skipTransparent && p[3] < 128) continue;
+		for (int k = 0; k < 4; k++) {
+			min[k] = MIN(min[k], p[k]);
+			max[k] = MAX(max[k], p[k]);
+		}
+	}
+}
+
+/** Writes a BC1 color block with the endpoints \a c0 and \a c1, picking the index of every pixel.
+	Pixels with alpha below one half are made transparent if \a allowAlpha is set.
+	@return The sum of squared errors of the opaque pixels */
+static unsigned int fitColorIndices(const unsigned char rgba[64], unsigned int c0, unsigned int c1, int allowAlpha, int exact, unsigned char block[8]) {
+	int transparent = 0;
+	if (allowAlpha) for (int i = 0; i < 16; i++) transparent |= rgba[4 * i + 3] < 128;
+	// The order of the endpoints selects between the four color and the punch-through mode
+	if (transparent ? c0 > c1 : c0 < c1) {
+		unsigned int c = c0;
+		c0 = c1;
+		c1 = c;
+	}
+	unsigned char palette[16];
+	getColorPalette(c0, c1, allowAlpha, palette);
+	int colors = allowAlpha && c0 <= c1 ? 3 : 4;
+
+	// Without an exact search, project onto the line between the endpoints
+	static const unsigned char order[4] = { 1, 3, 2, 0 };
+	int axis[3] = { palette[0] - palette[4], palette[1] - palette[5], palette[2] - palette[6] },
+		length = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+	unsigned int indices = 0, error = 0;
+	for (int i = 0; i < 16; i++) {
+		const unsigned char *p = rgba + 4 * i;
+		int index = 0;
+		if (transparent && p[3] < 128) index = 3;
+		else if (!exact && colors == 4 && length > 0) {
+			int t = (p[0] - palette[4]) * axis[0] + (p[1] - palette[5]) * axis[1] + (p[2] - palette[6]) * axis[2];
+			index = order[(6 * t > length) + (6 * t > 3 * length) + (6 * t > 5 * length)];
+		}
+		else {
+			for (int j = 1, best = colorDistance(p, palette); j < colors; j++) {
+				int distance = colorDistance(p, palette + 4 * j);
+				if (distance < best) best = distance, index = j;
+			}
+		}
+		if (index != 3 || !transparent) error += colorDistance(p, palette + 4 * index);
+		indices |= (unsigned int) index << 2 * i;
+	}
+
+	block[0] = c0 & 0xff;
+	block[1] = c0 >> 8;
+	block[2] = c1 & 0xff;
+	block[3] = c1 >> 8;
+	for (int i = 0; i < 4; i++) block[4 + i] = indices >> 8 * i & 0xff;
+	return error;
+}
+
+/** Finds the principal axis of the opaque pixels and returns their extremes along it. */
+static void getPrincipalEndpoints(const unsigned char rgba[64], int skipTransparent, float e0[3], float e1[3]) {
+	float mean[3] = { 0 }, cov[6] = { 0 };
+	int n = 0;
+	for (int i = 0; i < 16; i++) {
+		const unsigned char *p = rgba + 4 * i;
+		if (skipTransparent && p[3] < 128) continue;
+		for (int k = 0; k < 3; k++) mean[k] += p[k];
+		n++;
+	}
+	if (n == 0) n = 1;
+	for (int k = 0; k < 3; k++) mean[k] /= n;
+	for (int i = 0; i < 16; i++) {
+		const unsigned char *p = rgba + 4 * i;
+		if (skipTransparent && p[3] < 128) continue;
+		float r = p[0] - mean[0], g = p[1] - mean[1], b = p[2] - mean[2];
+		cov[0] += r * r, cov[1] += r * g, cov[2] += r * b, cov[3] += g * g, cov[4] += g * b, cov[5] += b * b;
+	}
+
+	// Power iteration converges quickly on the dominant eigenvector of the covariance
+	float axis[3] = { 1, 1, 1 };
+	for (int iteration = 0; iteration < 8; iteration++) {
+		float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2],
+			y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2],
+			z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2],
+			m = MAX(fabsf(x), MAX(fabsf(y), fabsf(z)));
+		if (m == 0) break;
+		axis[0] = x / m, axis[1] = y / m, axis[2] = z / m;
+	}
+	float length = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2], lo = 0, hi = 0;
+	for (int i = 0; i < 16; i++) {
+		const unsigned char *p = rgba + 4 * i;
+		if (skipTransparent && p[3] < 128) continue;
+		float t = ((p[0] - mean[0]) * axis[0] + (p[1] - mean[1]) * axis[1] + (p[2] - mean[2]) * axis[2]) / length;
+		lo = MIN(lo, t);
+		hi = MAX(hi, t);
+	}
+	for (int k = 0; k < 3; k++) {
+		e0[k] = mean[k] + hi * axis[k];
+		e1[k] = mean[k] + lo * axis[k];
+	}
+}
+
+/** Solves for the endpoints that minimize the squared error of a four color block with fixed indices.
+	@return \c 0 if the system is singular */
+static int refineEndpoints(const unsigned char rgba[64], const unsigned char block[8], float e0[3], float e1[3]) {
+	static const float weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+	float aa = 0, ab = 0, bb = 0, ap[3] = { 0 }, bp[3] = { 0 };
+	for (int i = 0; i < 16; i++) {
+		float a = weights[block[4 + i / 4] >> 2 * (i % 4) & 3], b = 1.0f - a;
+		aa += a * a, ab += a * b, bb += b * b;
+		for (int k = 0; k < 3; k++) ap[k] += a * rgba[4 * i + k], bp[k] += b * rgba[4 * i + k];
+	}
+	float det = aa * bb - ab * ab;
+	if (fabsf(det) < 1e-6f) return 0;
+	for (int k = 0; k < 3; k++) {
+		e0[k] = (ap[k] * bb - bp[k] * ab) / det;
+		e1[k] = (bp[k] * aa - ap[k] * ab) / det;
+	}
+	return 1;
+}
+
+/** Encodes the RGB channels of a block as a BC1 color block. */
+static void encodeColor(const unsigned char rgba[64], int allowAlpha, int quality, unsigned char block[8]) {
+	int transparent = 0;
+	if (allowAlpha) for (int i = 0; i < 16; i++) transparent |= rgba[4 * i + 3] < 128;
+
+	// Inset the bounding box by a sixteenth to move the endpoints closer to the bulk of the colors
+	unsigned char min[4], max[4];
+	getBounds(rgba, transparent, min, max);
+	if (min[0] > max[0]) memset(min, 0, 4), memset(max, 0, 4); // All transparent
+	int hi[3], lo[3];
+	for (int k = 0; k < 3; k++) {
+		int inset = (max[k] - min[k]) / 16;
+		hi[k] = max[k] - inset;
+		lo[k] = min[k] + inset;
+	}
+
+	// Pick the diagonal of the box the colors run along, by the sign of their covariance with the widest channel
+	int widest = max[1] - min[1] >= max[0] - min[0] ? (max[2] - min[2] > max[1] - min[1] ? 2 : 1) : (max[2] - min[2] > max[0] - min[0] ? 2 : 0), cov[3] = { 0 };
+	for (int i = 0; i < 16; i++) {
+		const unsigned char *p = rgba + 4 * i;
+		if (transparent && p[3] < 128) continue;
+		int d = 2 * p[widest] - min[widest] - max[widest];
+		for (int k = 0; k < 3; k++) cov[k] += d * (2 * p[k] - min[k] - max[k]);
+	}
+	for (int k = 0; k < 3; k++) {
+		if (cov[k] >= 0) continue;
+		int c = hi[k];
+		hi[k] = lo[k];
+		lo[k] = c;
+	}
+	unsigned int error = fitColorIndices(rgba, to565(hi[0], hi[1], hi[2]), to565(lo[0], lo[1], lo[2]), allowAlpha, quality, block);
+	if (!quality || error == 0) return;
+
+	float e0[3], e1[3];
+	getPrincipalEndpoints(rgba, transparent, e0, e1);
+	for (int iteration = 0; iteration < 3; iteration++) {
+		unsigned char candidate[8];
+		unsigned int candidateError = fitColorIndices(rgba, to565((int) (e0[0] + 0.5f), (int) (e0[1] + 0.5f), (int) (e0[2] + 0.5f)),
+			to565((int) (e1[0] + 0.5f), (int) (e1[1] + 0.5f), (int) (e1[2] + 0.5f)), allowAlpha, 1, candidate);
+		if (candidateError < error) {
+			memcpy(block, candidate, 8);
+			error = candidateError;
+		}
+		// Least squares only applies to the four color mode, where every index has a fixed weight
+		if (transparent || (candidate[0] | candidate[1] << 8) <= (candidate[2] | candidate[3] << 8) || !refineEndpoints(rgba, candidate, e0, e1)) break;
+	}
+}
+
+/** Writes a BC3 alpha or BC4 block with the endpoints \a a0 and \a a1, picking the index of every value.
+	@return The sum of squared errors */
+static unsigned int fitAlphaIndices(const unsigned char *values, unsigned int a0, unsigned int a1, int exact, unsigned char block[8]) {
+	unsigned char palette[8];
+	getAlphaPalette(a0, a1, palette);
+	static const unsigned char order[8] = { 0, 2, 3, 4, 5, 6, 7, 1 };
+	uint64_t bits = 0;
+	unsigned int error = 0;
+	for (int i = 0; i < 16; i++) {
+		int v = values[4 * i], index = 0;
+		if (!exact && a0 > a1) index = order[(7 * (int) (a0 - MIN(MAX(v, (int) a1), (int) a0)) + (a0 - a1) / 2) / (a0 - a1)];
+		else {
+			for (int j = 1, best = abs(v - palette[0]); j < 8; j++) {
+				if (abs(v - palette[j]) < best) best = abs(v - palette[j]), index = j;
+			}
+		}
+		error += (v - palette[index]) * (v - palette[index]);
+		bits |= (uint64_t) index << 3 * i;
+	}
+
+	block[0] = a0;
+	block[1] = a1;
+	for (int i = 0; i < 6; i++) block[2 + i] = bits >> 8 * i & 0xff;
+	return error;
+}
+
+/** Encodes every fourth byte of \a values as a BC3 alpha or BC4 block. */
+static void encodeAlpha(const unsigned char *values, int quality, unsigned char block[8]) {
+	unsigned int min = 255, max = 0, innerMin = 255, innerMax = 0;
+	for (int i = 0; i < 16; i++) {
+		unsigned int v = values[4 * i];
+		min = MIN(min, v);
+		max = MAX(max, v);
+		if (v != 0 && v != 255) innerMin = MIN(innerMin, v), innerMax = MAX(innerMax, v);
+	}
+	if (min == max) {
+		fitAlphaIndices(values, max, min, 1, block);
+		return;
+	}
+	unsigned int error = fitAlphaIndices(values, max, min, quality, block);
+
+	// The six value mode spends its endpoints on the values between the exact 0 and 255
+	if (quality && error != 0 && innerMin <= innerMax) {
+		unsigned char candidate[8];
+		if (fitAlphaIndices(values, innerMin, innerMax, 1, candidate) < error) memcpy(block, candidate, 8);
+	}
+}
+
+void bcn_encode_block(enum bcn_format format, const unsigned char rgba[64], unsigned char *block, int flags) {
+	int quality = flags & BCN_QUALITY;
+	switch (format) {
+	case BCN_BC1:
+		encodeColor(rgba, 1, quality, block);
+		break;
+	case BCN_BC2:
+		for (int i = 0; i < 8; i++) block[i] = (rgba[8 * i + 3] * 15 + 127) / 255 | (rgba[8 * i + 7] * 15 + 127) / 255 << 4;
+		encodeColor(rgba, 0, quality, block + 8);
+		break;
+	case BCN_BC3:
+		encodeAlpha(rgba + 3, quality, block);
+		encodeColor(rgba, 0, quality, block + 8);
+		break;
+	case BCN_BC4:
+		encodeAlpha(rgba, quality, block);
+		break;
+	case BCN_BC5:
+		encodeAlpha(rgba, quality, block);
+		encodeAlpha(rgba + 1, quality, block + 8);
+		break;
+	}
+}
+
+struct encode_job {
+	enum bcn_format format;
+	const unsigned char *rgba;
+	unsigned int width, height;
+	ptrdiff_t stride;
+	unsigned char *blocks;
+	int flags;
+};
+
+static void encodeRow(void *arg, int y) {
+	const struct encode_job *job = arg;
+	int blockSize = bcn_block_size(job->format);
+	unsigned int blocksWide = (job->width + 3) / 4;
+	unsigned char *block = job->blocks + (size_t) y * blocksWide * blockSize;
+	for (unsigned int x = 0; x < blocksWide; x++, block += blockSize) {
+		// Replicate the last row and column into blocks at the right and bottom edges
+		unsigned char pixels[64];
+		for (unsigned int j = 0; j < 4; j++) {
+			const unsigned char *row = job->rgba + MIN(4 * y + j, job->height - 1) * job->stride;
+			if (4 * x + 4 <= job->width) memcpy(pixels + 16 * j, row + 16 * x, 16);
+			else for (unsigned int i = 0; i < 4; i++) memcpy(pixels + 16 * j + 4 * i, row + 4 * MIN(4 * x + i, job->width - 1), 4);
+		}
+		bcn_encode_block(job->format, pixels, block, job->flags);
+	}
+}
+
+void bcn_encode(enum bcn_format format, const unsigned char *rgba, unsigned int width, unsigned int height, ptrdiff_t stride, void *blocks, int flags, struct threadpool *pool) {
+	struct encode_job job = { format, rgba, width, height, stride, blocks, flags };
+	threadpool_parallel_for(pool, (height + 3) / 4, encodeRow, &job);
+}
@@ -4,11 +4,24 @@
 #include <stdint.h>
 #include <string.h>
 #include <stdio.h>
-#include <GL/glew.h>
+#include "glh.h"
+#include "bcn.h"
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
 
 #ifdef _WIN32
 #include <ddraw.h>
 #else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
 // Structures from Direct3D 9
 typedef struct _DDPIXELFORMAT {
 	int dwSize;
@@ -75,9 +88,21 @@ typedef struct _DDSURFACEDESC2
 #endif
 
 #define DDS_MAGIC 0x20534444 // "DDS "
+
+// The extended header following the legacy one if the FourCC is "DX10"
+typedef struct _DDS_HEADER_DXT10 {
+	uint32_t dxgiFormat;
+	uint32_t resourceDimension;
+	uint32_t miscFlag;
+	uint32_t arraySize;
+	uint32_t miscFlags2;
+} DDS_HEADER_DXT10;
+
+#define DDS_DIMENSION_TEXTURE2D 3
+#define DDS_DIMENSION_TEXTURE3D 4
+#define DDS_RESOURCE_MISC_TEXTURECUBE 0x4
 #define MIN(a, b) (((a) < (b)) ? (a) : (b))
 #define MAX(a, b) (((a) > (b)) ? (a) : (b))
-#define MAX_LEVELS (1 + log2(GL_MAX_TEXTURE_SIZE))
 #define ISBITMASK(r, g, b, a) (ddpf.dwRBitMask == r && ddpf.dwGBitMask == g && ddpf.dwBBitMask == b && ddpf.dwRGBAlphaBitMask == a)
 
 static GLenum getFormat(const DDPIXELFORMAT ddpf, int *bitsPerPixel, int *compressed) {
@@ -113,6 +138,14 @@ static GLenum getFormat(const DDPIXELFORMAT ddpf, int *bitsPerPixel, int *compre
 			*compressed = 1;
 			return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
 		}
+		if (MAKEFOURCC('A', 'T', 'I', '1') == ddpf.dwFourCC || MAKEFOURCC('B', 'C', '4', 'U') == ddpf.dwFourCC) {
+			*compressed = 1;
+			return GL_COMPRESSED_RED_RGTC1;
+		}
+		if (MAKEFOURCC('A', 'T', 'I', '2') == ddpf.dwFourCC || MAKEFOURCC('B', 'C', '5', 'U') == ddpf.dwFourCC) {
+			*compressed = 1;
+			return GL_COMPRESSED_RG_RGTC2;
+		}
 		// Check for D3DFORMAT enums being set here
 		switch (ddpf.dwFourCC) {
 		case 36: return GL_RGBA16; // D3DFMT_A16B16G16R16
@@ -129,6 +162,92 @@ static GLenum getFormat(const DDPIXELFORMAT ddpf, int *bitsPerPixel, int *compre
 	return 0;
 }
 
+/** Returns the pixel transfer format and type of uncompressed data, along with the number of bits per pixel. */
+static int getTransfer(GLenum internalformat, GLenum *format, GLenum *type) {
+	switch (internalformat) {
+	case GL_RGBA8: *format = GL_RGBA; *type = GL_UNSIGNED_BYTE; return 32;
+	case GL_BGRA: *format = GL_BGRA; *type = GL_UNSIGNED_BYTE; return 32;
+	case GL_RGB10_A2: *format = GL_RGBA; *type = GL_UNSIGNED_INT_2_10_10_10_REV; return 32;
+	case GL_RG16: *format = GL_RG; *type = GL_UNSIGNED_SHORT; return 32;
+	case GL_RGB8: *format = GL_BGR; *type = GL_UNSIGNED_BYTE; return 24; // D3DFMT_R8G8B8 is stored blue first
+	case GL_RGBA16: *format = GL_RGBA; *type = GL_UNSIGNED_SHORT; return 64;
+	case GL_RGBA16_SNORM: *format = GL_RGBA; *type = GL_SHORT; return 64;
+	case GL_R16F: *format = GL_RED; *type = GL_HALF_FLOAT; return 16;
+	case GL_RG16F: *format = GL_RG; *type = GL_HALF_FLOAT; return 32;
+	case GL_RGBA16F: *format = GL_RGBA; *type = GL_HALF_FLOAT; return 64;
+	case GL_R32F: *format = GL_RED; *type = GL_FLOAT; return 32;
+	case GL_RG32F: *format = GL_RG; *type = GL_FLOAT; return 64;
+	case GL_RGBA32F: *format = GL_RGBA; *type = GL_FLOAT; return 128;
+	}
+	return 0;
+}
+
+/** The DXGI formats of the extended header that map onto OpenGL, with no pixel transfer format if block compressed. */
+static const struct {
+	unsigned int dxgiFormat;
+	GLenum internalformat, format, type;
+	int bitsPerPixel;
+} dxgiFormats[] = {
+	{ 2, GL_RGBA32F, GL_RGBA, GL_FLOAT, 128 }, // DXGI_FORMAT_R32G32B32A32_FLOAT
+	{ 10, GL_RGBA16F, GL_RGBA, GL_HALF_FLOAT, 64 }, // DXGI_FORMAT_R16G16B16A16_FLOAT
+	{ 11, GL_RGBA16, GL_RGBA, GL_UNSIGNED_SHORT, 64 }, // DXGI_FORMAT_R16G16B16A16_UNORM
+	{ 13, GL_RGBA16_SNORM, GL_RGBA, GL_SHORT, 64 }, // DXGI_FORMAT_R16G16B16A16_SNORM
+	{ 16, GL_RG32F, GL_RG, GL_FLOAT, 64 }, // DXGI_FORMAT_R32G32_FLOAT
+	{ 24, GL_RGB10_A2, GL_RGBA, GL_UNSIGNED_INT_2_10_10_10_REV, 32 }, // DXGI_FORMAT_R10G10B10A2_UNORM
+	{ 26, GL_R11F_G11F_B10F, GL_RGB, GL_UNSIGNED_INT_10F_11F_11F_REV, 32 }, // DXGI_FORMAT_R11G11B10_FLOAT
+	{ 28, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, 32 }, // DXGI_FORMAT_R8G8B8A8_UNORM
+	{ 29, GL_SRGB8_ALPHA8, GL_RGBA, GL_UNSIGNED_BYTE, 32 }, // DXGI_FORMAT_R8G8B8A8_UNORM_SRGB
+	{ 34, GL_RG16F, GL_RG, GL_HALF_FLOAT, 32 }, // DXGI_FORMAT_R16G16_FLOAT
+	{ 35, GL_RG16, GL_RG, GL_UNSIGNED_SHORT, 32 }, // DXGI_FORMAT_R16G16_UNORM
+	{ 41, GL_R32F, GL_RED, GL_FLOAT, 32 }, // DXGI_FORMAT_R32_FLOAT
+	{ 49, GL_RG8, GL_RG, GL_UNSIGNED_BYTE, 16 }, // DXGI_FORMAT_R8G8_UNORM
+	{ 54, GL_R16F, GL_RED, GL_HALF_FLOAT, 16 }, // DXGI_FORMAT_R16_FLOAT
+	{ 56, GL_R16, GL_RED, GL_UNSIGNED_SHORT, 16 }, // DXGI_FORMAT_R16_UNORM
+	{ 61, GL_R8, GL_RED, GL_UNSIGNED_BYTE, 8 }, // DXGI_FORMAT_R8_UNORM
+	{ 71, GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, 0, 0, 0 }, // DXGI_FORMAT_BC1_UNORM
+	{ 72, GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT, 0, 0, 0 }, // DXGI_FORMAT_BC1_UNORM_SRGB
+	{ 74, GL_COMPRESSED_RGBA_S3TC_DXT3_EXT, 0, 0, 0 }, // DXGI_FORMAT_BC2_UNORM
+	{ 75, GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT, 0, 0, 0 }, // DXGI_FORMAT_BC2_UNORM_SRGB
+	{ 77, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, 0, 0, 0 }, // DXGI_FORMAT_BC3_UNORM
+	{ 78, GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT, 0, 0, 0 }, // DXGI_FORMAT_BC3_UNORM_SRGB
+	{ 80, GL_COMPRESSED_RED_RGTC1, 0, 0, 0 }, // DXGI_FORMAT_BC4_UNORM
+	{ 81, GL_COMPRESSED_SIGNED_RED_RGTC1, 0, 0, 0 }, // DXGI_FORMAT_BC4_SNORM
+	{ 83, GL_COMPRESSED_RG_RGTC2, 0, 0, 0 }, // DXGI_FORMAT_BC5_UNORM
+	{ 84, GL_COMPRESSED_SIGNED_RG_RGTC2, 0, 0, 0 }, // DXGI_FORMAT_BC5_SNORM
+	{ 87, GL_RGBA8, GL_BGRA, GL_UNSIGNED_BYTE, 32 }, // DXGI_FORMAT_B8G8R8A8_UNORM
+	{ 91, GL_SRGB8_ALPHA8, GL_BGRA, GL_UNSIGNED_BYTE, 32 }, // DXGI_FORMAT_B8G8R8A8_UNORM_SRGB
+	{ 95, GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT, 0, 0, 0 }, // DXGI_FORMAT_BC6H_UF16
+	{ 96, GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT, 0, 0, 0 }, // DXGI_FORMAT_BC6H_SF16
+	{ 98, GL_COMPRESSED_RGBA_BPTC_UNORM, 0, 0, 0 }, // DXGI_FORMAT_BC7_UNORM
+	{ 99, GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM, 0, 0, 0 } // DXGI_FORMAT_BC7_UNORM_SRGB
+};
+
+/** Fills in the formats of a DXGI format, returning \c 0 if it is unsupported. */
+static int getDXGIFormat(unsigned int dxgiFormat, struct dds_image *image) {
+	for (size_t i = 0; i < sizeof dxgiFormats / sizeof *dxgiFormats; i++) {
+		if (dxgiFormats[i].dxgiFormat != dxgiFormat) continue;
+		image->internalformat = dxgiFormats[i].internalformat;
+		image->format = dxgiFormats[i].format;
+		image->type = dxgiFormats[i].type;
+		image->bitsPerPixel = dxgiFormats[i].bitsPerPixel;
+		image->compressed = image->format == 0;
+		return 1;
+	}
+	return 0;
+}
+
+/** Returns the size in bytes of a 4x4 block of a compressed format. */
+static int getBlockSize(GLenum internalformat) {
+	switch (internalformat) {
+	case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+	case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT:
+	case GL_COMPRESSED_RED_RGTC1:
+	case GL_COMPRESSED_SIGNED_RED_RGTC1:
+		return 8;
+	}
+	return 16;
+}
+
 // From http://src.chromium.org/viewvc/chrome/trunk/src/o3d/core/cross/bitmap_dds.cc?view=markup&pathrev=21227
 
 /** Flips a full DXT1 block in the y direction. */
@@ -170,146 +289,787 @@ static void FlipDXT3BlockFull(unsigned char *block) {
 	FlipDXT1BlockFull(block + 8); // And flip the DXT1 block using the above function.
 }
 
-/** Flips a full DXT5 block in the y direction. */
-static void FlipDXT5BlockFull(unsigned char *block) {
-	// A DXT5 block layout is:
-	// [0]    alpha0.
-	// [1]    alpha1.
-	// [2-7]  alpha bitmap, 3 bits per pixel.
-	// [8-15] a DXT1 block.
-
-	// The alpha bitmap doesn't easily map lines to bytes, so we have to
-	// interpret it correctly.  Extracted from
-	// http://www.opengl.org/registry/specs/EXT/texture_compression_s3tc.txt :
-	//
-	//   The 6 "bits" bytes of the block are decoded into one 48-bit integer:
-	//
-	//     bits = bits_0 + 256 * (bits_1 + 256 * (bits_2 + 256 * (bits_3 +
-	//                   256 * (bits_4 + 256 * bits_5))))
-	//
-	//   bits is a 48-bit unsigned integer, from which a three-bit control code
-	//   is extracted for a texel at location (x,y) in the block using:
-	//
-	//       code(x,y) = bits[3*(4*y+x)+1..3*(4*y+x)+0]
-	//
-	//   where bit 47 is the most significant and bit 0 is the least
-	//   significant bit.
-
-	// From Chromium (source was buggy)
-	unsigned int line_0_1 = block[2] + 256 * (block[3] + 256 * block[4]);
-	unsigned int line_2_3 = block[5] + 256 * (block[6] + 256 * block[7]);
-	// swap lines 0 and 1 in line_0_1.
-	unsigned int line_1_0 = ((line_0_1 & 0x000fff) << 12) |
-		((line_0_1 & 0xfff000) >> 12);
-	// swap lines 2 and 3 in line_2_3.
-	unsigned int line_3_2 = ((line_2_3 & 0x000fff) << 12) |
-		((line_2_3 & 0xfff000) >> 12);
-	block[2] = line_3_2 & 0xff;
-	block[3] = (line_3_2 & 0xff00) >> 8;
-	block[4] = (line_3_2 & 0xff0000) >> 16;
-	block[5] = line_1_0 & 0xff;
-	block[6] = (line_1_0 & 0xff00) >> 8;
-	block[7] = (line_1_0 & 0xff0000) >> 16;
-
-	
-	FlipDXT1BlockFull(block + 8); // And flip the DXT1 block using the above function.
+/** Multiplies two sizes, returning \c 0 if the product overflows. */
+static int multiply(size_t a, size_t b, size_t *product) {
+	if (b != 0 && a > SIZE_MAX / b) return 0;
+	*product = a * b;
+	return 1;
 }
 
-GLuint dds_load_texture_from_memory(const char *data, int *imageWidth, int *imageHeight, int flags) {
+int dds_parse(const char *data, size_t size, struct dds_image *image) {
 	// Validate size of DDS file in memory
-	// if (dataSize < sizeof(uint32_t) + sizeof(DDSURFACEDESC2)) return 0;
+	if (size < sizeof(uint32_t) + sizeof(DDSURFACEDESC2)) return 0;
 
 	// Verify the type
-	if (*(const uint32_t *)data != DDS_MAGIC) return 0;
+	uint32_t magic;
+	memcpy(&magic, data, sizeof magic);
+	if (magic != DDS_MAGIC) return 0;
 
-	const DDSURFACEDESC2 header = *(const DDSURFACEDESC2 *)(data + sizeof(uint32_t));
+	DDSURFACEDESC2 header;
+	memcpy(&header, data + sizeof(uint32_t), sizeof header);
 	if (header.dwSize != sizeof(DDSURFACEDESC2) ||
 		header.ddpfPixelFormat.dwSize != sizeof(DDPIXELFORMAT)) return 0;
+	if (header.dwWidth <= 0 || header.dwHeight <= 0) return 0;
 
-	ptrdiff_t offset = sizeof(uint32_t) + sizeof(DDSURFACEDESC2);
+	size_t offset = sizeof(uint32_t) + sizeof(DDSURFACEDESC2);
+	image->width = header.dwWidth;
+	image->height = header.dwHeight;
+	image->depth = 1;
+	image->faces = 1;
+	image->layers = 1;
+	if (header.ddpfPixelFormat.dwFlags & DDPF_FOURCC && (unsigned int) header.ddpfPixelFormat.dwFourCC == MAKEFOURCC('D', 'X', '1', '0')) {
+		if (size < offset + sizeof(DDS_HEADER_DXT10)) return 0;
+		DDS_HEADER_DXT10 extension;
+		memcpy(&extension, data + offset, sizeof extension);
+		offset += sizeof extension;
+		if (!getDXGIFormat(extension.dxgiFormat, image) || extension.arraySize == 0 || extension.arraySize > 2048) return 0;
 
-	size_t width = header.dwWidth, height = header.dwHeight, depth = header.dwDepth, mipMapCount = (size_t)MIN(header.dwMipMapCount, MAX_LEVELS), arraySize = 1;
-	if (mipMapCount == 0) mipMapCount = 1;
-	if (imageWidth != 0) *imageWidth = width;
-	if (imageHeight != 0) *imageHeight = height;
-
-	int bitsPerPixel, compressed, isCubeMap = 0;
-	GLenum internalformat = getFormat(header.ddpfPixelFormat, &bitsPerPixel, &compressed);
-
-	GLenum target;
-	if (header.dwFlags & DDSD_DEPTH) {
-		target = GL_TEXTURE_3D;
+		image->layers = extension.arraySize;
+		switch (extension.resourceDimension) {
+		case DDS_DIMENSION_TEXTURE2D:
+			if (extension.miscFlag & DDS_RESOURCE_MISC_TEXTURECUBE) {
+				image->faces = 6;
+				image->target = image->layers > 1 ? GL_TEXTURE_CUBE_MAP_ARRAY : GL_TEXTURE_CUBE_MAP;
+			}
+			else image->target = image->layers > 1 ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+			break;
+		case DDS_DIMENSION_TEXTURE3D:
+			if (image->layers > 1 || header.dwDepth <= 0) return 0;
+			image->depth = header.dwDepth;
+			image->target = GL_TEXTURE_3D;
+			break;
+		default:
+			return 0; // 1D textures are unsupported
+		}
 	}
 	else {
-		if (header.ddsCaps.dwCaps2 & DDSCAPS2_CUBEMAP) {
+		if ((image->internalformat = getFormat(header.ddpfPixelFormat, &image->bitsPerPixel, &image->compressed)) == 0) return 0;
+		if (!image->compressed) {
+			if ((image->bitsPerPixel = getTransfer(image->internalformat, &image->format, &image->type)) == 0) return 0;
+			if (image->internalformat == GL_BGRA) image->internalformat = GL_RGBA8; // Immutable storage requires a sized format
+		}
+		else image->format = image->type = 0;
+
+		if (header.dwFlags & DDSD_DEPTH) {
+			if (header.dwDepth <= 0) return 0;
+			image->depth = header.dwDepth;
+			image->target = GL_TEXTURE_3D;
+		}
+		else if (header.ddsCaps.dwCaps2 & DDSCAPS2_CUBEMAP) {
 			// We require all six faces to be defined
 			if ((header.ddsCaps.dwCaps2 & DDSCAPS2_CUBEMAP_ALLFACES) != DDSCAPS2_CUBEMAP_ALLFACES) return 0;
-			isCubeMap = 1;
-			target = GL_TEXTURE_CUBE_MAP;
+			image->faces = 6;
+			image->target = GL_TEXTURE_CUBE_MAP;
 		}
-		else target = GL_TEXTURE_2D;
-		depth = 1;
+		else image->target = GL_TEXTURE_2D;
 		// Note there's no way for a legacy Direct3D 9 DDS to express a '1D' texture
 	}
-
-	int blockSize = internalformat == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT ? 8 : 16;
+	image->blockSize = image->compressed ? getBlockSize(image->internalformat) : 0;
 	// glGetInternalformativ(target, internalformat, GL_TEXTURE_COMPRESSED_BLOCK_SIZE, 1, &blockSize);
 
-	GLuint texture;
-	glGenTextures(1, &texture);
+	// Not all DDS files provide all mipmap levels, but none may have more than the full chain
+	unsigned int maxLevels = 1;
+	for (unsigned int n = MAX(MAX(image->width, image->height), image->depth); n > 1; n /= 2) maxLevels++;
+	image->levels = MIN(MAX(header.dwMipMapCount, 1), MIN(maxLevels, DDS_MAX_LEVELS));
+
+	// Each face of each array layer holds its complete mipmap chain, whose size must not overflow
+	size_t width = image->width, height = image->height, depth = image->depth;
+	image->faceSize = 0;
+	for (unsigned int i = 0; i < image->levels; i++) {
+		struct dds_mipmap *mipmap = image->mipmaps + i;
+		mipmap->offset = offset + image->faceSize;
+		mipmap->width = width;
+		mipmap->height = height;
+		mipmap->depth = depth;
+		size_t bits;
+		if (!image->compressed) {
+			if (!multiply(width, height, &bits) || !multiply(bits, depth, &bits) || !multiply(bits, image->bitsPerPixel, &bits)) return 0;
+			mipmap->size = bits / 8;
+		}
+		else if (!multiply((width + 3) / 4, (height + 3) / 4, &mipmap->size) || !multiply(mipmap->size, depth, &mipmap->size)
+			|| !multiply(mipmap->size, image->blockSize, &mipmap->size)) return 0; // size = ceil(width / 4) * ceil(height / 4) * blockSize;
+		if (mipmap->size > SIZE_MAX - offset - image->faceSize) return 0;
+		image->faceSize += mipmap->size;
+
+		// Keep size at a minimum
+		width = MAX(1, width / 2);
+		height = MAX(1, height / 2);
+		depth = MAX(1, depth / 2);
+	}
+	size_t faces;
+	if (!multiply((size_t) image->layers * image->faces, image->faceSize, &faces) || faces > SIZE_MAX - offset) return 0;
+	image->size = offset + faces;
+
+	return image->size <= size;
+}
+
+/* Whole rows of blocks are flipped at a time, as many blocks per instruction as the instruction set allows.
+	In the DXT1 color block only the order of the four bitmap bytes changes, and likewise the 16-bit lines of the DXT3 alpha bitmap.
+	The 12-bit lines of the DXT5 alpha bitmap are moved with 64-bit shifts. */
+
+#define FLIP_DXT5_ALPHA(bits) (((bits) & 0xffff) | ((bits) >> 52 & 0xfff) << 16 | ((bits) >> 40 & 0xfff) << 28 \
+	| ((bits) >> 28 & 0xfff) << 40 | ((bits) >> 16 & 0xfff) << 52)
+
+#if defined(__SSSE3__) || defined(__AVX2__)
+// Byte shuffles of one DXT1 block pair, a DXT3 block and the color half of a DXT5 block
+#define DXT1_SHUFFLE 0, 1, 2, 3, 7, 6, 5, 4, 8, 9, 10, 11, 15, 14, 13, 12
+#define DXT3_SHUFFLE 6, 7, 4, 5, 2, 3, 0, 1, 8, 9, 10, 11, 15, 14, 13, 12
+#define DXT5_SHUFFLE 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 15, 14, 13, 12
+#define SHUFFLE_MASK(...) _mm_setr_epi8(__VA_ARGS__)
+#elif defined(__SSE2__) || defined(_M_X64)
+#define SSE2_ONLY 1
+/** Reverses the bytes of the odd 32-bit lanes selected by \a mask. */
+static __m128i reverseOddDwords(__m128i x, __m128i mask) {
+	__m128i words = _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, _MM_SHUFFLE(2, 3, 1, 0)), _MM_SHUFFLE(2, 3, 1, 0)),
+		bytes = _mm_or_si128(_mm_slli_epi16(words, 8), _mm_srli_epi16(words, 8));
+	return _mm_or_si128(_mm_andnot_si128(mask, x), _mm_and_si128(mask, bytes));
+}
+#endif
+
+#ifdef __AVX2__
+static __m256i flipDXT5Alpha(__m256i x) {
+	__m256i line = _mm256_set1_epi64x(0xfff);
+	return _mm256_or_si256(_mm256_and_si256(x, _mm256_set1_epi64x(0xffff)),
+		_mm256_or_si256(_mm256_or_si256(_mm256_slli_epi64(_mm256_and_si256(_mm256_srli_epi64(x, 52), line), 16), _mm256_slli_epi64(_mm256_and_si256(_mm256_srli_epi64(x, 40), line), 28)),
+			_mm256_or_si256(_mm256_slli_epi64(_mm256_and_si256(_mm256_srli_epi64(x, 28), line), 40), _mm256_slli_epi64(_mm256_and_si256(_mm256_srli_epi64(x, 16), line), 52))));
+}
+#elif defined(__SSE2__) || defined(_M_X64)
+static __m128i flipDXT5Alpha(__m128i x) {
+	__m128i line = _mm_set1_epi64x(0xfff);
+	return _mm_or_si128(_mm_and_si128(x, _mm_set1_epi64x(0xffff)),
+		_mm_or_si128(_mm_or_si128(_mm_slli_epi64(_mm_and_si128(_mm_srli_epi64(x, 52), line), 16), _mm_slli_epi64(_mm_and_si128(_mm_srli_epi64(x, 40), line), 28)),
+			_mm_or_si128(_mm_slli_epi64(_mm_and_si128(_mm_srli_epi64(x, 28), line), 40), _mm_slli_epi64(_mm_and_si128(_mm_srli_epi64(x, 16), line), 52))));
+}
+#endif
+
+/** Flips a row of \a blocks DXT1 blocks from \a src into \a dst, which may be the same. */
+static void flipRowDXT1(unsigned char *dst, const unsigned char *src, size_t blocks) {
+	size_t i = 0;
+#ifdef __AVX2__
+	__m256i mask = _mm256_broadcastsi128_si256(SHUFFLE_MASK(DXT1_SHUFFLE));
+	for (; i + 4 <= blocks; i += 4) _mm256_storeu_si256((__m256i *) (dst + 8 * i), _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i *) (src + 8 * i)), mask));
+#elif defined(__SSSE3__)
+	__m128i mask = SHUFFLE_MASK(DXT1_SHUFFLE);
+	for (; i + 2 <= blocks; i += 2) _mm_storeu_si128((__m128i *) (dst + 8 * i), _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (src + 8 * i)), mask));
+#elif defined(SSE2_ONLY)
+	__m128i mask = _mm_set_epi32(-1, 0, -1, 0);
+	for (; i + 2 <= blocks; i += 2) _mm_storeu_si128((__m128i *) (dst + 8 * i), reverseOddDwords(_mm_loadu_si128((const __m128i *) (src + 8 * i)), mask));
+#endif
+	for (; i < blocks; i++) {
+		unsigned char block[8];
+		memcpy(block, src + 8 * i, 8);
+		FlipDXT1BlockFull(block);
+		memcpy(dst + 8 * i, block, 8);
+	}
+}
+
+/** Flips a row of \a blocks DXT3 blocks from \a src into \a dst, which may be the same. */
+static void flipRowDXT3(unsigned char *dst, const unsigned char *src, size_t blocks) {
+	size_t i = 0;
+#ifdef __AVX2__
+	__m256i mask = _mm256_broadcastsi128_si256(SHUFFLE_MASK(DXT3_SHUFFLE));
+	for (; i + 2 <= blocks; i += 2) _mm256_storeu_si256((__m256i *) (dst + 16 * i), _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i *) (src + 16 * i)), mask));
+#elif defined(__SSSE3__)
+	__m128i mask = SHUFFLE_MASK(DXT3_SHUFFLE);
+	for (; i < blocks; i++) _mm_storeu_si128((__m128i *) (dst + 16 * i), _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (src + 16 * i)), mask));
+#elif defined(SSE2_ONLY)
+	__m128i mask = _mm_set_epi32(-1, 0, 0, 0);
+	for (; i < blocks; i++) {
+		__m128i x = _mm_loadu_si128((const __m128i *) (src + 16 * i));
+		_mm_storeu_si128((__m128i *) (dst + 16 * i), reverseOddDwords(_mm_shufflelo_epi16(x, _MM_SHUFFLE(0, 1, 2, 3)), mask));
+	}
+#endif
+	for (; i < blocks; i++) {
+		unsigned char block[16];
+		memcpy(block, src + 16 * i, 16);
+		FlipDXT3BlockFull(block);
+		memcpy(dst + 16 * i, block, 16);
+	}
+}
+
+/** Flips a row of \a blocks DXT5 blocks from \a src into \a dst, which may be the same. */
+static void flipRowDXT5(unsigned char *dst, const unsigned char *src, size_t blocks) {
+	size_t i = 0;
+#ifdef __AVX2__
+	__m256i mask = _mm256_broadcastsi128_si256(SHUFFLE_MASK(DXT5_SHUFFLE)), alpha = _mm256_setr_epi64x(-1, 0, -1, 0);
+	for (; i + 2 <= blocks; i += 2) {
+		__m256i x = _mm256_loadu_si256((const __m256i *) (src + 16 * i));
+		_mm256_storeu_si256((__m256i *) (dst + 16 * i), _mm256_blendv_epi8(_mm256_shuffle_epi8(x, mask), flipDXT5Alpha(x), alpha));
+	}
+#elif defined(__SSSE3__) || defined(SSE2_ONLY)
+#ifdef __SSSE3__
+	__m128i mask = SHUFFLE_MASK(DXT5_SHUFFLE);
+#else
+	__m128i mask = _mm_set_epi32(-1, 0, 0, 0);
+#endif
+	__m128i alpha = _mm_set_epi32(0, 0, -1, -1);
+	for (; i < blocks; i++) {
+		__m128i x = _mm_loadu_si128((const __m128i *) (src + 16 * i)),
+#ifdef __SSSE3__
+			color = _mm_shuffle_epi8(x, mask);
+#else
+			color = reverseOddDwords(x, mask);
+#endif
+		_mm_storeu_si128((__m128i *) (dst + 16 * i), _mm_or_si128(_mm_and_si128(alpha, flipDXT5Alpha(x)), _mm_andnot_si128(alpha, color)));
+	}
+#endif
+	for (; i < blocks; i++) {
+		uint64_t bits;
+		unsigned char block[16];
+		memcpy(&bits, src + 16 * i, 8);
+		bits = FLIP_DXT5_ALPHA(bits);
+		memcpy(block, &bits, 8);
+		memcpy(block + 8, src + 16 * i + 8, 8);
+		FlipDXT1BlockFull(block + 8);
+		memcpy(dst + 16 * i, block, 16);
+	}
+}
+
+/** Flips \a count consecutive BC4 blocks, each laid out like the alpha half of a DXT5 block. */
+static void flipAlphaBlocks(unsigned char *dst, const unsigned char *src, size_t count) {
+	size_t i = 0;
+#ifdef __AVX2__
+	for (; i + 4 <= count; i += 4) _mm256_storeu_si256((__m256i *) (dst + 8 * i), flipDXT5Alpha(_mm256_loadu_si256((const __m256i *) (src + 8 * i))));
+#elif defined(__SSE2__) || defined(_M_X64)
+	for (; i + 2 <= count; i += 2) _mm_storeu_si128((__m128i *) (dst + 8 * i), flipDXT5Alpha(_mm_loadu_si128((const __m128i *) (src + 8 * i))));
+#endif
+	for (; i < count; i++) {
+		uint64_t bits;
+		memcpy(&bits, src + 8 * i, 8);
+		bits = FLIP_DXT5_ALPHA(bits);
+		memcpy(dst + 8 * i, &bits, 8);
+	}
+}
+
+/** Flips a row of \a blocks BC4 blocks from \a src into \a dst, which may be the same. */
+static void flipRowBC4(unsigned char *dst, const unsigned char *src, size_t blocks) {
+	flipAlphaBlocks(dst, src, blocks);
+}
+
+/** Flips a row of \a blocks BC5 blocks, each made of two BC4 blocks, from \a src into \a dst, which may be the same. */
+static void flipRowBC5(unsigned char *dst, const unsigned char *src, size_t blocks) {
+	flipAlphaBlocks(dst, src, 2 * blocks);
+}
+
+/** Returns the function that flips a row of blocks of the format in the y direction, or \c 0 if flipping is unsupported. */
+static void (*getRowFlip(GLenum internalformat))(unsigned char *, const unsigned char *, size_t) {
+	switch (internalformat) {
+	case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT: case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT: return flipRowDXT1;
+	case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT: case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT: return flipRowDXT3;
+	case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT: case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT: return flipRowDXT5;
+	case GL_COMPRESSED_RED_RGTC1: case GL_COMPRESSED_SIGNED_RED_RGTC1: return flipRowBC4;
+	case GL_COMPRESSED_RG_RGTC2: case GL_COMPRESSED_SIGNED_RG_RGTC2: return flipRowBC5;
+	}
+	return 0; // The layout of BC6H and BC7 blocks depends on their mode
+}
+
+/** Returns the software decoder format of a compressed internal format, or \c -1 if there is none. */
+static int getDecoderFormat(GLenum internalformat) {
+	switch (internalformat) {
+	case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT: case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT: return BCN_BC1;
+	case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT: case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT: return BCN_BC2;
+	case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT: case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT: return BCN_BC3;
+	case GL_COMPRESSED_RED_RGTC1: return BCN_BC4;
+	case GL_COMPRESSED_RG_RGTC2: return BCN_BC5;
+	}
+	return -1;
+}
+
+/** The size of the stack buffer used to swap block rows in place. */
+#define FLIP_SCRATCH_SIZE 2048
+
+/** Flips the compressed mipmap level \a mip from \a src into \a dst, which may be the same buffer. */
+static void flipLevel(const struct dds_image *image, void (*flipRow)(unsigned char *, const unsigned char *, size_t), unsigned int mip, unsigned char *dst, const unsigned char *src) {
+	const struct dds_mipmap *mipmap = image->mipmaps + mip;
+	size_t rows = ((size_t) mipmap->height + 3) / 4, widBytes = ((size_t) mipmap->width + 3) / 4 * image->blockSize;
+	for (unsigned int z = 0; z < mipmap->depth; z++, src += rows * widBytes, dst += rows * widBytes) {
+		if (dst != src) {
+			// Flip & copy to actual pixel buffer, never reading back from the destination as it may be write-combined
+			for (size_t j = 0; j < rows; j++) flipRow(dst + (rows - 1 - j) * widBytes, src + j * widBytes, widBytes / image->blockSize);
+			continue;
+		}
+
+		// Swap block rows from the outside in, a scratch-sized chunk at a time
+		unsigned char scratch[FLIP_SCRATCH_SIZE];
+		for (size_t j = 0; j < rows / 2; j++) {
+			unsigned char *s = dst + j * widBytes, *d = dst + (rows - 1 - j) * widBytes;
+			for (size_t k = 0; k < widBytes; k += FLIP_SCRATCH_SIZE) {
+				size_t n = MIN(FLIP_SCRATCH_SIZE, widBytes - k);
+				memcpy(scratch, s + k, n);
+				flipRow(s + k, d + k, n / image->blockSize);
+				flipRow(d + k, scratch, n / image->blockSize);
+			}
+		}
+		if (rows % 2 != 0) flipRow(dst + rows / 2 * widBytes, dst + rows / 2 * widBytes, widBytes / image->blockSize);
+	}
+}
+
+void dds_flip(const struct dds_image *image, char *data) {
+	void (*flipRow)(unsigned char *, const unsigned char *, size_t) = getRowFlip(image->internalformat);
+	if (!image->compressed || flipRow == 0) return;
+
+	for (unsigned int face = 0; face < image->layers * image->faces; face++) {
+		for (unsigned int i = 0; i < image->levels; i++) {
+			unsigned char *pixels = (unsigned char *) data + DDS_OFFSET(image, face, i);
+			flipLevel(image, flipRow, i, pixels, pixels);
+		}
+	}
+}
+
+int dds_is_supported(const struct dds_image *image) {
+	switch (image->internalformat) {
+	case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+	case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
+	case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+		return GLEW_EXT_texture_compression_s3tc;
+	case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT:
+	case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT:
+	case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+		return GLEW_EXT_texture_compression_s3tc && GLEW_EXT_texture_sRGB;
+	case GL_COMPRESSED_RED_RGTC1:
+	case GL_COMPRESSED_SIGNED_RED_RGTC1:
+	case GL_COMPRESSED_RG_RGTC2:
+	case GL_COMPRESSED_SIGNED_RG_RGTC2:
+		return GLEW_ARB_texture_compression_rgtc;
+	case GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT:
+	case GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT:
+	case GL_COMPRESSED_RGBA_BPTC_UNORM:
+	case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+		return GLEW_ARB_texture_compression_bptc;
+	}
+	return 1;
+}
+
+/** Describes the RGBA8 layout, without a header, of a decompressed image. */
+static void getDecompressedLayout(const struct dds_image *image, struct dds_image *decompressed) {
+	*decompressed = *image;
+	switch (image->internalformat) {
+	case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT:
+	case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT:
+	case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+		decompressed->internalformat = GL_SRGB8_ALPHA8;
+		break;
+	default:
+		decompressed->internalformat = GL_RGBA8;
+	}
+	decompressed->format = GL_RGBA;
+	decompressed->type = GL_UNSIGNED_BYTE;
+	decompressed->compressed = 0;
+	decompressed->bitsPerPixel = 32;
+	decompressed->blockSize = 0;
+
+	size_t offset = 0;
+	for (unsigned int i = 0; i < image->levels; i++) {
+		struct dds_mipmap *mipmap = decompressed->mipmaps + i;
+		mipmap->offset = offset;
+		offset += mipmap->size = (size_t) mipmap->width * mipmap->height * mipmap->depth * 4;
+	}
+	decompressed->faceSize = offset;
+	decompressed->size = offset * image->layers * image->faces;
+}
+
+/** Decodes every slice of a compressed mipmap level into RGBA8 pixels at \a dst, upside down if \a flip is non-zero. */
+static void decodeLevel(const struct dds_image *image, unsigned int mip, unsigned char *dst, const char *src, int flip, struct threadpool *pool) {
+	const struct dds_mipmap *mipmap = image->mipmaps + mip;
+	enum bcn_format format = getDecoderFormat(image->internalformat);
+	size_t sliceSize = ((size_t) mipmap->width + 3) / 4 * (((size_t) mipmap->height + 3) / 4) * image->blockSize;
+	ptrdiff_t stride = (ptrdiff_t) mipmap->width * 4;
+	for (unsigned int z = 0; z < mipmap->depth; z++, src += sliceSize, dst += mipmap->height * stride) {
+		if (flip) bcn_decode(format, src, mipmap->width, mipmap->height, dst + (mipmap->height - 1) * stride, -stride, pool);
+		else bcn_decode(format, src, mipmap->width, mipmap->height, dst, stride, pool);
+	}
+}
+
+char *dds_decompress(const struct dds_image *image, const char *data, int flags, struct dds_image *decompressed, struct threadpool *pool) {
+	if (!image->compressed || getDecoderFormat(image->internalformat) < 0) return 0;
+	getDecompressedLayout(image, decompressed);
+	char *pixels = malloc(decompressed->size);
+	if (pixels == 0) return 0;
+
+	for (unsigned int j = 0; j < image->layers * image->faces; j++) {
+		for (unsigned int i = 0; i < image->levels; i++) {
+			decodeLevel(image, i, (unsigned char *) pixels + DDS_OFFSET(decompressed, j, i), data + DDS_OFFSET(image, j, i), flags & DDS_FLIP_UVS, pool);
+		}
+	}
+	return pixels;
+}
+
+/** Halves an image of RGBA8 pixels with a box filter, repeating the last row and column of odd sizes. */
+static void downsample(const unsigned char *src, unsigned int width, unsigned int height, unsigned char *dst) {
+	unsigned int w = MAX(1, width / 2), h = MAX(1, height / 2);
+	for (unsigned int y = 0; y < h; y++) {
+		const unsigned char *row0 = src + (size_t) MIN(2 * y, height - 1) * width * 4, *row1 = src + (size_t) MIN(2 * y + 1, height - 1) * width * 4;
+		for (unsigned int x = 0; x < w; x++) {
+			unsigned int x0 = 4 * MIN(2 * x, width - 1), x1 = 4 * MIN(2 * x + 1, width - 1);
+			for (int k = 0; k < 4; k++) *dst++ = (row0[x0 + k] + row0[x1 + k] + row1[x0 + k] + row1[x1 + k] + 2) / 4;
+		}
+	}
+}
+
+char *dds_encode(const unsigned char *rgba, unsigned int width, unsigned int height, GLenum internalformat, int flags, size_t *size, struct threadpool *pool) {
+	int format = getDecoderFormat(internalformat);
+	if (format < 0 || width == 0 || height == 0) return 0;
+	unsigned int levels = 1;
+	if (flags & DDS_MIPMAPS) for (unsigned int n = MAX(width, height); n > 1 && levels < DDS_MAX_LEVELS; n /= 2) levels++;
+
+	size_t headerSize = sizeof(uint32_t) + sizeof(DDSURFACEDESC2), dataSize = 0;
+	for (unsigned int i = 0; i < levels; i++) dataSize += ((MAX(1, width >> i) + 3) / 4) * ((MAX(1, height >> i) + 3) / 4) * bcn_block_size(format);
+	char *data = malloc(headerSize + dataSize);
+	// Mipmaps are filtered from the previous level, alternating between room for the second and third level
+	size_t second = (size_t) MAX(1, width / 2) * MAX(1, height / 2) * 4, third = (size_t) MAX(1, width / 4) * MAX(1, height / 4) * 4;
+	unsigned char *scratch = levels > 1 ? malloc(second + third) : 0;
+	if (data == 0 || (levels > 1 && scratch == 0)) {
+		free(data);
+		free(scratch);
+		return 0;
+	}
+
+	uint32_t magic = DDS_MAGIC;
+	memcpy(data, &magic, sizeof magic);
+	DDSURFACEDESC2 header;
+	memset(&header, 0, sizeof header);
+	header.dwSize = sizeof header;
+	header.dwFlags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | (levels > 1 ? DDSD_MIPMAPCOUNT : 0);
+	header.dwHeight = height;
+	header.dwWidth = width;
+	header.dwMipMapCount = levels;
+	header.ddpfPixelFormat.dwSize = sizeof header.ddpfPixelFormat;
+	header.ddpfPixelFormat.dwFlags = DDPF_FOURCC;
+	static const unsigned int fourCCs[] = { MAKEFOURCC('D', 'X', 'T', '1'), MAKEFOURCC('D', 'X', 'T', '3'), MAKEFOURCC('D', 'X', 'T', '5'), MAKEFOURCC('A', 'T', 'I', '1'), MAKEFOURCC('A', 'T', 'I', '2') };
+	header.ddpfPixelFormat.dwFourCC = fourCCs[format];
+	int caps = DDSCAPS_TEXTURE | (levels > 1 ? DDSCAPS_COMPLEX | DDSCAPS_MIPMAP : 0);
+	memcpy(&header.ddsCaps, &caps, sizeof caps); // The first member is named differently in ddraw.h
+	memcpy(data + sizeof(uint32_t), &header, sizeof header);
+
+	char *blocks = data + headerSize;
+	const unsigned char *pixels = rgba;
+	unsigned char *next = scratch;
+	for (unsigned int i = 0; i < levels; i++) {
+		unsigned int w = MAX(1, width >> i), h = MAX(1, height >> i);
+		bcn_encode(format, pixels, w, h, (ptrdiff_t) w * 4, blocks, flags & DDS_HIGH_QUALITY ? BCN_QUALITY : 0, pool);
+		blocks += ((w + 3) / 4) * ((h + 3) / 4) * bcn_block_size(format);
+		if (i + 1 < levels) {
+			downsample(pixels, w, h, next);
+			pixels = next;
+			next = next == scratch ? scratch + second : scratch;
+		}
+	}
+
+	free(scratch);
+	*size = headerSize + dataSize;
+	return data;
+}
+
+/** Returns non-zero if the layers of the target are the slices of a three-dimensional image. */
+static int isArray(GLenum target) {
+	return target == GL_TEXTURE_2D_ARRAY || target == GL_TEXTURE_CUBE_MAP_ARRAY;
+}
+
+/** Defines every mipmap level of a bound array texture without uploading, as DDS files do not store the layers of a level together. */
+static void allocateLayers(const struct dds_image *image) {
+	GLsizei slices = image->layers * image->faces;
+	for (unsigned int i = 0; i < image->levels; i++) {
+		const struct dds_mipmap *mipmap = image->mipmaps + i;
+		if (image->compressed) glCompressedTexImage3D(image->target, i, image->internalformat, mipmap->width, mipmap->height, slices, 0, mipmap->size * slices, 0);
+		else glTexImage3D(image->target, i, image->internalformat, mipmap->width, mipmap->height, slices, 0, image->format, image->type, 0);
+	}
+}
+
+/** Uploads a mipmap level of a face of the bound texture, defining the level unless the storage is \a allocated.
+	The storage of array textures must always be allocated beforehand. */
+static void uploadImage(const struct dds_image *image, unsigned int face, unsigned int level, const void *pixels, int allocated) {
+	const struct dds_mipmap *mipmap = image->mipmaps + level;
+	GLsizei size = mipmap->size;
+	if (isArray(image->target)) {
+		if (image->compressed) glCompressedTexSubImage3D(image->target, level, 0, 0, face, mipmap->width, mipmap->height, 1, image->internalformat, size, pixels);
+		else glTexSubImage3D(image->target, level, 0, 0, face, mipmap->width, mipmap->height, 1, image->format, image->type, pixels);
+	}
+	else if (image->target == GL_TEXTURE_3D) {
+		if (image->compressed) {
+			if (allocated) glCompressedTexSubImage3D(image->target, level, 0, 0, 0, mipmap->width, mipmap->height, mipmap->depth, image->internalformat, size, pixels);
+			else glCompressedTexImage3D(image->target, level, image->internalformat, mipmap->width, mipmap->height, mipmap->depth, 0, size, pixels);
+		}
+		else if (allocated) glTexSubImage3D(image->target, level, 0, 0, 0, mipmap->width, mipmap->height, mipmap->depth, image->format, image->type, pixels);
+		else glTexImage3D(image->target, level, image->internalformat, mipmap->width, mipmap->height, mipmap->depth, 0, image->format, image->type, pixels);
+	}
+	else {
+		GLenum target = image->faces == 6 ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : image->target;
+		if (image->compressed) {
+			if (allocated) glCompressedTexSubImage2D(target, level, 0, 0, mipmap->width, mipmap->height, image->internalformat, size, pixels);
+			else glCompressedTexImage2D(target, level, image->internalformat, mipmap->width, mipmap->height, 0, size, pixels);
+		}
+		else if (allocated) glTexSubImage2D(target, level, 0, 0, mipmap->width, mipmap->height, image->format, image->type, pixels);
+		else glTexImage2D(target, level, image->internalformat, mipmap->width, mipmap->height, 0, image->format, image->type, pixels);
+	}
+}
+
+GLuint dds_upload(const struct dds_image *image, const char *data, GLuint texture) {
+	if (image->compressed && !dds_is_supported(image)) {
+		// Decode on the CPU as the driver lacks the format
+		struct dds_image decompressed;
+		char *pixels = dds_decompress(image, data, 0, &decompressed, 0);
+		if (pixels == 0) return 0;
+		texture = dds_upload(&decompressed, pixels, texture);
+		free(pixels);
+		return texture;
+	}
+
+	if (texture == 0) glGenTextures(1, &texture);
 	if (texture == 0) return 0;
-	glBindTexture(target, texture);
+	glh_bind_texture(image->target, texture);
 
 	// Not all DDS files provide all mipmap levels; define mipmap range
-	glTexParameteri(target, GL_TEXTURE_BASE_LEVEL, 0);
-	glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, mipMapCount - 1);
-
-	for (size_t i = 0; i < mipMapCount; i++) {
-		for (int j = 0; j < (isCubeMap ? 6 : 1); j++) {
-			size_t size;
-			if (!compressed) size = width * height * bitsPerPixel / 8;
-			else {
-				size = ((width + 3) / 4) * ((height + 3) / 4) * blockSize; // size = ceil(width / 4) * ceil(height / 4) * blockSize;
-			}
-			target = isCubeMap ? GL_TEXTURE_CUBE_MAP_POSITIVE_X_EXT + j : target;
+	glTexParameteri(image->target, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(image->target, GL_TEXTURE_MAX_LEVEL, image->levels - 1);
 
-			if (!compressed) {
-				glTexImage2D(target, i, internalformat, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data + offset);
-			}
-			else {
-				unsigned char *pixels = 0;
-				if (flags & DDS_FLIP_UVS) {
-					pixels = malloc(size);
-					// Flip & copy to actual pixel buffer
-					int widBytes = ((width + 3) / 4)*blockSize;
-					const unsigned char *s = data + offset, *d = pixels + ((height + 3) / 4 - 1) * widBytes;
-					for (unsigned int j = 0; j < (height + 3) / 4; j++) {
-						memcpy(d, s, widBytes);
-
-						for (int k = 0; k < widBytes / blockSize; k++) if (internalformat == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT) FlipDXT1BlockFull(d + k * blockSize);
-						else if (internalformat == GL_COMPRESSED_RGBA_S3TC_DXT3_EXT) FlipDXT3BlockFull(d + k * blockSize);
-						else if (internalformat == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT) FlipDXT5BlockFull(d + k * blockSize);
-
-						s += widBytes;
-						d -= widBytes;
-					}
-				}
-
-				glCompressedTexImage2D(target, i, internalformat, width, height, 0, size, pixels ? pixels : data + offset); // data + offset
+	if (isArray(image->target)) allocateLayers(image);
+	for (unsigned int j = 0; j < image->layers * image->faces; j++) {
+		GLenum target = image->target == GL_TEXTURE_CUBE_MAP ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + j : image->target;
+		for (unsigned int i = 0; i < image->levels; i++) {
+			uploadImage(image, j, i, data + DDS_OFFSET(image, j, i), 0);
+			if (image->compressed) {
 				GLint param = 0;
 				glGetTexLevelParameteriv(target, i, GL_TEXTURE_COMPRESSED_ARB, &param);
-				if (param == 0) printf("Mipmap level %d indicated compression failed", i);
-
-				free(pixels);
+				if (param == 0) printf("Mipmap level %u indicated compression failed", i);
 			}
+		}
+	}
+
+	return texture;
+}
+
+size_t dds_upload_level(const struct dds_image *image, unsigned int level, const char *data) {
+	const struct dds_mipmap *mipmap = image->mipmaps + level;
+	for (unsigned int j = 0; j < image->faces; j++) {
+		GLenum target = image->faces == 6 ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + j : image->target;
+		const char *pixels = data != 0 ? data + DDS_OFFSET(image, j, level) : 0;
+		GLsizei width = pixels != 0 ? mipmap->width : 0, height = pixels != 0 ? mipmap->height : 0;
+		if (image->compressed) glCompressedTexImage2D(target, level, image->internalformat, width, height, 0, pixels != 0 ? mipmap->size : 0, pixels);
+		else glTexImage2D(target, level, image->internalformat, width, height, 0, image->format, image->type, pixels);
+	}
+	return image->faces * mipmap->size;
+}
+
+unsigned int dds_tail_level(const struct dds_image *image) {
+	if (image->target != GL_TEXTURE_2D && image->target != GL_TEXTURE_CUBE_MAP) return 0;
+	unsigned int level = 0;
+	while (level < image->levels - 1 && (image->mipmaps[level].width > DDS_TAIL_SIZE || image->mipmaps[level].height > DDS_TAIL_SIZE)) level++;
+	return level;
+}
+
+size_t dds_evict_level(const struct dds_image *image, GLuint texture, unsigned int level) {
+	glh_bind_texture(image->target, texture);
+	glTexParameteri(image->target, GL_TEXTURE_BASE_LEVEL, level + 1);
+	return dds_upload_level(image, level, 0);
+}
 
-			offset += size;
+size_t dds_restore_level(const struct dds_image *image, GLuint texture, unsigned int level, const char *data) {
+	glh_bind_texture(image->target, texture);
+	size_t bytes = dds_upload_level(image, level, data);
+	glTexParameteri(image->target, GL_TEXTURE_BASE_LEVEL, level);
+	return bytes;
+}
+
+GLuint dds_load_texture_from_memory(const char *data, int *imageWidth, int *imageHeight, int flags) {
+	struct dds_image image;
+	if (!dds_parse(data, (size_t) -1, &image)) return 0;
+	if (imageWidth != 0) *imageWidth = image.width;
+	if (imageHeight != 0) *imageHeight = image.height;
+
+	char *pixels = 0;
+	if (image.compressed && !dds_is_supported(&image)) {
+		// Decode straight into the flipped orientation
+		struct dds_image decompressed;
+		if ((pixels = dds_decompress(&image, data, flags, &decompressed, 0)) == 0) return 0;
+		GLuint texture = dds_upload(&decompressed, pixels, 0);
+		free(pixels);
+		return texture;
+	}
+	if (flags & DDS_FLIP_UVS && image.compressed) {
+		// Flip a single copy of the whole file instead of every level separately
+		if ((pixels = malloc(image.size)) == 0) return 0;
+		memcpy(pixels, data, image.size);
+		dds_flip(&image, pixels);
+	}
+
+	GLuint texture = dds_upload(&image, pixels ? pixels : data, 0);
+	free(pixels);
+	return texture;
+}
+
+/** Maps a file read-only into memory, returning \c 0 on failure. */
+static const char *mapFile(const char *path, size_t *size) {
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0), mapping;
+	if (file == INVALID_HANDLE_VALUE) return 0;
+	const char *data = 0;
+	LARGE_INTEGER length;
+	if (GetFileSizeEx(file, &length) && length.QuadPart > 0 && (mapping = CreateFileMapping(file, 0, PAGE_READONLY, 0, 0, 0)) != 0) {
+		data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		*size = (size_t) length.QuadPart;
+		CloseHandle(mapping); // The view keeps the mapping alive
+	}
+	CloseHandle(file);
+	return data;
+#else
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) return 0;
+	struct stat st;
+	void *data = MAP_FAILED;
+	if (fstat(fd, &st) == 0 && st.st_size > 0) data = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd); // The mapping keeps the file open
+	if (data == MAP_FAILED) return 0;
+	*size = st.st_size;
+	return data;
+#endif
+}
+
+static void unmapFile(const char *data, size_t size) {
+#ifdef _WIN32
+	UnmapViewOfFile(data);
+#else
+	munmap((void *) data, size);
+#endif
+}
+
+char *dds_read_file(const char *path, size_t *size) {
+	FILE *file = fopen(path, "rb");
+	if (file == 0) return 0;
+	char *data = 0;
+	long length;
+	if (fseek(file, 0, SEEK_END) != 0 || (length = ftell(file)) < 0 || fseek(file, 0, SEEK_SET) != 0) goto close;
+	if ((data = malloc(length)) == 0) goto close;
+	if (fread(data, 1, length, file) != (size_t) length) {
+		free(data);
+		data = 0;
+	}
+	*size = length;
+close:
+	fclose(file);
+	return data;
+}
+
+/** The persistently mapped pixel unpack buffer of the context current on the thread, reused by every file load. */
+static GLH_THREAD_LOCAL struct {
+	GLuint buffer;
+	unsigned char *mapping;
+	size_t size;
+	/** Signalled once the uploads of the last load have read the buffer */
+	GLsync fence;
+} staging;
+
+/** Binds the staging buffer, waiting for the uploads of the last load and growing it to hold \p size bytes. */
+static unsigned char *mapStaging(size_t size) {
+	if (staging.fence != 0) {
+		// Flushing submits the fence, so that the wait ends
+		while (glClientWaitSync(staging.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED);
+		glDeleteSync(staging.fence);
+		staging.fence = 0;
+	}
+	if (staging.buffer != 0 && staging.size >= size) {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging.buffer);
+		return staging.mapping;
+	}
+
+	// Storage is immutable, so growing takes a new buffer; deleting the old one unmaps it
+	dds_release_staging_buffer();
+	size_t grown = size > 2 * staging.size ? size : 2 * staging.size;
+	GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glGenBuffers(1, &staging.buffer);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging.buffer);
+	glBufferStorage(GL_PIXEL_UNPACK_BUFFER, grown, 0, access);
+	staging.mapping = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, grown, access);
+	if (staging.mapping == 0) {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		dds_release_staging_buffer();
+		return 0;
+	}
+	staging.size = grown;
+	return staging.mapping;
+}
+
+void dds_release_staging_buffer(void) {
+	if (staging.fence != 0) glDeleteSync(staging.fence);
+	if (staging.buffer != 0) glDeleteBuffers(1, &staging.buffer);
+	staging.buffer = 0;
+	staging.mapping = 0;
+	staging.fence = 0;
+}
+
+/** Uploads through a pixel unpack buffer into immutable storage, copying the data only once on the CPU. */
+static GLuint uploadStaged(const struct dds_image *source, const char *data, int flags) {
+	// Formats the driver lacks are decoded straight into the buffer instead
+	struct dds_image decompressed;
+	int decode = source->compressed && !dds_is_supported(source) && getDecoderFormat(source->internalformat) >= 0;
+	if (decode) getDecompressedLayout(source, &decompressed);
+	const struct dds_image *image = decode ? &decompressed : source;
+
+	size_t base = image->mipmaps[0].offset, payload = image->size - base;
+	void (*flipRow)(unsigned char *, const unsigned char *, size_t) = flags & DDS_FLIP_UVS && image->compressed ? getRowFlip(image->internalformat) : 0;
+	int immutable = GLEW_ARB_texture_storage, persistent = GLEW_ARB_buffer_storage && GLEW_ARB_sync;
+
+	GLuint texture, buffer = 0;
+	glGenTextures(1, &texture);
+	if (texture == 0) return 0;
+	glh_bind_texture(image->target, texture);
+	if (immutable) {
+		if (image->target == GL_TEXTURE_3D) glTexStorage3D(image->target, image->levels, image->internalformat, image->width, image->height, image->depth);
+		else if (isArray(image->target)) glTexStorage3D(image->target, image->levels, image->internalformat, image->width, image->height, image->layers * image->faces);
+		else glTexStorage2D(image->target, image->levels, image->internalformat, image->width, image->height);
+	}
+	else if (isArray(image->target)) allocateLayers(image);
+	glTexParameteri(image->target, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(image->target, GL_TEXTURE_MAX_LEVEL, image->levels - 1);
+
+	unsigned char *mapping;
+	if (persistent) mapping = mapStaging(payload);
+	else {
+		glGenBuffers(1, &buffer);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, payload, 0, GL_STREAM_DRAW);
+		mapping = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, payload, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	}
+	if (mapping == 0) {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		if (buffer != 0) glDeleteBuffers(1, &buffer);
+		glh_delete_textures(1, &texture);
+		return 0;
+	}
+
+	// The only CPU copy, from the page cache into memory visible to the GL, flipping on the way if asked
+	for (unsigned int j = 0; j < image->layers * image->faces; j++) {
+		for (unsigned int i = 0; i < image->levels; i++) {
+			size_t offset = DDS_OFFSET(image, j, i);
+			if (decode) decodeLevel(source, i, mapping + offset - base, data + DDS_OFFSET(source, j, i), flags & DDS_FLIP_UVS, 0);
+			else if (flipRow != 0) flipLevel(image, flipRow, i, mapping + offset - base, (const unsigned char *) data + offset);
+			else memcpy(mapping + offset - base, data + offset, image->mipmaps[i].size);
 		}
+	}
+	if (!persistent) glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
 
-		// Keep size at a minimum
-		width = MAX(1, width / 2);
-		height = MAX(1, height / 2);
+	for (unsigned int j = 0; j < image->layers * image->faces; j++) {
+		for (unsigned int i = 0; i < image->levels; i++) uploadImage(image, j, i, (const char *) 0 + DDS_OFFSET(image, j, i) - base, immutable);
 	}
+	// The next load waits for the uploads before writing the buffer again, while a buffer of its own is kept alive by them
+	if (persistent) staging.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	if (buffer != 0) glDeleteBuffers(1, &buffer);
+	return texture;
+}
+
+GLuint dds_load_texture_from_file(const char *path, int *imageWidth, int *imageHeight, int flags) {
+	size_t size;
+	const char *data = mapFile(path, &size);
+	if (data == 0) return 0;
 
+	GLuint texture = 0;
+	struct dds_image image;
+	if (dds_parse(data, size, &image)) {
+		if (imageWidth != 0) *imageWidth = image.width;
+		if (imageHeight != 0) *imageHeight = image.height;
+		texture = uploadStaged(&image, data, flags);
+	}
+
+	unmapFile(data, size);
 	return texture;
-}
\ No newline at end of file
+}
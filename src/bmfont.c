@@ -1,122 +1,509 @@
 #include "bmfont.h"
+#include "atlas.h"
 #include <stdlib.h>
 #include <string.h>
-#include <stdio.h>
-#include <limits.h>
+#include <stdint.h>
+
+/** The glyph indices are 16-bit. */
+#define MAX_GLYPHS 0xFFFF
+
+#define BAKED_MAGIC "BMFB"
+#define BAKED_VERSION 2
+/** Reads as another value on a machine of the other byte order. */
+#define BYTE_ORDER_MARK 0x01020304
+
+/** The header of a baked font, followed by its tables at offsets from the start of the header, all aligned to 4 bytes. */
+struct baked_font {
+	char magic[4];
+	uint32_t version, byteOrder, glyphSize, size;
+	uint32_t lineHeight, base, scaleW, scaleH, spread, pages, pageNameStride;
+	uint32_t glyphCount, mapSize, blockCount, pairCount;
+	uint32_t glyphs, kerningStarts, map, blocks, kerningSeconds, kerningAmounts, pageNames;
+};
+
+static unsigned int readU16(const char *data) {
+	return (unsigned char) data[0] | (unsigned char) data[1] << 8;
+}
+
+static unsigned int readU32(const char *data) {
+	return readU16(data) | readU16(data + 2) << 16;
+}
+
+/** A kerning pair while sorting. */
+struct pair {
+	unsigned int key; /**< The glyph index of the first character in the high half and of the second in the low half. */
+	short amount;
+};
+
+static int comparePairs(const void *a, const void *b) {
+	unsigned int x = ((const struct pair *) a)->key, y = ((const struct pair *) b)->key;
+	return (x > y) - (x < y);
+}
+
+static uint32_t alignOffset(size_t offset) {
+	return (uint32_t) ((offset + 3) & ~(size_t) 3);
+}
+
+/** Lays out the tables of a font after the header of a baked blob and allocates it. */
+static struct baked_font *allocateBaked(const struct bmfont *font, unsigned int blockCount, unsigned int pairCount, unsigned int pageNameStride) {
+	struct baked_font header = { BAKED_MAGIC, BAKED_VERSION, BYTE_ORDER_MARK, sizeof(struct glyph), 0,
+		font->lineHeight, font->base, font->scaleW, font->scaleH, font->spread, font->pages, pageNameStride, font->glyphCount, font->mapSize, blockCount, pairCount, 0, 0, 0, 0, 0, 0, 0 };
+	header.glyphs = alignOffset(sizeof(struct baked_font));
+	header.kerningStarts = alignOffset(header.glyphs + (size_t) font->glyphCount * sizeof(struct glyph));
+	header.map = alignOffset(header.kerningStarts + (font->glyphCount + (size_t) 1) * sizeof(unsigned int));
+	header.blocks = alignOffset(header.map + (size_t) font->mapSize * sizeof(unsigned short));
+	header.kerningSeconds = alignOffset(header.blocks + (size_t) blockCount * BMFONT_BLOCK_SIZE * sizeof(unsigned short));
+	header.kerningAmounts = alignOffset(header.kerningSeconds + (size_t) pairCount * sizeof(unsigned short));
+	header.pageNames = alignOffset(header.kerningAmounts + (size_t) pairCount * sizeof(short));
+	header.size = alignOffset(header.pageNames + (size_t) font->pages * pageNameStride);
+	struct baked_font *baked = calloc(1, header.size);
+	if (baked != 0) *baked = header;
+	return baked;
+}
+
+/** Points the font at the tables of a baked blob in place. */
+static void openBaked(const struct baked_font *baked, struct bmfont *font) {
+	char *data = (char *) baked;
+	font->lineHeight = baked->lineHeight;
+	font->base = baked->base;
+	font->scaleW = baked->scaleW;
+	font->scaleH = baked->scaleH;
+	font->spread = baked->spread;
+	font->pages = baked->pages;
+	font->pageNames = data + baked->pageNames;
+	font->pageNameStride = baked->pageNameStride;
+	font->glyphCount = baked->glyphCount;
+	font->glyphs = (struct glyph *) (data + baked->glyphs);
+	font->mapSize = baked->mapSize;
+	font->map = (unsigned short *) (data + baked->map);
+	font->blocks = (unsigned short *) (data + baked->blocks);
+	font->kerningStarts = (unsigned int *) (data + baked->kerningStarts);
+	font->kerningSeconds = (unsigned short *) (data + baked->kerningSeconds);
+	font->kerningAmounts = (short *) (data + baked->kerningAmounts);
+	font->baked = baked;
+	font->storage = 0;
+}
+
+/** Builds the glyph map, the kerning table and the page names into a new baked blob, and opens the font from it. */
+static int buildTables(struct bmfont *font, const char *names, unsigned int namesSize, const char *chars, unsigned int charCount, const char *kernings, unsigned int kerningCount) {
+	// Find the blocks of the map that have glyphs
+	unsigned int maxId = 0;
+	for (unsigned int c = 0; c < charCount; c++) {
+		unsigned int id = readU32(chars + 20 * c);
+		if (id < 0x110000 && id > maxId) maxId = id;
+	}
+	font->mapSize = (maxId >> BMFONT_BLOCK_BITS) + 1;
+	unsigned short *map = calloc(font->mapSize, sizeof(unsigned short));
+	if (map == 0) return 0;
+	unsigned int blockCount = 1;
+	for (unsigned int c = 0; c < charCount; c++) {
+		unsigned int id = readU32(chars + 20 * c);
+		if (id < 0x110000 && map[id >> BMFONT_BLOCK_BITS] == 0) map[id >> BMFONT_BLOCK_BITS] = blockCount++;
+	}
+
+	// Number the glyphs in file order, ignoring duplicates, with the empty glyph first
+	unsigned short *blocks = calloc((size_t) blockCount * BMFONT_BLOCK_SIZE, sizeof(unsigned short));
+	struct glyph *glyphs = malloc((charCount + 1) * sizeof(struct glyph));
+	if (blocks == 0 || glyphs == 0) {
+		free(map);
+		free(blocks);
+		free(glyphs);
+		return 0;
+	}
+	memset(glyphs, 0, sizeof(struct glyph));
+	font->glyphCount = 1;
+	for (unsigned int c = 0; c < charCount && font->glyphCount < MAX_GLYPHS; c++) {
+		const char *data = chars + 20 * c;
+		unsigned int id = readU32(data);
+		if (id >= 0x110000) continue;
+		unsigned short *index = blocks + ((size_t) map[id >> BMFONT_BLOCK_BITS] << BMFONT_BLOCK_BITS | (id & (BMFONT_BLOCK_SIZE - 1)));
+		if (*index != 0) continue;
+		*index = font->glyphCount;
+
+		struct glyph *glyph = glyphs + font->glyphCount++;
+		glyph->id = id;
+		glyph->x = readU16(data + 4);
+		glyph->y = readU16(data + 6);
+		glyph->width = readU16(data + 8);
+		glyph->height = readU16(data + 10);
+		glyph->xoffset = (short) readU16(data + 12);
+		glyph->yoffset = (short) readU16(data + 14);
+		glyph->xadvance = (short) readU16(data + 16);
+		glyph->page = (unsigned char) data[18];
+	}
+
+	// Sort the pairs between known glyphs by their glyph indices
+	struct pair *pairs = malloc((kerningCount + 1) * sizeof(struct pair));
+	unsigned int pairCount = 0;
+	if (pairs != 0) {
+		for (unsigned int i = 0; i < kerningCount; i++) {
+			const char *data = kernings + 10 * i;
+			unsigned int first = readU32(data), second = readU32(data + 4);
+			first = first < 0x110000 && first >> BMFONT_BLOCK_BITS < font->mapSize ? blocks[(size_t) map[first >> BMFONT_BLOCK_BITS] << BMFONT_BLOCK_BITS | (first & (BMFONT_BLOCK_SIZE - 1))] : 0;
+			second = second < 0x110000 && second >> BMFONT_BLOCK_BITS < font->mapSize ? blocks[(size_t) map[second >> BMFONT_BLOCK_BITS] << BMFONT_BLOCK_BITS | (second & (BMFONT_BLOCK_SIZE - 1))] : 0;
+			if (first == 0 || second == 0) continue;
+			pairs[pairCount].key = first << 16 | second;
+			pairs[pairCount++].amount = (short) readU16(data + 8);
+		}
+		qsort(pairs, pairCount, sizeof(struct pair), comparePairs);
+	}
+
+	// All page names have the length of the first
+	const char *nameEnd = names != 0 ? memchr(names, '\0', namesSize) : 0;
+	unsigned int nameLength = nameEnd != 0 ? (unsigned int) (nameEnd - names) : 0;
+	struct baked_font *baked = pairs != 0 ? allocateBaked(font, blockCount, pairCount, nameLength + 1) : 0;
+	if (baked != 0) {
+		openBaked(baked, font);
+		font->storage = baked;
+		memcpy(font->glyphs, glyphs, font->glyphCount * sizeof(struct glyph));
+		memcpy(font->map, map, font->mapSize * sizeof(unsigned short));
+		memcpy(font->blocks, blocks, (size_t) blockCount * BMFONT_BLOCK_SIZE * sizeof(unsigned short));
+		unsigned int p = 0;
+		for (unsigned int g = 0; g <= font->glyphCount; g++) {
+			font->kerningStarts[g] = p;
+			while (p < pairCount && pairs[p].key >> 16 == g) {
+				font->kerningSeconds[p] = pairs[p].key & 0xFFFF;
+				font->kerningAmounts[p] = pairs[p].amount;
+				p++;
+			}
+		}
+		for (unsigned int i = 0; i < font->pages && (i + 1) * (nameLength + 1) <= namesSize; i++) {
+			memcpy(font->pageNames + i * (nameLength + 1), names + i * (nameLength + 1), nameLength);
+		}
+	}
+	free(map);
+	free(blocks);
+	free(glyphs);
+	free(pairs);
+	return baked != 0;
+}
 
 struct bmfont *create_bmfont(const char *data) {
 	if (strncmp(data, "BMF\003", 4) != 0) return 0; // Check magic, only binary is supported
 	data += 4;
 
-	struct bmfont *font = (struct bmfont *)malloc(sizeof(struct bmfont));
+	struct bmfont *font = calloc(1, sizeof(struct bmfont));
 	if (font == 0) return 0;
 
-	for (unsigned int p = 0; p < PAGES; p++) {
-		font->glyphs[p] = malloc(sizeof(struct glyph) * PAGE_SIZE);
-	}
-
+	const char *names = 0, *chars = 0, *kernings = 0;
+	unsigned int namesSize = 0, charCount = 0, kerningCount = 0;
 	while (*data != '\0') {
 		char blockType = *data++;
-		unsigned int blockSize = ((unsigned) data[3] << 24) | ((unsigned) data[2] << 16) | ((unsigned) data[1] << 8) | (((unsigned char *) data)[0]);
+		unsigned int blockSize = readU32(data);
 		data += 4; // Skip size
 
 		switch (blockType) {
-		case 1:
-			data += blockSize; // Skip the information on how the font was generated
-			break;
 		case 2:
-		{
 			// Read common block
-			unsigned int lineHeight = font->lineHeight = ((int) data[1] << 8) | data[0];
-			data += 2;
-			unsigned int base = font->base = data[1] << 8 | data[0] & 0xFF;
-			data += 6; // Skip base, scaleW and scaleH
-			unsigned int pages = font->pages = data[1] << 8 | data[0] & 0xFF;
-			data += 7;
-
-			// font->glyphs = malloc(sizeof(struct glyph *) * pages);
-			// for (unsigned int p = 0; p < font->pages; p++) font->glyphs[p] = malloc(sizeof(struct glyph) * PAGE_SIZE);
+			font->lineHeight = readU16(data);
+			font->base = readU16(data + 2);
+			font->scaleW = readU16(data + 4);
+			font->scaleH = readU16(data + 6);
+			font->pages = readU16(data + 8);
 			break;
-		}
 		case 3:
-		{
-			// Page block
-			char **pageNames = font->pageNames = malloc(sizeof(char *) * font->pages);
-			for (unsigned int p = 0, n = strlen(data); p < font->pages; p++) {
-				strcpy(pageNames[p] = malloc(n + 1), data);
-				data += n + 1;
-			}
+			// Page block, where all names have the same length
+			names = data;
+			namesSize = blockSize;
 			break;
-		}
 		case 4:
-		{
-			// Character block
-			int numChars = blockSize / 20;
-			for (int c = 0; c < numChars; c++, data += 20) {
-				struct glyph glyph;
-				unsigned int id = glyph.id = ((data[3] & 0xFF) << 24) | ((data[2] & 0xFF) << 16) | ((data[1] & 0xFF) << 8) | (data[0] & 0xFF);
-				// unsigned int id = glyph.id = (unsigned char) data[3] << 24 | (unsigned char) data[2] << 16 | (unsigned char) data[1] << 8 | (unsigned char) data[0];
-				glyph.x = data[5] << 8 | data[4] & 0xFF;
-				glyph.y = data[7] << 8 | data[6] & 0xFF;
-				glyph.width = data[9] << 8 | data[8] & 0xFF;
-				glyph.height = data[11] << 8 | data[10] & 0xFF;
-				glyph.xoffset = data[13] << 8 | data[12] & 0xFF;
-				glyph.yoffset = data[15] << 8 | data[14] & 0xFF;
-				glyph.xadvance = data[17] << 8 | data[16] & 0xFF;
-				glyph.page = data[18];
-				glyph.kerning = 0;
-				unsigned int chnl = data[19];
-
-				if (id <= CHAR_MAX) {
-					font->glyphs[id / PAGE_SIZE][id & PAGE_SIZE - 1] = glyph;
-				}
-			}
+			// Character block, read once the kerning pairs are known
+			chars = data;
+			charCount = blockSize / 20;
 			break;
-		}
 		case 5:
-		{
 			// Kerning pair block
-			for (unsigned int i = 0; i < blockSize / 10; i++, data += 10) {
-				unsigned int first = (unsigned char) data[3] << 24 | (unsigned char) data[2] << 16 | (unsigned char) data[1] << 8 | (unsigned char) data[0],
-					second = (unsigned char) data[7] << 24 | (unsigned char) data[6] << 16 | (unsigned char) data[5] << 8 | (unsigned char) data[4];
-				int amount = data[9] << 8 | data[8];
-
-				struct glyph *glyph = font->glyphs[first / PAGE_SIZE] + (first & PAGE_SIZE - 1);
-				if (glyph->kerning == 0) glyph->kerning = calloc(PAGES, sizeof(char *));
-
-				char *page = glyph->kerning[second >> LOG2_PAGE_SIZE];
-				if (page == 0) page = glyph->kerning[second >> LOG2_PAGE_SIZE] = calloc(PAGE_SIZE, 1);
-				page[second & PAGE_SIZE - 1] = amount;
-			}
-			int i = bmfont_get_glyph(font, 'A').kerning['l' >> LOG2_PAGE_SIZE]['l' & PAGE_SIZE - 1];
+			kernings = data;
+			kerningCount = blockSize / 10;
 			break;
-		}
 		default:
-			printf("blockType: %d.\n", blockType);
+			break; // Skip the information on how the font was generated, and unknown blocks
 		}
+		data += blockSize;
 	}
 
+	if (!buildTables(font, names, namesSize, chars, charCount, kernings, kerningCount)) {
+		free(font);
+		return 0;
+	}
 	return font;
 }
 
 void destroy_bmfont(struct bmfont *font) {
-	for (unsigned int p = 0; p < PAGES; p++) {
-		free(font->glyphs[p]);
+	free(font->storage);
+	free(font);
+}
+
+/** Checks that an aligned table of \a count elements lies within the blob after the header. */
+static int isInside(const struct baked_font *baked, uint32_t offset, size_t count, size_t elementSize) {
+	return offset % 4 == 0 && offset >= sizeof(struct baked_font) && offset <= baked->size && count <= (baked->size - offset) / elementSize;
+}
+
+int bmfont_open_baked(const char *data, size_t size, struct bmfont *font) {
+	const struct baked_font *baked = (const struct baked_font *) data;
+	if (((uintptr_t) data & 3) != 0 || size < sizeof(struct baked_font) || memcmp(baked->magic, BAKED_MAGIC, 4) != 0
+		|| baked->version != BAKED_VERSION || baked->byteOrder != BYTE_ORDER_MARK || baked->glyphSize != sizeof(struct glyph) || baked->size > size) return 0;
+	if (baked->glyphCount == 0 || baked->glyphCount > MAX_GLYPHS || baked->mapSize == 0 || baked->mapSize > (0x110000 >> BMFONT_BLOCK_BITS)
+		|| baked->blockCount == 0 || baked->blockCount > baked->mapSize + 1 || baked->pageNameStride == 0
+		|| !isInside(baked, baked->glyphs, baked->glyphCount, sizeof(struct glyph))
+		|| !isInside(baked, baked->kerningStarts, baked->glyphCount + (size_t) 1, sizeof(unsigned int))
+		|| !isInside(baked, baked->map, baked->mapSize, sizeof(unsigned short))
+		|| !isInside(baked, baked->blocks, (size_t) baked->blockCount * BMFONT_BLOCK_SIZE, sizeof(unsigned short))
+		|| !isInside(baked, baked->kerningSeconds, baked->pairCount, sizeof(unsigned short))
+		|| !isInside(baked, baked->kerningAmounts, baked->pairCount, sizeof(short))
+		|| !isInside(baked, baked->pageNames, baked->pages, baked->pageNameStride)) return 0;
+
+	// Check every index once here, so that lookups need not
+	const unsigned short *map = (const unsigned short *) (data + baked->map), *blocks = (const unsigned short *) (data + baked->blocks),
+		*seconds = (const unsigned short *) (data + baked->kerningSeconds);
+	const unsigned int *starts = (const unsigned int *) (data + baked->kerningStarts);
+	for (unsigned int i = 0; i < baked->mapSize; i++) if (map[i] >= baked->blockCount) return 0;
+	for (size_t i = 0; i < (size_t) baked->blockCount * BMFONT_BLOCK_SIZE; i++) if (blocks[i] >= baked->glyphCount) return 0;
+	if (starts[0] != 0 || starts[baked->glyphCount] != baked->pairCount) return 0;
+	for (unsigned int i = 0; i < baked->glyphCount; i++) if (starts[i] > starts[i + 1]) return 0;
+	for (unsigned int i = 0; i < baked->pairCount; i++) if (seconds[i] >= baked->glyphCount) return 0;
+	for (unsigned int p = 0; p < baked->pages; p++) if (data[baked->pageNames + (p + (size_t) 1) * baked->pageNameStride - 1] != '\0') return 0;
+
+	openBaked(baked, font);
+	return 1;
+}
+
+struct bmfont *bmfont_open(const char *data, size_t size) {
+	if (size >= 4 && memcmp(data, BAKED_MAGIC, 4) == 0) {
+		struct bmfont *font = malloc(sizeof(struct bmfont));
+		if (font != 0 && bmfont_open_baked(data, size, font)) return font;
+		free(font);
+		return 0;
 	}
-	for (unsigned int p = 0; p < font->pages; p++) {
-		free(font->pageNames[p]);
+	// The parser stops at a zero block type
+	if (size < 5 || data[size - 1] != '\0') return 0;
+	return create_bmfont(data);
+}
+
+char *bmfont_bake(const struct bmfont *font, size_t *size) {
+	const struct baked_font *baked = font->baked;
+	char *copy = malloc(baked->size);
+	if (copy == 0) return 0;
+	memcpy(copy, baked, baked->size);
+	// The metrics may have changed since, as by bmfont_move_pages()
+	struct baked_font *header = (struct baked_font *) copy;
+	header->lineHeight = font->lineHeight;
+	header->base = font->base;
+	header->scaleW = font->scaleW;
+	header->scaleH = font->scaleH;
+	header->spread = font->spread;
+	memcpy(copy + header->glyphs, font->glyphs, font->glyphCount * sizeof(struct glyph));
+	*size = baked->size;
+	return copy;
+}
+
+const char *bmfont_page_name(const struct bmfont *font, unsigned int page) {
+	return page < font->pages ? font->pageNames + (size_t) page * font->pageNameStride : 0;
+}
+
+static inline unsigned int getIndex(const struct bmfont *font, unsigned int codepoint) {
+	unsigned int block = codepoint >> BMFONT_BLOCK_BITS;
+	if (block >= font->mapSize) return 0;
+	return font->blocks[(size_t) font->map[block] << BMFONT_BLOCK_BITS | (codepoint & (BMFONT_BLOCK_SIZE - 1))];
+}
+
+static inline int getKerning(const struct bmfont *font, unsigned int first, unsigned int second) {
+	unsigned int start = font->kerningStarts[first], count = font->kerningStarts[first + 1] - start;
+	if (count == 0) return 0;
+	// Branchless binary search, as the pairs of a glyph are few and their order unpredictable
+	const unsigned short *seconds = font->kerningSeconds + start;
+	while (count > 1) {
+		unsigned int half = count / 2;
+		seconds = seconds[half] <= second ? seconds + half : seconds;
+		count -= half;
 	}
-	free(font->pageNames);
-	free(font);
+	return *seconds == second ? font->kerningAmounts[seconds - font->kerningSeconds] : 0;
+}
+
+unsigned int bmfont_get_index(const struct bmfont *font, unsigned int codepoint) {
+	return getIndex(font, codepoint);
+}
+
+const struct glyph *bmfont_get_glyph(const struct bmfont *font, unsigned int codepoint) {
+	unsigned int index = getIndex(font, codepoint);
+	return index != 0 ? font->glyphs + index : 0;
+}
+
+int bmfont_get_index_kerning(const struct bmfont *font, unsigned int first, unsigned int second) {
+	return getKerning(font, first, second);
+}
+
+int bmfont_get_kerning(const struct bmfont *font, unsigned int first, unsigned int second) {
+	return getKerning(font, getIndex(font, first), getIndex(font, second));
+}
+
+/** Decodes a codepoint of UTF-8 text that is not ASCII, reading malformed sequences as U+FFFD one byte at a time.
+	@return The number of bytes read */
+static unsigned int decodeUTF8(const unsigned char *text, const unsigned char *end, unsigned int *codepoint) {
+	static const unsigned int minimum[] = { 0, 0, 0x80, 0x800, 0x10000 };
+	unsigned int lead = text[0], length = lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : lead >= 0xC0 ? 2 : 0;
+	*codepoint = 0xFFFD;
+	if (length == 0 || (size_t) (end - text) < length) return 1;
+	unsigned int value = lead & (0x7F >> length);
+	for (unsigned int i = 1; i < length; i++) {
+		if ((text[i] & 0xC0) != 0x80) return 1;
+		value = value << 6 | (text[i] & 0x3F);
+	}
+	// Reject overlong encodings, surrogates and values beyond Unicode
+	if (value < minimum[length] || value > 0x10FFFF || (value >= 0xD800 && value <= 0xDFFF)) return 1;
+	*codepoint = value;
+	return length;
 }
 
-struct glyph bmfont_get_glyph(struct bmfont *font, char c) {
-	struct glyph glyph = font->glyphs[c / PAGE_SIZE][c & PAGE_SIZE - 1];
-	return glyph;
+static int reserveQuads(struct text_quads *quads, unsigned int capacity) {
+	if (capacity <= quads->capacity) return 1;
+	if (capacity < 2 * quads->capacity) capacity = 2 * quads->capacity;
+	float *x = realloc(quads->x, 2 * capacity * sizeof(float));
+	if (x != 0) quads->x = x;
+	float *y = realloc(quads->y, 2 * capacity * sizeof(float));
+	if (y != 0) quads->y = y;
+	float *u = realloc(quads->u, 2 * capacity * sizeof(float));
+	if (u != 0) quads->u = u;
+	float *v = realloc(quads->v, 2 * capacity * sizeof(float));
+	if (v != 0) quads->v = v;
+	unsigned short *pages = realloc(quads->pages, capacity * sizeof(unsigned short));
+	if (pages != 0) quads->pages = pages;
+	if (x == 0 || y == 0 || u == 0 || v == 0 || pages == 0) return 0;
+	quads->capacity = capacity;
+	return 1;
 }
 
-int glyph_get_kerning(struct glyph glyph, char c) {
-	if (glyph.kerning == 0) return 0;
-	int i = glyph.kerning[c >> LOG2_PAGE_SIZE][c & PAGE_SIZE - 1];
-	return i;
+void bmfont_move_pages(struct bmfont *font, const struct atlas_sprite *sprites, int atlasWidth, int atlasHeight) {
+	for (unsigned int i = 1; i < font->glyphCount; i++) {
+		struct glyph *glyph = font->glyphs + i;
+		const struct atlas_sprite *sprite = sprites + glyph->page;
+		// Glyph positions count from the top of the page image, which ends up at the top of the sprite
+		glyph->x += sprite->x;
+		glyph->y += atlasHeight - (sprite->y + sprite->height);
+		glyph->page = sprite->page;
+	}
+	font->scaleW = atlasWidth;
+	font->scaleH = atlasHeight;
+}
+
+void bmfont_set_spread(struct bmfont *font, unsigned int spread) {
+	int grow = (int) spread - (int) font->spread;
+	for (unsigned int i = 1; i < font->glyphCount; i++) {
+		struct glyph *glyph = font->glyphs + i;
+		if (glyph->width == 0 || glyph->height == 0) continue;
+		// Keep the rectangles within the page, which may leave some of the outer ramp out
+		int left = grow < glyph->x ? grow : glyph->x, top = grow < glyph->y ? grow : glyph->y,
+			right = glyph->x + glyph->width + grow <= (int) font->scaleW ? grow : (int) font->scaleW - glyph->x - glyph->width,
+			bottom = glyph->y + glyph->height + grow <= (int) font->scaleH ? grow : (int) font->scaleH - glyph->y - glyph->height;
+		if (glyph->width + left + right <= 0 || glyph->height + top + bottom <= 0) left = top = right = bottom = 0;
+		glyph->x -= left;
+		glyph->y -= top;
+		glyph->width += left + right;
+		glyph->height += top + bottom;
+		glyph->xoffset -= left;
+		glyph->yoffset -= top;
+	}
+	font->spread = spread;
+}
+
+struct text_quads *create_text_quads(unsigned int capacity) {
+	struct text_quads *quads = calloc(1, sizeof(struct text_quads));
+	if (quads == 0) return 0;
+	if (capacity > 0 && !reserveQuads(quads, capacity)) {
+		destroy_text_quads(quads);
+		return 0;
+	}
+	return quads;
+}
+
+void destroy_text_quads(struct text_quads *quads) {
+	free(quads->x);
+	free(quads->y);
+	free(quads->u);
+	free(quads->v);
+	free(quads->pages);
+	free(quads);
+}
+
+int bmfont_layout(const struct bmfont *font, const char *text, size_t length, float *x, float *y, struct text_quads *quads) {
+	// Every quad takes at least one byte of text, so the arrays need only grow once
+	if (quads->count + length > quads->capacity && !reserveQuads(quads, quads->count + length)) return 0;
+	const unsigned char *p = (const unsigned char *) text, *end = p + length;
+	float startX = *x, penX = *x, penY = *y,
+		scaleU = 1.0f / (font->scaleW != 0 ? font->scaleW : 1), scaleV = 1.0f / (font->scaleH != 0 ? font->scaleH : 1);
+	unsigned int previous = 0, fallback = getIndex(font, 0xFFFD);
+	if (fallback == 0) fallback = getIndex(font, '?');
+	float *qx = quads->x + 2 * quads->count, *qy = quads->y + 2 * quads->count, *qu = quads->u + 2 * quads->count, *qv = quads->v + 2 * quads->count;
+	unsigned short *qpage = quads->pages + quads->count;
+
+	while (p < end) {
+		unsigned int codepoint;
+		if (*p < 0x80) codepoint = *p++;
+		else p += decodeUTF8(p, end, &codepoint);
+		if (codepoint == '\n') {
+			penX = startX;
+			penY += font->lineHeight;
+			previous = 0;
+			continue;
+		}
+
+		unsigned int index = getIndex(font, codepoint);
+		if (index == 0) index = fallback;
+		const struct glyph *glyph = font->glyphs + index;
+		penX += getKerning(font, previous, index);
+		previous = index;
+		if (glyph->width != 0 && glyph->height != 0) {
+			qx[0] = penX + glyph->xoffset;
+			qx[1] = qx[0] + glyph->width;
+			qy[0] = penY + glyph->yoffset;
+			qy[1] = qy[0] + glyph->height;
+			qu[0] = glyph->x * scaleU;
+			qu[1] = (glyph->x + glyph->width) * scaleU;
+			qv[0] = 1.0f - glyph->y * scaleV;
+			qv[1] = 1.0f - (glyph->y + glyph->height) * scaleV;
+			*qpage++ = glyph->page;
+			qx += 2;
+			qy += 2;
+			qu += 2;
+			qv += 2;
+		}
+		penX += glyph->xadvance;
+	}
+
+	quads->count = (unsigned int) (qpage - quads->pages);
+	*x = penX;
+	*y = penY;
+	return 1;
+}
+
+unsigned int bmfont_decode_utf8(const char *text, size_t length, unsigned int *codepoint) {
+	const unsigned char *p = (const unsigned char *) text;
+	if (*p < 0x80) {
+		*codepoint = *p;
+		return 1;
+	}
+	return decodeUTF8(p, p + length, codepoint);
+}
+
+float bmfont_measure(const struct bmfont *font, const char *text, size_t length) {
+	const unsigned char *p = (const unsigned char *) text, *end = p + length;
+	unsigned int previous = 0, fallback = getIndex(font, 0xFFFD);
+	if (fallback == 0) fallback = getIndex(font, '?');
+	int width = 0, maxWidth = 0;
+	while (p < end) {
+		unsigned int codepoint;
+		if (*p < 0x80) codepoint = *p++;
+		else p += decodeUTF8(p, end, &codepoint);
+		if (codepoint == '\n') {
+			if (width > maxWidth) maxWidth = width;
+			width = 0;
+			previous = 0;
+			continue;
+		}
+		unsigned int index = getIndex(font, codepoint);
+		if (index == 0) index = fallback;
+		width += getKerning(font, previous, index) + font->glyphs[index].xadvance;
+		previous = index;
+	}
+	return (float) (width > maxWidth ? width : maxWidth);
 }
@@ -1,6 +1,7 @@
 #include "glh.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 GLsizei calculate_stride(struct attrib *attributes) {
 	GLsizei count = 0, i;
@@ -62,15 +63,147 @@ GLuint compile_shader(GLenum type, const char *source) {
 	return shader;
 }
 
+/** The buffer targets whose bindings are cached. */
+enum { ARRAY_SLOT, ELEMENT_SLOT, UNIFORM_SLOT, INDIRECT_SLOT, BUFFER_SLOTS };
+
+/** The bindings of the context current on the thread as made through the cache, every name stored plus one so that \c 0 means unknown. */
+static GLH_THREAD_LOCAL struct {
+	GLuint program, vertexArray, buffers[BUFFER_SLOTS], activeTexture, textures[GLH_TEXTURE_UNITS];
+	struct glh_state_counters counters;
+} state;
+
+/** Records a binding, returning non-zero if the call is needed. */
+static int update(GLuint *cached, GLuint name) {
+	if (*cached == name + 1) {
+		state.counters.skipped++;
+		return 0;
+	}
+	*cached = name + 1;
+	state.counters.issued++;
+	return 1;
+}
+
+static int getBufferSlot(GLenum target) {
+	switch (target) {
+	case GL_ARRAY_BUFFER: return ARRAY_SLOT;
+	case GL_ELEMENT_ARRAY_BUFFER: return ELEMENT_SLOT;
+	case GL_UNIFORM_BUFFER: return UNIFORM_SLOT;
+	case GL_DRAW_INDIRECT_BUFFER: return INDIRECT_SLOT;
+	default: return -1;
+	}
+}
+
+/** Forgets a deleted object, whose binding the GL reverts to \c 0. */
+static void forget(GLuint *cached, GLuint name) {
+	if (name != 0 && *cached == name + 1) *cached = 1;
+}
+
+void glh_use_program(GLuint program) {
+	if (update(&state.program, program)) glUseProgram(program);
+}
+
+void glh_bind_vertex_array(GLuint vertexArray) {
+	if (!update(&state.vertexArray, vertexArray)) return;
+	glBindVertexArray(vertexArray);
+	state.buffers[ELEMENT_SLOT] = 0;
+}
+
+void glh_bind_buffer(GLenum target, GLuint buffer) {
+	int slot = getBufferSlot(target);
+	if (slot < 0) state.counters.issued++;
+	else if (!update(state.buffers + slot, buffer)) return;
+	glBindBuffer(target, buffer);
+}
+
+void glh_bind_buffer_range(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+	int slot = getBufferSlot(target);
+	if (slot >= 0) state.buffers[slot] = buffer + 1;
+	state.counters.issued++;
+	glBindBufferRange(target, index, buffer, offset, size);
+}
+
+void glh_active_texture(GLuint unit) {
+	if (update(&state.activeTexture, unit)) glActiveTexture(GL_TEXTURE0 + unit);
+}
+
+void glh_bind_texture(GLenum target, GLuint texture) {
+	GLuint unit = state.activeTexture - 1;
+	if (target == GL_TEXTURE_2D && state.activeTexture != 0 && unit < GLH_TEXTURE_UNITS) {
+		if (!update(state.textures + unit, texture)) return;
+	}
+	else {
+		// The binding of an unknown unit may be any of the cached ones
+		if (target == GL_TEXTURE_2D && state.activeTexture == 0) memset(state.textures, 0, sizeof(state.textures));
+		state.counters.issued++;
+	}
+	glBindTexture(target, texture);
+}
+
+void glh_delete_vertex_arrays(GLsizei count, const GLuint *vertexArrays) {
+	for (GLsizei i = 0; i < count; i++) {
+		// The element array buffer binding goes with the vertex array object
+		if (vertexArrays[i] != 0 && state.vertexArray == vertexArrays[i] + 1) {
+			state.vertexArray = 1;
+			state.buffers[ELEMENT_SLOT] = 0;
+		}
+	}
+	glDeleteVertexArrays(count, vertexArrays);
+}
+
+void glh_delete_buffers(GLsizei count, const GLuint *buffers) {
+	for (GLsizei i = 0; i < count; i++) {
+		for (int slot = 0; slot < BUFFER_SLOTS; slot++) forget(state.buffers + slot, buffers[i]);
+	}
+	glDeleteBuffers(count, buffers);
+}
+
+void glh_delete_textures(GLsizei count, const GLuint *textures) {
+	for (GLsizei i = 0; i < count; i++) {
+		for (int unit = 0; unit < GLH_TEXTURE_UNITS; unit++) forget(state.textures + unit, textures[i]);
+	}
+	glDeleteTextures(count, textures);
+}
+
+void glh_reset_state(void) {
+	struct glh_state_counters counters = state.counters;
+	memset(&state, 0, sizeof(state));
+	state.counters = counters;
+}
+
+struct glh_state_counters glh_get_state_counters(void) {
+	return state.counters;
+}
+
 struct mesh * create_mesh(int indexed) {
-	GLuint buffers[2];
+	GLuint buffers[2] = { 0, 0 };
 	struct mesh *mesh = malloc(sizeof(struct mesh));
 	if (mesh == 0) return 0;
-	return glGenBuffers(1 + indexed, buffers), (mesh->vbo = buffers[0]), (mesh->ibo = buffers[1]), mesh;
+	glGenBuffers(1 + !!indexed, buffers);
+	mesh->vbo = buffers[0];
+	mesh->ibo = buffers[1];
+	mesh->vao = 0;
+	return mesh;
 }
 
 void destroy_mesh(struct mesh *mesh) {
 	GLuint buffers[] = { mesh->vbo, mesh->ibo };
-	glDeleteBuffers(2, buffers);
+	if (mesh->vao != 0) glh_delete_vertex_arrays(1, &mesh->vao);
+	glh_delete_buffers(2, buffers);
 	free(mesh);
 }
+
+int mesh_set_layout(struct mesh *mesh, const struct attrib *attributes, GLsizei stride) {
+	if (!GLEW_ARB_vertex_array_object) return 0;
+	// A new object starts with every attribute disabled
+	if (mesh->vao != 0) glh_delete_vertex_arrays(1, &mesh->vao);
+	glGenVertexArrays(1, &mesh->vao);
+	if (mesh->vao == 0) return 0;
+	glh_bind_vertex_array(mesh->vao);
+	glh_bind_buffer(GL_ARRAY_BUFFER, mesh->vbo);
+	for (int i = 0; attributes[i].size != 0; i++) {
+		glEnableVertexAttribArray(attributes[i].location);
+		glVertexAttribPointer(attributes[i].location, attributes[i].size, GL_FLOAT, GL_FALSE, stride, BUFFER_OFFSET(attributes[i].offset));
+	}
+	if (mesh->ibo != 0) glh_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, mesh->ibo);
+	return 1;
+}
@@ -52,28 +52,31 @@ static void maximizeTracks(float space, int count, struct track *tracks) {
 	if (unfrozen > 0) maximizeTracks(space, count, tracks);
 }
 
-static void stretchFlexibleTracks(float space, int count, struct track *tracks, struct size *template) {
-	float leftover = space, // Let leftover space be the space to fill minus the base sizes of the non - flexible grid tracks.
-		flexSum = 0; // Let flex factor sum be the sum of the flex factors of the flexible tracks. If this value is less than 1, set it to 1 instead.
-	for (int i = 0; i < count; i++) if (IS_FLEX(template[i].max)) flexSum += GET_FLEX(template[i].max); else leftover -= tracks[i].base;
-	float hypothetical = leftover / MAX(flexSum, 1); // Let the hypothetical fr size be the leftover space divided by the flex factor sum.
+#define IS_FROZEN(frozen, i) ((frozen)[(i) / 32] >> (i) % 32 & 1)
 
-	// If the product of the hypothetical fr size and a flexible track’s flex factor is less than the track’s base size, restart this algorithm treating all such tracks as inflexible.
-	for (int i = 0; i < count; i++) {
-		float flex = template[i].max;
-		if (IS_FLEX(flex) && hypothetical * GET_FLEX(flex) < tracks[i].base) {
-			// Create a copy of the template to not damage the original
-			struct size *templateCopy = malloc(count * sizeof(struct size));
-			if (templateCopy == 0) return;
-			memcpy(templateCopy, template, count * sizeof(struct size));
-			templateCopy[i].max = 0;
-			stretchFlexibleTracks(space, count, tracks, templateCopy);
-			free(templateCopy);
-			return;
+static void stretchFlexibleTracks(float space, int count, struct track *tracks, const struct size *template, unsigned int *frozen) {
+	// Flexible tracks that would shrink below their base size are frozen, and treated as inflexible from then on
+	memset(frozen, 0, (count + 31) / 32 * sizeof(unsigned int));
+	float hypothetical;
+	int restart;
+	do {
+		float leftover = space, // Let leftover space be the space to fill minus the base sizes of the non - flexible grid tracks.
+			flexSum = 0; // Let flex factor sum be the sum of the flex factors of the flexible tracks. If this value is less than 1, set it to 1 instead.
+		for (int i = 0; i < count; i++) if (IS_FLEX(template[i].max) && !IS_FROZEN(frozen, i)) flexSum += GET_FLEX(template[i].max); else leftover -= tracks[i].base;
+		hypothetical = leftover / MAX(flexSum, 1); // Let the hypothetical fr size be the leftover space divided by the flex factor sum.
+
+		// If the product of the hypothetical fr size and a flexible track’s flex factor is less than the track’s base size, restart this algorithm treating all such tracks as inflexible.
+		restart = 0;
+		for (int i = 0; i < count; i++) {
+			float flex = template[i].max;
+			if (IS_FLEX(flex) && !IS_FROZEN(frozen, i) && hypothetical * GET_FLEX(flex) < tracks[i].base) {
+				frozen[i / 32] |= 1u << i % 32;
+				restart = 1;
+			}
 		}
-	}
+	} while (restart);
 
-	for (int i = 0; i < count; i++) if (IS_FLEX(template[i].max)) tracks[i].base = hypothetical * GET_FLEX(template[i].max);
+	for (int i = 0; i < count; i++) if (IS_FLEX(template[i].max) && !IS_FROZEN(frozen, i)) tracks[i].base = hypothetical * GET_FLEX(template[i].max);
 }
 
 static void resolveIntrinsicTrackSizes(int start, int count, struct track *tracks, struct size *template, float minSize, float maxSize) {
@@ -113,12 +116,106 @@ static void resolveIntrinsicTrackSizes(int start, int count, struct track *track
 	for (int i = start, n = i + count; i < n; i++) if (template[i].max == MAX_CONTENT) tracks[i].growth += extraSpace;
 }
 
-void layoutGrid(struct gridlayout *grid, float layoutX, float layoutY, float layoutWidth, float layoutHeight) {
-	struct track *columnTracks = malloc(grid->columns * sizeof(struct track));
-	if (columnTracks == 0) return;
-	struct track *rowTracks = malloc(grid->rows * sizeof(struct track));
-	if (rowTracks == 0) return;
+/** The intrinsic sizes of an item, as returned by the callbacks. */
+struct measure {
+	float minWidth, maxWidth, minHeight, maxHeight;
+};
+
+struct gridcache {
+	int columns, rows, itemCount;
+	const struct item *items; /**< The items the cache was made for. */
+	size_t size; /**< The size of the memory holding the cache. */
+	int owned; /**< Non-zero if the cache was allocated by the grid rather than the caller. */
+	struct measure *measures;
+	unsigned char *measured; /**< Zero for every item to measure again. */
+	struct track *intrinsicColumns, *intrinsicRows, /**< The tracks after resolving the intrinsic sizes. */
+		*columnTracks, *rowTracks; /**< The final tracks for the layout size. */
+	float *columnOffsets, *rowOffsets; /**< The prefix sums of the final track sizes. */
+	unsigned int *frozen; /**< A bit for every track of the largest dimension, set for flexible tracks treated as inflexible. */
+	float width, height; /**< The layout size of the final tracks. */
+	int intrinsicValid, tracksValid;
+};
+
+size_t gridLayoutSize(const struct gridlayout *grid) {
+	// The widest types first to keep every array aligned
+	return sizeof(struct gridcache) + 2 * (grid->columns + grid->rows) * sizeof(struct track) + grid->itemCount * sizeof(struct measure)
+		+ (grid->columns + grid->rows + 2) * sizeof(float) + (MAX(grid->columns, grid->rows) + 31) / 32 * sizeof(unsigned int) + grid->itemCount;
+}
+
+/** Lays out an empty cache for the grid in memory of at least ::gridLayoutSize bytes. */
+static struct gridcache *placeCache(struct gridlayout *grid, void *storage, size_t size, int owned) {
+	memset(storage, 0, gridLayoutSize(grid));
+	struct gridcache *cache = storage;
+	cache->columns = grid->columns;
+	cache->rows = grid->rows;
+	cache->itemCount = grid->itemCount;
+	cache->items = grid->items;
+	cache->size = size;
+	cache->owned = owned;
+	cache->intrinsicColumns = (struct track *) (cache + 1);
+	cache->intrinsicRows = cache->intrinsicColumns + grid->columns;
+	cache->columnTracks = cache->intrinsicRows + grid->rows;
+	cache->rowTracks = cache->columnTracks + grid->columns;
+	cache->measures = (struct measure *) (cache->rowTracks + grid->rows);
+	cache->columnOffsets = (float *) (cache->measures + grid->itemCount);
+	cache->rowOffsets = cache->columnOffsets + grid->columns + 1;
+	cache->frozen = (unsigned int *) (cache->rowOffsets + grid->rows + 1);
+	cache->measured = (unsigned char *) (cache->frozen + (MAX(grid->columns, grid->rows) + 31) / 32);
+	grid->cache = cache;
+	return cache;
+}
+
+int initGridLayout(struct gridlayout *grid, void *storage, size_t size) {
+	if (size < gridLayoutSize(grid)) return 0;
+	freeGridLayout(grid);
+	placeCache(grid, storage, size, 0);
+	return 1;
+}
+
+/** Makes the cache fit the grid, starting anew if the grid's items or tracks have changed. */
+static struct gridcache *getCache(struct gridlayout *grid) {
+	struct gridcache *cache = grid->cache;
+	if (cache != 0 && cache->columns == grid->columns && cache->rows == grid->rows && cache->itemCount == grid->itemCount && cache->items == grid->items) return cache;
+
+	// Reuse the memory of the caller if it is large enough
+	size_t size = gridLayoutSize(grid);
+	if (cache != 0 && !cache->owned && cache->size >= size) return placeCache(grid, cache, cache->size, 0);
+	freeGridLayout(grid);
+	void *storage = malloc(size);
+	return storage != 0 ? placeCache(grid, storage, size, 1) : 0;
+}
+
+/** Measures the items that are not measured, returning non-zero if any size has changed. */
+static int measureItems(struct gridlayout *grid, struct gridcache *cache) {
+	int changed = 0;
+	for (int i = 0; i < grid->itemCount; i++) {
+		const struct gridlayout *child = grid->items[i].grid;
+		struct measure measure;
+		if (child != 0) {
+			// Nested grids are measured beforehand, and their sizes compared every time
+			measure.minWidth = child->gridMinWidth;
+			measure.maxWidth = child->gridMaxWidth;
+			measure.minHeight = child->gridMinHeight;
+			measure.maxHeight = child->gridMaxHeight;
+		}
+		else if (cache->measured[i]) continue;
+		else {
+			struct widget *widget = grid->items[i].widget;
+			measure.minWidth = grid->minWidth(widget);
+			measure.maxWidth = grid->maxWidth(widget);
+			measure.minHeight = grid->minHeight(widget);
+			measure.maxHeight = grid->maxHeight(widget);
+		}
+		changed |= memcmp(&measure, cache->measures + i, sizeof measure) != 0;
+		cache->measures[i] = measure;
+		cache->measured[i] = 1;
+	}
+	return changed;
+}
 
+/** Sizes the tracks to the intrinsic sizes of the items. */
+static void resolveIntrinsicTracks(struct gridlayout *grid, struct gridcache *cache) {
+	struct track *columnTracks = cache->intrinsicColumns, *rowTracks = cache->intrinsicRows;
 	// Initialize each track’s base size and growth limit.
 	initializeTrackSizes(grid->columns, columnTracks, grid->templateColumns);
 	initializeTrackSizes(grid->rows, rowTracks, grid->templateRows);
@@ -130,8 +227,10 @@ void layoutGrid(struct gridlayout *grid, float layoutX, float layoutY, float lay
 		span++;
 		for (int i = 0; i < grid->itemCount; i++) {
 			struct item item = grid->items[i];
-			if (item.colspan == span) resolveIntrinsicTrackSizes(item.column, item.colspan, columnTracks, grid->templateColumns, grid->minWidth(item.widget), grid->maxWidth(item.widget));
-			if (item.rowspan == span) resolveIntrinsicTrackSizes(item.row, item.rowspan, rowTracks, grid->templateRows, grid->minHeight(item.widget), grid->maxHeight(item.widget));
+			if (item.column < 0 || item.column >= grid->columns || item.row < 0 || item.row >= grid->rows) continue;
+			const struct measure *measure = cache->measures + i;
+			if (item.colspan == span) resolveIntrinsicTrackSizes(item.column, MIN(item.colspan, grid->columns - item.column), columnTracks, grid->templateColumns, measure->minWidth, measure->maxWidth);
+			if (item.rowspan == span) resolveIntrinsicTrackSizes(item.row, MIN(item.rowspan, grid->rows - item.row), rowTracks, grid->templateRows, measure->minHeight, measure->maxHeight);
 			repeat |= item.colspan > span | item.rowspan > span;
 		}
 	} while (repeat);
@@ -146,49 +245,255 @@ void layoutGrid(struct gridlayout *grid, float layoutX, float layoutY, float lay
 		grid->gridMinHeight += rowTracks[row].base;
 		grid->gridMaxHeight += rowTracks[row].growth;
 	}
+}
+
+/** Sizes the tracks to the layout size, starting from the intrinsic sizes. */
+static void sizeTracks(struct gridlayout *grid, struct gridcache *cache, float layoutWidth, float layoutHeight) {
+	struct track *columnTracks = cache->columnTracks, *rowTracks = cache->rowTracks;
+	memcpy(columnTracks, cache->intrinsicColumns, grid->columns * sizeof(struct track));
+	memcpy(rowTracks, cache->intrinsicRows, grid->rows * sizeof(struct track));
 
 	float freeWidth = layoutWidth - grid->gridMinWidth, freeHeight = layoutHeight - grid->gridMinHeight;
 	if (freeWidth > 0) maximizeTracks(freeWidth, grid->columns, columnTracks);
 	if (freeHeight > 0) maximizeTracks(freeHeight, grid->rows, rowTracks);
 
-	stretchFlexibleTracks(layoutWidth, grid->columns, columnTracks, grid->templateColumns);
-	stretchFlexibleTracks(layoutHeight, grid->rows, rowTracks, grid->templateRows);
+	stretchFlexibleTracks(layoutWidth, grid->columns, columnTracks, grid->templateColumns, cache->frozen);
+	stretchFlexibleTracks(layoutHeight, grid->rows, rowTracks, grid->templateRows, cache->frozen);
+
+	// Offset every track from the prefix sums of the sizes, so that the size of a grid area is the difference of two offsets.
+	cache->columnOffsets[0] = cache->rowOffsets[0] = 0;
+	for (int column = 0; column < grid->columns; column++) cache->columnOffsets[column + 1] = cache->columnOffsets[column] + columnTracks[column].base;
+	for (int row = 0; row < grid->rows; row++) cache->rowOffsets[row + 1] = cache->rowOffsets[row] + rowTracks[row].base;
+	cache->width = layoutWidth;
+	cache->height = layoutHeight;
+	cache->tracksValid = 1;
+}
+
+/** Returns the number of items that are nested grids. */
+static int countNested(const struct gridlayout *grid) {
+	int count = 0;
+	for (int i = 0; i < grid->itemCount; i++) count += grid->items[i].grid != 0;
+	return count;
+}
+
+static void measureGrid(struct gridlayout *grid, struct threadpool *pool);
+
+struct measure_job {
+	struct gridlayout *grid;
+	struct threadpool *pool;
+};
+
+static void measureNested(void *arg, int i) {
+	const struct measure_job *job = arg;
+	struct gridlayout *child = job->grid->items[i].grid;
+	if (child != 0) measureGrid(child, job->pool);
+}
+
+/** Resolves the intrinsic track sizes of a grid from the bottom up, after those of its nested grids. */
+static void measureGrid(struct gridlayout *grid, struct threadpool *pool) {
+	struct gridcache *cache = getCache(grid);
+	if (cache == 0) return;
+	int nested = countNested(grid);
+	if (nested > 0) {
+		// Sibling subtrees are independent, and only worth spreading over the pool if there are several
+		struct measure_job job = { grid, pool };
+		threadpool_parallel_for(nested > 1 ? pool : 0, grid->itemCount, measureNested, &job);
+	}
+
+	// Only measure the items invalidated since the last layout, and size the tracks only if the measurements have changed
+	if (measureItems(grid, cache) || !cache->intrinsicValid) {
+		resolveIntrinsicTracks(grid, cache);
+		cache->intrinsicValid = 1;
+		cache->tracksValid = 0;
+	}
+}
+
+static void arrangeGrid(struct gridlayout *grid, float layoutX, float layoutY, float layoutWidth, float layoutHeight, struct threadpool *pool);
+
+struct arrange_job {
+	struct gridlayout *grid;
+	struct threadpool *pool;
+};
+
+static void arrangeNested(void *arg, int i) {
+	const struct arrange_job *job = arg;
+	const struct item *item = job->grid->items + i;
+	if (item->grid != 0) arrangeGrid(item->grid, item->widget->x, item->widget->y, item->widget->width, item->widget->height, job->pool);
+}
+
+/** Sizes the tracks of a measured grid and positions its items from the top down, and then the items of its nested grids within their widgets. */
+static void arrangeGrid(struct gridlayout *grid, float layoutX, float layoutY, float layoutWidth, float layoutHeight, struct threadpool *pool) {
+	struct gridcache *cache = grid->cache;
+	if (cache == 0 || !cache->intrinsicValid) return;
+	if (!cache->tracksValid || layoutWidth != cache->width || layoutHeight != cache->height) sizeTracks(grid, cache, layoutWidth, layoutHeight);
 
 	// Position widgets within grid areas.
-	float currentX = layoutX, currentY;
-	for (int column = 0; column < grid->columns; column++) {
-		currentY = layoutY;
-		for (int row = 0; row < grid->rows; row++) {
-			// Find the item in the grid area
-			struct item *item = 0;
-			for (int i = 0; i < grid->itemCount; i++) if (grid->items[i].column == column && grid->items[i].row == row) item = grid->items + i;
+	const float *columnOffsets = cache->columnOffsets, *rowOffsets = cache->rowOffsets;
+	for (int i = 0; i < grid->itemCount; i++) {
+		struct item *item = grid->items + i;
+		if (item->column < 0 || item->column >= grid->columns || item->row < 0 || item->row >= grid->rows) continue;
+		int endColumn = MIN(item->column + item->colspan, grid->columns), endRow = MIN(item->row + item->rowspan, grid->rows);
+		float x = layoutX + columnOffsets[item->column], y = layoutY + rowOffsets[item->row],
+			width = columnOffsets[endColumn] - columnOffsets[item->column], height = rowOffsets[endRow] - rowOffsets[item->row];
+
+		// Nested grids fill their areas, their maximum sizes being those of inflexible tracks
+		float maxWidth = item->grid == 0 ? cache->measures[i].maxWidth : 0, maxHeight = item->grid == 0 ? cache->measures[i].maxHeight : 0;
 
-			if (item != 0) {
-				float width = 0, height = 0;
-				for (int i = column; i < column + item->colspan; i++) width += columnTracks[i].base;
-				for (int i = row; i < row + item->rowspan; i++) height += rowTracks[i].base;
+		item->widget->width = width * item->fillX;
+		if (maxWidth > 0) item->widget->width = MIN(item->widget->width, maxWidth);
 
-				float maxWidth = grid->maxWidth(item->widget), maxHeight = grid->maxHeight(item->widget);
+		item->widget->height = height * item->fillY;
+		if (maxHeight > 0) item->widget->height = MIN(item->widget->height, maxHeight);
 
-				item->widget->width = width * item->fillX;
-				if (maxWidth > 0) item->widget->width = MIN(item->widget->width, maxWidth);
+		if ((item->align & ALIGN_LEFT) != 0) item->widget->x = x;
+		else if ((item->align & ALIGN_RIGHT) != 0) item->widget->x = x + width - item->widget->width;
+		else item->widget->x = x + (width - item->widget->width) / 2;
 
-				item->widget->height = height * item->fillY;
-				if (maxHeight > 0) item->widget->height = MIN(item->widget->height, maxHeight);
+		if ((item->align & ALIGN_TOP) != 0) item->widget->y = y;
+		else if ((item->align & ALIGN_BOTTOM) != 0) item->widget->y = y + height - item->widget->height;
+		else item->widget->y = y + (height - item->widget->height) / 2;
+	}
 
-				if ((item->align & ALIGN_LEFT) != 0) item->widget->x = currentX;
-				else if ((item->align & ALIGN_RIGHT) != 0) item->widget->x = currentX + columnTracks[item->column].base - item->widget->width;
-				else item->widget->x = currentX + (width - item->widget->width) / 2;
+	int nested = countNested(grid);
+	if (nested > 0) {
+		struct arrange_job job = { grid, pool };
+		threadpool_parallel_for(nested > 1 ? pool : 0, grid->itemCount, arrangeNested, &job);
+	}
+}
+
+void layoutGrid(struct gridlayout *grid, float layoutX, float layoutY, float layoutWidth, float layoutHeight) {
+	layoutGridTree(grid, layoutX, layoutY, layoutWidth, layoutHeight, 0);
+}
+
+void layoutGridTree(struct gridlayout *grid, float layoutX, float layoutY, float layoutWidth, float layoutHeight, struct threadpool *pool) {
+	measureGrid(grid, pool);
+	arrangeGrid(grid, layoutX, layoutY, layoutWidth, layoutHeight, pool);
+}
+
+void invalidateGrid(struct gridlayout *grid) {
+	struct gridcache *cache = grid->cache;
+	if (cache != 0) cache->intrinsicValid = 0;
+}
+
+void invalidateGridItem(struct gridlayout *grid, int item) {
+	struct gridcache *cache = grid->cache;
+	if (cache != 0 && item >= 0 && item < cache->itemCount) cache->measured[item] = 0;
+}
+
+void freeGridLayout(struct gridlayout *grid) {
+	if (grid->cache != 0 && grid->cache->owned) free(grid->cache);
+	grid->cache = 0;
+}
+
+/** Adds to the height of a row in the Fenwick tree. */
+static void updateRowTree(struct virtualgrid *grid, int row, double delta) {
+	for (int i = row + 1; i <= grid->rowCount; i += i & -i) grid->tree[i] += delta;
+}
 
-				if ((item->align & ALIGN_TOP) != 0) item->widget->y = currentY;
-				else if ((item->align & ALIGN_BOTTOM) != 0) item->widget->y = currentY + height - item->widget->height;
-				else item->widget->y = currentY + (height - item->widget->height) / 2;
+/** Returns the total height of the rows before one from the Fenwick tree. */
+static double sumRowTree(const struct virtualgrid *grid, int row) {
+	double sum = 0;
+	for (int i = row; i > 0; i -= i & -i) sum += grid->tree[i];
+	return sum;
+}
+
+int setVirtualGridRows(struct virtualgrid *grid, int rowCount) {
+	if (rowCount < 0) return 0;
+	if (grid->tree == 0 || rowCount <= grid->rowCount) {
+		grid->rowCount = rowCount;
+		return 1;
+	}
+	if (rowCount > grid->capacity) {
+		int capacity = MAX(rowCount, 2 * grid->capacity);
+		float *heights = realloc(grid->heights, capacity * sizeof(float));
+		if (heights != 0) grid->heights = heights;
+		double *tree = realloc(grid->tree, (capacity + 1) * sizeof(double));
+		if (tree != 0) grid->tree = tree;
+		if (heights == 0 || tree == 0) return 0;
+		grid->capacity = capacity;
+	}
+	// The nodes of the new rows cover the tail of the old rows, whose sum is known, and new rows of the default height
+	int oldCount = grid->rowCount;
+	double oldSum = sumRowTree(grid, oldCount);
+	for (int i = oldCount + 1; i <= rowCount; i++) {
+		int low = i - (i & -i);
+		grid->heights[i - 1] = grid->rowHeight;
+		grid->tree[i] = (low < oldCount ? oldSum - sumRowTree(grid, low) : 0) + (double) (i - MAX(low, oldCount)) * grid->rowHeight;
+	}
+	grid->rowCount = rowCount;
+	return 1;
+}
+
+int setVirtualGridRowHeight(struct virtualgrid *grid, int row, float height) {
+	if (row < 0 || row >= grid->rowCount) return 0;
+	if (grid->tree == 0) {
+		if (height == grid->rowHeight) return 1;
+		// Rows of the default height need no tree, which is built on the first row of another height
+		int capacity = grid->rowCount;
+		grid->heights = malloc(capacity * sizeof(float));
+		grid->tree = calloc(capacity + 1, sizeof(double));
+		if (grid->heights == 0 || grid->tree == 0) {
+			freeVirtualGrid(grid);
+			return 0;
+		}
+		grid->capacity = capacity;
+		for (int i = 0; i < capacity; i++) grid->heights[i] = grid->rowHeight;
+		for (int i = 1; i <= capacity; i++) grid->tree[i] = (double) (i & -i) * grid->rowHeight;
+	}
+	updateRowTree(grid, row, (double) height - grid->heights[row]);
+	grid->heights[row] = height;
+	return 1;
+}
+
+float getVirtualGridRowHeight(const struct virtualgrid *grid, int row) {
+	return grid->tree != 0 && row >= 0 && row < grid->rowCount ? grid->heights[row] : grid->rowHeight;
+}
+
+double getVirtualGridRowOffset(const struct virtualgrid *grid, int row) {
+	row = MAX(0, MIN(row, grid->rowCount));
+	return grid->tree != 0 ? sumRowTree(grid, row) : (double) row * grid->rowHeight;
+}
+
+int getVirtualGridRowAt(const struct virtualgrid *grid, double y) {
+	if (y < 0 || grid->rowCount == 0) return -1;
+	int row;
+	if (grid->tree == 0) row = grid->rowHeight > 0 ? (int) MIN(y / grid->rowHeight, grid->rowCount) : grid->rowCount;
+	else {
+		// Descend the tree for the last row starting at or before the offset
+		int step = 1;
+		while (step * 2 <= grid->rowCount) step *= 2;
+		double remaining = y;
+		for (row = 0; step > 0; step /= 2) {
+			if (row + step <= grid->rowCount && grid->tree[row + step] <= remaining) {
+				row += step;
+				remaining -= grid->tree[row];
 			}
-			currentY += rowTracks[row].base;
 		}
-		currentX += columnTracks[column].base;
 	}
+	return row < grid->rowCount ? row : -1;
+}
+
+int layoutVirtualGrid(struct virtualgrid *grid, float layoutX, float layoutY, float layoutWidth, float layoutHeight, double scrollY) {
+	int row = getVirtualGridRowAt(grid, MAX(scrollY, 0)), count = 0;
+	if (row < 0) return 0;
+	// Lay out relative to the scroll offset in double precision, as the offsets of far rows are beyond the precision of float
+	for (double offset = getVirtualGridRowOffset(grid, row); row < grid->rowCount && offset < scrollY + layoutHeight; row++, count++) {
+		grid->bindRow(grid, row);
+		float height = getVirtualGridRowHeight(grid, row), y = layoutY + (float) (offset - scrollY);
+		layoutGrid(grid->row, layoutX, y, layoutWidth, height);
+		if (grid->fitRows && grid->row->gridMinHeight != height && setVirtualGridRowHeight(grid, row, grid->row->gridMinHeight)) {
+			height = grid->row->gridMinHeight;
+			layoutGrid(grid->row, layoutX, y, layoutWidth, height);
+		}
+		offset += height;
+	}
+	return count;
+}
 
-	free(columnTracks);
-	free(rowTracks);
+void freeVirtualGrid(struct virtualgrid *grid) {
+	free(grid->heights);
+	free(grid->tree);
+	grid->heights = 0;
+	grid->tree = 0;
+	grid->capacity = 0;
 }
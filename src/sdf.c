@@ -0,0 +1,143 @@
+#include "sdf.h"
+#include <stdlib.h>
+#include <math.h>
+
+/** Stands in for the distance to a set with no pixels, squared without overflowing. */
+#define FAR 1e20f
+/** The number of columns transformed by a task, sharing its scratch memory. */
+#define COLUMNS_PER_TASK 16
+
+/** The scratch memory of the transform of a line of \a n pixels. */
+struct line {
+	float *f, *d, *z;
+	int *v;
+};
+
+static int createLine(struct line *line, unsigned int n) {
+	line->f = malloc(n * sizeof(float));
+	line->d = malloc(n * sizeof(float));
+	line->z = malloc((n + 1) * sizeof(float));
+	line->v = malloc(n * sizeof(int));
+	return line->f != 0 && line->d != 0 && line->z != 0 && line->v != 0;
+}
+
+static void destroyLine(struct line *line) {
+	free(line->f);
+	free(line->d);
+	free(line->z);
+	free(line->v);
+}
+
+/** Computes <tt>d[q] = min over p of (q - p)^2 + f[p]</tt>, the lower envelope of the parabolas rooted at every pixel. */
+static void transformLine(struct line *line, unsigned int n) {
+	const float *f = line->f;
+	float *d = line->d, *z = line->z;
+	int *v = line->v, k = 0;
+	v[0] = 0;
+	z[0] = -FAR;
+	z[1] = FAR;
+	for (int q = 1; q < (int) n; q++) {
+		// Drop the parabolas hidden by the one rooted at q, which is never all of them as z[0] is below any intersection
+		float s = ((f[q] + (float) q * q) - (f[v[k]] + (float) v[k] * v[k])) / (2.0f * (q - v[k]));
+		while (s <= z[k]) {
+			k--;
+			s = ((f[q] + (float) q * q) - (f[v[k]] + (float) v[k] * v[k])) / (2.0f * (q - v[k]));
+		}
+		v[++k] = q;
+		z[k] = s;
+		z[k + 1] = FAR;
+	}
+	k = 0;
+	for (int q = 0; q < (int) n; q++) {
+		while (z[k + 1] < q) k++;
+		float offset = (float) (q - v[k]);
+		d[q] = offset * offset + f[v[k]];
+	}
+}
+
+struct sdf_job {
+	const unsigned char *coverage;
+	unsigned int width, height;
+	ptrdiff_t stride;
+	unsigned int scale;
+	float spread;
+	unsigned char *distances;
+	float *inside, /**< The squared distance of every pixel to the nearest inside pixel. */
+		*outside; /**< The squared distance of every pixel to the nearest outside pixel. */
+	int failed;
+};
+
+/** Transforms a band of columns, seeding both fields from the coverage. */
+static void transformColumns(void *arg, int task) {
+	struct sdf_job *job = arg;
+	struct line line;
+	if (!createLine(&line, job->height)) {
+		destroyLine(&line);
+		job->failed = 1;
+		return;
+	}
+	unsigned int first = task * COLUMNS_PER_TASK, last = first + COLUMNS_PER_TASK < job->width ? first + COLUMNS_PER_TASK : job->width;
+	for (unsigned int x = first; x < last; x++) {
+		for (int field = 0; field < 2; field++) {
+			float *grid = field == 0 ? job->inside : job->outside;
+			for (unsigned int y = 0; y < job->height; y++) {
+				int isInside = job->coverage[y * job->stride + x] >= 128;
+				line.f[y] = isInside == (field == 0) ? 0.0f : FAR;
+			}
+			transformLine(&line, job->height);
+			for (unsigned int y = 0; y < job->height; y++) grid[(size_t) y * job->width + x] = line.d[y];
+		}
+	}
+	destroyLine(&line);
+}
+
+/** Transforms the source rows of a row of the output, and averages the signed distances over every output pixel. */
+static void transformRows(void *arg, int row) {
+	struct sdf_job *job = arg;
+	unsigned int scale = job->scale, outWidth = job->width / scale;
+	struct line line;
+	float *sums = calloc(outWidth, sizeof(float));
+	if (sums == 0 || !createLine(&line, job->width)) {
+		if (sums != 0) destroyLine(&line);
+		free(sums);
+		job->failed = 1;
+		return;
+	}
+	for (unsigned int y = row * scale; y < (row + 1) * scale; y++) {
+		float *inside = job->inside + (size_t) y * job->width, *outside = job->outside + (size_t) y * job->width;
+		for (unsigned int x = 0; x < job->width; x++) line.f[x] = inside[x];
+		transformLine(&line, job->width);
+		for (unsigned int x = 0; x < job->width; x++) inside[x] = line.d[x];
+		for (unsigned int x = 0; x < job->width; x++) line.f[x] = outside[x];
+		transformLine(&line, job->width);
+		for (unsigned int x = 0; x < outWidth * scale; x++) {
+			// The edge lies half a pixel beyond the centers of the pixels on either side of it
+			float distance = inside[x] > 0.0f ? sqrtf(inside[x]) - 0.5f : 0.5f - sqrtf(line.d[x]);
+			sums[x / scale] += distance;
+		}
+	}
+	unsigned char *out = job->distances + (size_t) row * outWidth;
+	float factor = 127.5f / (job->spread * scale * scale);
+	for (unsigned int x = 0; x < outWidth; x++) {
+		float value = 127.5f - sums[x] * factor;
+		out[x] = (unsigned char) (value <= 0.0f ? 0 : value >= 255.0f ? 255 : value + 0.5f);
+	}
+	destroyLine(&line);
+	free(sums);
+}
+
+int sdf_generate(const unsigned char *coverage, unsigned int width, unsigned int height, ptrdiff_t stride, unsigned int scale, float spread, unsigned char *distances, struct threadpool *pool) {
+	if (scale == 0 || spread <= 0.0f) return 0;
+	if (width / scale == 0 || height / scale == 0) return 1;
+	struct sdf_job job = { coverage, width, height, stride, scale, spread, distances, 0, 0, 0 };
+	job.inside = malloc((size_t) width * height * sizeof(float));
+	job.outside = malloc((size_t) width * height * sizeof(float));
+	if (job.inside != 0 && job.outside != 0) {
+		threadpool_parallel_for(pool, (width + COLUMNS_PER_TASK - 1) / COLUMNS_PER_TASK, transformColumns, &job);
+		if (!job.failed) threadpool_parallel_for(pool, height / scale, transformRows, &job);
+	}
+	int success = job.inside != 0 && job.outside != 0 && !job.failed;
+	free(job.inside);
+	free(job.outside);
+	return success;
+}
@@ -0,0 +1,212 @@
+#include "spritebatch.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+/** The bits of a sort key below the depth, which select the program and texture. */
+#define STATE_MASK ((UINT64_C(1) << 48) - 1)
+
+/** A run of consecutive sprites drawn with one call. */
+struct run {
+	unsigned int start, count;
+	GLuint program, texture;
+};
+
+struct sprite_batch {
+	unsigned int count, capacity;
+	struct sprite_instance *instances; /**< The records in the order they were added. */
+	uint64_t *keys, /**< The depth, program slot and texture of every sprite, from the most significant bits, in the order they were added. */
+		*sortedKeys, /**< The keys in drawing order, as of the last sort. */
+		*scratchKeys; /**< Room for the keys while sorting. */
+	uint32_t *order, /**< The index of every sprite in drawing order, as of the last sort. */
+		*scratchOrder; /**< Room for the order while sorting. */
+	struct run *runs; /**< The runs of the last sort, with room for one per sprite. */
+	unsigned int runCount;
+	GLuint programs[SPRITE_BATCH_PROGRAMS];
+	unsigned int programCount, lastProgram; /**< The number of programs, and the slot of the last one added. */
+	GLuint vertexArray, /**< The vertex array object of the instance attributes. */
+		buffer; /**< The stream buffer the attributes point into. */
+};
+
+/** Grows the arrays of the sprites together. */
+static int reserveSprites(struct sprite_batch *batch, unsigned int count) {
+	if (count <= batch->capacity) return 1;
+	unsigned int capacity = batch->capacity > 0 ? batch->capacity * 2 : 64;
+	while (capacity < count) capacity *= 2;
+	void *arrays[] = { batch->instances, batch->keys, batch->sortedKeys, batch->scratchKeys, batch->order, batch->scratchOrder, batch->runs };
+	const size_t sizes[] = { sizeof(struct sprite_instance), sizeof(uint64_t), sizeof(uint64_t), sizeof(uint64_t), sizeof(uint32_t), sizeof(uint32_t), sizeof(struct run) };
+	for (int i = 0; i < 7; i++) {
+		void *grown = realloc(arrays[i], capacity * sizes[i]);
+		if (grown == 0) return 0;
+		arrays[i] = grown;
+		// Keep every array grown so far, as the old pointers are gone
+		batch->instances = arrays[0];
+		batch->keys = arrays[1];
+		batch->sortedKeys = arrays[2];
+		batch->scratchKeys = arrays[3];
+		batch->order = arrays[4];
+		batch->scratchOrder = arrays[5];
+		batch->runs = arrays[6];
+	}
+	batch->capacity = capacity;
+	return 1;
+}
+
+struct sprite_batch *create_sprite_batch(unsigned int capacity) {
+	struct sprite_batch *batch = calloc(1, sizeof(struct sprite_batch));
+	if (batch == 0) return 0;
+	if (!reserveSprites(batch, capacity)) {
+		destroy_sprite_batch(batch);
+		return 0;
+	}
+	return batch;
+}
+
+void destroy_sprite_batch(struct sprite_batch *batch) {
+	if (batch->vertexArray != 0) glh_delete_vertex_arrays(1, &batch->vertexArray);
+	free(batch->instances);
+	free(batch->keys);
+	free(batch->sortedKeys);
+	free(batch->scratchKeys);
+	free(batch->order);
+	free(batch->scratchOrder);
+	free(batch->runs);
+	free(batch);
+}
+
+int sprite_batch_add(struct sprite_batch *batch, GLuint program, GLuint texture, unsigned short depth, const struct sprite_instance *sprite) {
+	if (!reserveSprites(batch, batch->count + 1)) return 0;
+	unsigned int slot = batch->lastProgram;
+	if (slot >= batch->programCount || batch->programs[slot] != program) {
+		for (slot = 0; slot < batch->programCount && batch->programs[slot] != program; slot++);
+		if (slot == batch->programCount) {
+			if (slot == SPRITE_BATCH_PROGRAMS) return 0;
+			batch->programs[batch->programCount++] = program;
+		}
+		batch->lastProgram = slot;
+	}
+	batch->instances[batch->count] = *sprite;
+	batch->keys[batch->count++] = (uint64_t) depth << 48 | (uint64_t) slot << 32 | texture;
+	return 1;
+}
+
+/** Sorts the keys into drawing order with a least significant digit radix sort of bytes, which is stable, skipping the bytes every key shares.
+	The keys stay in the order the sprites were added, so that the batch can be sorted again. */
+static void sortKeys(struct sprite_batch *batch) {
+	unsigned int n = batch->count, counts[8][256];
+	memset(counts, 0, sizeof(counts));
+	uint64_t *keys = batch->keys;
+	for (unsigned int i = 0; i < n; i++) {
+		for (int digit = 0; digit < 8; digit++) counts[digit][(keys[i] >> 8 * digit) & 0xFF]++;
+	}
+
+	uint64_t *source = keys;
+	uint32_t *sourceOrder = 0;
+	uint64_t *target = batch->sortedKeys, *spare = batch->scratchKeys;
+	uint32_t *targetOrder = batch->order, *spareOrder = batch->scratchOrder;
+	for (int digit = 0; digit < 8; digit++) {
+		unsigned int shift = 8 * digit, *offsets = counts[digit];
+		if (offsets[(keys[0] >> shift) & 0xFF] == n) continue;
+		for (unsigned int i = 0, sum = 0; i < 256; i++) {
+			unsigned int count = offsets[i];
+			offsets[i] = sum;
+			sum += count;
+		}
+		for (unsigned int i = 0; i < n; i++) {
+			unsigned int position = offsets[(source[i] >> shift) & 0xFF]++;
+			target[position] = source[i];
+			// The first pass reads the sprites in the order they were added
+			targetOrder[position] = sourceOrder != 0 ? sourceOrder[i] : i;
+		}
+		source = target;
+		target = spare;
+		spare = source;
+		sourceOrder = targetOrder;
+		targetOrder = spareOrder;
+		spareOrder = sourceOrder;
+	}
+
+	if (sourceOrder == 0) {
+		memcpy(batch->sortedKeys, keys, n * sizeof(uint64_t));
+		for (unsigned int i = 0; i < n; i++) batch->order[i] = i;
+		return;
+	}
+	// The last targets hold the result, and the others are room for the next sort
+	batch->sortedKeys = source;
+	batch->scratchKeys = target;
+	batch->order = sourceOrder;
+	batch->scratchOrder = targetOrder;
+}
+
+unsigned int sprite_batch_prepare(struct sprite_batch *batch, struct sprite_instance *instances) {
+	batch->runCount = 0;
+	if (batch->count == 0) return 0;
+	sortKeys(batch);
+	const uint64_t *keys = batch->sortedKeys;
+	const uint32_t *order = batch->order;
+	struct run *run = 0;
+	for (unsigned int i = 0; i < batch->count; i++) {
+		instances[i] = batch->instances[order[i]];
+		if (run != 0 && (keys[i] & STATE_MASK) == (keys[i - 1] & STATE_MASK)) {
+			run->count++;
+			continue;
+		}
+		run = batch->runs + batch->runCount++;
+		run->start = i;
+		run->count = 1;
+		run->program = batch->programs[(keys[i] >> 32) & 0xFF];
+		run->texture = (GLuint) keys[i];
+	}
+	return batch->runCount;
+}
+
+/** Points the instance attributes at the start of the stream buffer, for draws to pick their records by base instance. */
+static void setLayout(struct sprite_batch *batch, GLuint buffer) {
+	if (batch->vertexArray == 0) glGenVertexArrays(1, &batch->vertexArray);
+	batch->buffer = buffer;
+	glh_bind_vertex_array(batch->vertexArray);
+	glh_bind_buffer(GL_ARRAY_BUFFER, buffer);
+	GLsizei stride = sizeof(struct sprite_instance);
+	glEnableVertexAttribArray(SPRITE_RECT_LOCATION);
+	glVertexAttribPointer(SPRITE_RECT_LOCATION, 4, GL_FLOAT, GL_FALSE, stride, BUFFER_OFFSET(offsetof(struct sprite_instance, x)));
+	glEnableVertexAttribArray(SPRITE_UV_LOCATION);
+	glVertexAttribPointer(SPRITE_UV_LOCATION, 4, GL_UNSIGNED_SHORT, GL_TRUE, stride, BUFFER_OFFSET(offsetof(struct sprite_instance, u0)));
+	glEnableVertexAttribArray(SPRITE_COLOR_LOCATION);
+	glVertexAttribPointer(SPRITE_COLOR_LOCATION, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, BUFFER_OFFSET(offsetof(struct sprite_instance, color)));
+	glVertexAttribDivisor(SPRITE_RECT_LOCATION, 1);
+	glVertexAttribDivisor(SPRITE_UV_LOCATION, 1);
+	glVertexAttribDivisor(SPRITE_COLOR_LOCATION, 1);
+}
+
+int sprite_batch_draw(struct sprite_batch *batch, struct stream_buffer *stream) {
+	if (batch->count == 0) return 0;
+	GLintptr offset;
+	struct sprite_instance *instances;
+	if (!GLEW_ARB_base_instance
+		|| (instances = stream_buffer_alloc(stream, batch->count * sizeof(struct sprite_instance), sizeof(struct sprite_instance), &offset)) == 0) {
+		sprite_batch_clear(batch);
+		return -1;
+	}
+	unsigned int runs = sprite_batch_prepare(batch, instances);
+	if (batch->vertexArray == 0 || batch->buffer != stream->buffer) setLayout(batch, stream->buffer);
+	glh_bind_vertex_array(batch->vertexArray);
+
+	// The records start at a multiple of their size, so that every run starts at a whole instance
+	GLuint base = (GLuint) (offset / sizeof(struct sprite_instance));
+	for (unsigned int i = 0; i < runs; i++) {
+		const struct run *run = batch->runs + i;
+		glh_use_program(run->program);
+		glh_bind_texture(GL_TEXTURE_2D, run->texture);
+		glDrawArraysInstancedBaseInstance(GL_TRIANGLE_STRIP, 0, 4, run->count, base + run->start);
+	}
+	sprite_batch_clear(batch);
+	return (int) runs;
+}
+
+void sprite_batch_clear(struct sprite_batch *batch) {
+	batch->count = batch->programCount = batch->lastProgram = 0;
+}
+
+unsigned int sprite_batch_count(const struct sprite_batch *batch) {
+	return batch->count;
+}
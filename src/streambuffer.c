@@ -0,0 +1,68 @@
+#include "streambuffer.h"
+#include <stdlib.h>
+
+/** The alignment of the regions, the largest uniform buffer offset alignment allowed. */
+#define REGION_ALIGNMENT 256
+
+struct stream_buffer *create_stream_buffer(size_t frameSize) {
+	if (!GLEW_ARB_buffer_storage || !GLEW_ARB_sync || frameSize == 0) return 0;
+	struct stream_buffer *stream = calloc(1, sizeof(struct stream_buffer));
+	if (stream == 0) return 0;
+	stream->frameSize = (frameSize + REGION_ALIGNMENT - 1) / REGION_ALIGNMENT * REGION_ALIGNMENT;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &stream->uniformAlignment);
+	if (stream->uniformAlignment <= 0) stream->uniformAlignment = REGION_ALIGNMENT;
+	glGenBuffers(1, &stream->buffer);
+	if (stream->buffer == 0) {
+		free(stream);
+		return 0;
+	}
+
+	GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glh_bind_buffer(GL_ARRAY_BUFFER, stream->buffer);
+	glBufferStorage(GL_ARRAY_BUFFER, STREAM_BUFFER_FRAMES * stream->frameSize, 0, access);
+	if ((stream->mapping = glMapBufferRange(GL_ARRAY_BUFFER, 0, STREAM_BUFFER_FRAMES * stream->frameSize, access)) == 0) {
+		destroy_stream_buffer(stream);
+		return 0;
+	}
+	return stream;
+}
+
+void destroy_stream_buffer(struct stream_buffer *stream) {
+	for (int i = 0; i < STREAM_BUFFER_FRAMES; i++) {
+		if (stream->fences[i] != 0) glDeleteSync(stream->fences[i]);
+	}
+	// Deleting the buffer unmaps it
+	glh_delete_buffers(1, &stream->buffer);
+	free(stream);
+}
+
+/** Waits for the GL to finish reading the region of the current frame, when it was last written to frames ago. */
+static void waitRegion(struct stream_buffer *stream) {
+	GLsync fence = stream->fences[stream->frame];
+	if (fence == 0) return;
+	if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+		stream->stalls++;
+		// Flushing submits the fence, so that the wait ends
+		while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED);
+	}
+	glDeleteSync(fence);
+	stream->fences[stream->frame] = 0;
+}
+
+void *stream_buffer_alloc(struct stream_buffer *stream, size_t size, size_t alignment, GLintptr *offset) {
+	size_t start = stream->frame * stream->frameSize, end = start + stream->frameSize, position = start + stream->used;
+	if (alignment > 1) position = (position + alignment - 1) / alignment * alignment;
+	if (position > end || size > end - position) return 0;
+	waitRegion(stream);
+	stream->used = position + size - start;
+	*offset = (GLintptr) position;
+	return stream->mapping + position;
+}
+
+void stream_buffer_end_frame(struct stream_buffer *stream) {
+	if (stream->used > 0) {
+		stream->fences[stream->frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		stream->used = 0;
+	}
+	stream->frame = (stream->frame + 1) % STREAM_BUFFER_FRAMES;
+}
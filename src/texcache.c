@@ -0,0 +1,321 @@
+#include "texcache.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "bitmap_dds.h"
+#include "glh.h"
+
+/** The initial number of buckets of the hash tables, a power of two. */
+#define INITIAL_BUCKETS 64
+
+struct entry {
+	struct cached_texture texture; /**< The public handle, must be first. */
+	char *path; /**< The path of the file, or \c 0 if loaded from memory. */
+	uint64_t pathHash, contentHash;
+	size_t contentSize;
+	int flags;
+	unsigned int references;
+	struct dds_image image; /**< The layout of the uploaded pixel data, which is decompressed if the driver lacks the format. */
+	unsigned int baseLevel; /**< The largest mipmap level resident in video memory. */
+	struct entry *nextByPath, *nextByContent, /**< The next entry of the same bucket. */
+		*prev, *next; /**< Links of the list of entries, most recently used first. */
+};
+
+struct texcache {
+	struct entry **pathBuckets, **contentBuckets;
+	size_t bucketCount, count;
+	struct entry *first, *last;
+	size_t budget, resident;
+};
+
+/** Returns the 64-bit FNV-1a hash of the bytes. */
+static uint64_t hashBytes(const void *data, size_t size) {
+	const unsigned char *bytes = data;
+	uint64_t hash = 14695981039346656037ULL;
+	for (size_t i = 0; i < size; i++) hash = (hash ^ bytes[i]) * 1099511628211ULL;
+	return hash;
+}
+
+static void unlinkEntry(struct texcache *cache, struct entry *entry) {
+	if (entry->prev != 0) entry->prev->next = entry->next;
+	else cache->first = entry->next;
+	if (entry->next != 0) entry->next->prev = entry->prev;
+	else cache->last = entry->prev;
+}
+
+static void pushEntry(struct texcache *cache, struct entry *entry) {
+	entry->prev = 0;
+	if ((entry->next = cache->first) != 0) entry->next->prev = entry;
+	else cache->last = entry;
+	cache->first = entry;
+}
+
+/** Inserts an entry into the hash tables, doubling them when they fill up. */
+static int insertEntry(struct texcache *cache, struct entry *entry) {
+	if (cache->count >= cache->bucketCount) {
+		size_t bucketCount = 2 * cache->bucketCount;
+		struct entry **pathBuckets = calloc(bucketCount, sizeof(struct entry *)), **contentBuckets = calloc(bucketCount, sizeof(struct entry *));
+		if (pathBuckets == 0 || contentBuckets == 0) {
+			free(pathBuckets);
+			free(contentBuckets);
+			return 0;
+		}
+		for (struct entry *e = cache->first; e != 0; e = e->next) {
+			if (e->path != 0) {
+				e->nextByPath = pathBuckets[e->pathHash & (bucketCount - 1)];
+				pathBuckets[e->pathHash & (bucketCount - 1)] = e;
+			}
+			e->nextByContent = contentBuckets[e->contentHash & (bucketCount - 1)];
+			contentBuckets[e->contentHash & (bucketCount - 1)] = e;
+		}
+		free(cache->pathBuckets);
+		free(cache->contentBuckets);
+		cache->pathBuckets = pathBuckets;
+		cache->contentBuckets = contentBuckets;
+		cache->bucketCount = bucketCount;
+	}
+
+	size_t mask = cache->bucketCount - 1;
+	if (entry->path != 0) {
+		entry->nextByPath = cache->pathBuckets[entry->pathHash & mask];
+		cache->pathBuckets[entry->pathHash & mask] = entry;
+	}
+	entry->nextByContent = cache->contentBuckets[entry->contentHash & mask];
+	cache->contentBuckets[entry->contentHash & mask] = entry;
+	cache->count++;
+	pushEntry(cache, entry);
+	return 1;
+}
+
+/** Removes an entry from the cache and deletes its texture. */
+static void destroyEntry(struct texcache *cache, struct entry *entry) {
+	size_t mask = cache->bucketCount - 1;
+	if (entry->path != 0) {
+		struct entry **link = cache->pathBuckets + (entry->pathHash & mask);
+		while (*link != entry) link = &(*link)->nextByPath;
+		*link = entry->nextByPath;
+	}
+	struct entry **link = cache->contentBuckets + (entry->contentHash & mask);
+	while (*link != entry) link = &(*link)->nextByContent;
+	*link = entry->nextByContent;
+	cache->count--;
+	unlinkEntry(cache, entry);
+
+	glh_delete_textures(1, &entry->texture.texture);
+	cache->resident -= entry->texture.bytes;
+	free(entry->path);
+	free(entry);
+}
+
+static struct entry *findPath(const struct texcache *cache, const char *path, uint64_t hash, int flags) {
+	for (struct entry *entry = cache->pathBuckets[hash & (cache->bucketCount - 1)]; entry != 0; entry = entry->nextByPath) {
+		if (entry->pathHash == hash && entry->flags == flags && strcmp(entry->path, path) == 0) return entry;
+	}
+	return 0;
+}
+
+static struct entry *findContent(const struct texcache *cache, uint64_t hash, size_t size, int flags) {
+	for (struct entry *entry = cache->contentBuckets[hash & (cache->bucketCount - 1)]; entry != 0; entry = entry->nextByContent) {
+		if (entry->contentHash == hash && entry->contentSize == size && entry->flags == flags) return entry;
+	}
+	return 0;
+}
+
+/** Returns the number of bytes of video memory the levels from \a baseLevel down occupy. */
+static size_t getResidentBytes(const struct dds_image *image, unsigned int baseLevel) {
+	size_t bytes = 0;
+	for (unsigned int i = baseLevel; i < image->levels; i++) bytes += (size_t) image->layers * image->faces * image->mipmaps[i].size;
+	return bytes;
+}
+
+/** Releases the largest resident mipmap level of a texture. */
+static void evictLevel(struct texcache *cache, struct entry *entry) {
+	size_t bytes = dds_evict_level(&entry->image, entry->texture.texture, entry->baseLevel++);
+	entry->texture.bytes -= bytes;
+	cache->resident -= bytes;
+}
+
+static int isOverBudget(const struct texcache *cache, size_t reserve) {
+	return cache->budget != 0 && cache->resident + reserve > cache->budget;
+}
+
+/** Evicts until \a reserve more bytes fit within the budget, sparing \a keep.
+	Unused textures go first, least recently used first. Unless reserving, the largest levels of textures in use follow.
+	@return Non-zero if within budget */
+static int enforceBudget(struct texcache *cache, const struct entry *keep, size_t reserve) {
+	for (struct entry *entry = cache->last, *prev; isOverBudget(cache, reserve) && entry != 0; entry = prev) {
+		prev = entry->prev;
+		if (entry->references == 0 && entry != keep) destroyEntry(cache, entry);
+	}
+	for (struct entry *entry = cache->last; reserve == 0 && isOverBudget(cache, 0) && entry != 0; entry = entry->prev) {
+		unsigned int tail = dds_tail_level(&entry->image);
+		while (isOverBudget(cache, 0) && entry->baseLevel < tail) evictLevel(cache, entry);
+	}
+	return !isOverBudget(cache, reserve);
+}
+
+/** Prepares the contents of a DDS file for uploading, flipping or decompressing it if needed.
+	@return The pixel data described by \a image, which is \a data itself or a copy to be freed into \a copy */
+static const char *prepare(struct dds_image *image, const char *data, int flags, char **copy) {
+	*copy = 0;
+	if (image->compressed && !dds_is_supported(image)) {
+		struct dds_image decompressed;
+		if ((*copy = dds_decompress(image, data, flags, &decompressed, 0)) == 0) return 0;
+		*image = decompressed;
+		return *copy;
+	}
+	if (flags & DDS_FLIP_UVS && image->compressed) {
+		if ((*copy = malloc(image->size)) == 0) return 0;
+		memcpy(*copy, data, image->size);
+		dds_flip(image, *copy);
+		return *copy;
+	}
+	return data;
+}
+
+/** Uploads the evicted levels of a texture from the contents of its file, if they fit within the budget. */
+static void restoreLevels(struct texcache *cache, struct entry *entry, const char *data, size_t size) {
+	struct dds_image image;
+	char *copy;
+	size_t bytes = getResidentBytes(&entry->image, 0) - entry->texture.bytes;
+	if (!enforceBudget(cache, entry, bytes) || !dds_parse(data, size, &image)) return;
+	const char *pixels = prepare(&image, data, entry->flags, &copy);
+	if (pixels == 0) return;
+
+	while (entry->baseLevel > 0) dds_restore_level(&entry->image, entry->texture.texture, --entry->baseLevel, pixels);
+	entry->texture.bytes += bytes;
+	cache->resident += bytes;
+	free(copy);
+}
+
+/** Returns a new reference to an entry, bringing back evicted levels if the contents are at hand. */
+static struct cached_texture *reference(struct texcache *cache, struct entry *entry, const char *data, size_t size) {
+	entry->references++;
+	unlinkEntry(cache, entry);
+	pushEntry(cache, entry);
+	if (entry->baseLevel > 0 && data != 0) restoreLevels(cache, entry, data, size);
+	return &entry->texture;
+}
+
+/** Uploads the contents of a DDS file into a new entry. */
+static struct cached_texture *createEntry(struct texcache *cache, const char *path, uint64_t pathHash, const char *data, size_t size, uint64_t contentHash, int flags) {
+	struct entry *entry = malloc(sizeof(struct entry));
+	if (entry == 0) return 0;
+	entry->path = 0;
+	if (path != 0 && (entry->path = malloc(strlen(path) + 1)) != 0) strcpy(entry->path, path);
+	char *copy = 0;
+	const char *pixels = 0;
+	if ((path != 0 && entry->path == 0) || !dds_parse(data, size, &entry->image) || (pixels = prepare(&entry->image, data, flags, &copy)) == 0
+		|| (entry->texture.texture = dds_upload(&entry->image, pixels, 0)) == 0) {
+		free(copy);
+		free(entry->path);
+		free(entry);
+		return 0;
+	}
+	free(copy);
+
+	entry->texture.target = entry->image.target;
+	entry->texture.width = entry->image.width;
+	entry->texture.height = entry->image.height;
+	entry->texture.bytes = getResidentBytes(&entry->image, 0);
+	entry->pathHash = pathHash;
+	entry->contentHash = contentHash;
+	entry->contentSize = size;
+	entry->flags = flags;
+	entry->references = 1;
+	entry->baseLevel = 0;
+	if (!insertEntry(cache, entry)) {
+		glh_delete_textures(1, &entry->texture.texture);
+		free(entry->path);
+		free(entry);
+		return 0;
+	}
+	cache->resident += entry->texture.bytes;
+	enforceBudget(cache, 0, 0);
+	return &entry->texture;
+}
+
+struct texcache *create_texcache(size_t budget) {
+	struct texcache *cache = malloc(sizeof(struct texcache));
+	if (cache == 0) return 0;
+	cache->bucketCount = INITIAL_BUCKETS;
+	cache->pathBuckets = calloc(cache->bucketCount, sizeof(struct entry *));
+	cache->contentBuckets = calloc(cache->bucketCount, sizeof(struct entry *));
+	if (cache->pathBuckets == 0 || cache->contentBuckets == 0) {
+		free(cache->pathBuckets);
+		free(cache->contentBuckets);
+		free(cache);
+		return 0;
+	}
+	cache->count = 0;
+	cache->first = cache->last = 0;
+	cache->budget = budget;
+	cache->resident = 0;
+	return cache;
+}
+
+void destroy_texcache(struct texcache *cache) {
+	for (struct entry *entry = cache->first, *next; entry != 0; entry = next) {
+		next = entry->next;
+		glh_delete_textures(1, &entry->texture.texture);
+		free(entry->path);
+		free(entry);
+	}
+	free(cache->pathBuckets);
+	free(cache->contentBuckets);
+	free(cache);
+}
+
+struct cached_texture *texcache_load_file(struct texcache *cache, const char *path, int flags) {
+	uint64_t pathHash = hashBytes(path, strlen(path));
+	struct entry *entry = findPath(cache, path, pathHash, flags);
+	if (entry != 0 && entry->baseLevel == 0) return reference(cache, entry, 0, 0);
+
+	size_t size;
+	char *data = dds_read_file(path, &size);
+	if (data == 0) return 0;
+	struct cached_texture *texture;
+	uint64_t contentHash = hashBytes(data, size);
+	// Another path may have the same contents
+	if (entry != 0) texture = reference(cache, entry, contentHash == entry->contentHash ? data : 0, size); // Files changed on disk are not reloaded
+	else if ((entry = findContent(cache, contentHash, size, flags)) != 0) texture = reference(cache, entry, data, size);
+	else texture = createEntry(cache, path, pathHash, data, size, contentHash, flags);
+	free(data);
+	return texture;
+}
+
+struct cached_texture *texcache_load_memory(struct texcache *cache, const char *data, size_t size, int flags) {
+	uint64_t contentHash = hashBytes(data, size);
+	struct entry *entry = findContent(cache, contentHash, size, flags);
+	if (entry != 0) return reference(cache, entry, data, size);
+	return createEntry(cache, 0, 0, data, size, contentHash, flags);
+}
+
+void texcache_release(struct texcache *cache, struct cached_texture *texture) {
+	struct entry *entry = (struct entry *) texture;
+	if (entry->references > 0 && --entry->references == 0) enforceBudget(cache, 0, 0);
+}
+
+void texcache_touch(struct texcache *cache, struct cached_texture *texture) {
+	struct entry *entry = (struct entry *) texture;
+	unlinkEntry(cache, entry);
+	pushEntry(cache, entry);
+	if (entry->baseLevel == 0 || entry->path == 0) return;
+
+	// Only read the file if the levels can fit
+	if (!enforceBudget(cache, entry, getResidentBytes(&entry->image, 0) - texture->bytes)) return;
+	size_t size;
+	char *data = dds_read_file(entry->path, &size);
+	if (data == 0) return;
+	if (hashBytes(data, size) == entry->contentHash) restoreLevels(cache, entry, data, size);
+	free(data);
+}
+
+void texcache_set_budget(struct texcache *cache, size_t budget) {
+	cache->budget = budget;
+	enforceBudget(cache, 0, 0);
+}
+
+size_t texcache_resident(const struct texcache *cache) {
+	return cache->resident;
+}
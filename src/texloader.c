@@ -0,0 +1,333 @@
+#include "texloader.h"
+#include <stdlib.h>
+#include <string.h>
+#include "bitmap_dds.h"
+#include "glh.h"
+#include "timer.h"
+
+struct request {
+	struct streamed_texture texture; /**< The public handle, must be first. */
+	struct texloader *loader;
+	char *path;
+	int flags,
+		reading, /**< Non-zero while the file is being read or waits in the ready queue. */
+		streaming, /**< Non-zero while in the streaming queue. */
+		released; /**< Non-zero if the handle was released while reading or streaming. */
+	char *data; /**< The file contents, or \c 0 if not loaded or loading failed. */
+	struct dds_image image;
+	unsigned int baseLevel, /**< The largest mipmap level resident in video memory. */
+		lastUse; /**< The value of the frame counter when the texture was last touched. */
+	size_t residentBytes;
+	struct request *next, /**< The next request in the ready or streaming queue. */
+		*prevRequest, *nextRequest; /**< Links of the list of live requests, most recently used first. */
+};
+
+struct texloader {
+	struct threadpool *pool;
+	GLuint placeholder;
+	struct mutex mutex; /**< Guards the ready queue. */
+	struct request *readyHead, *readyTail,
+		*streamingHead, *streamingTail, /**< Progressive textures with levels left to upload. */
+		*firstRequest, *lastRequest; /**< All requests that have not been released. */
+	unsigned int frame; /**< Counts the calls to ::texloader_update. */
+	size_t budget, resident;
+};
+
+static void loadRequest(void *arg) {
+	struct request *request = arg;
+	size_t size;
+	if ((request->data = dds_read_file(request->path, &size)) != 0) {
+		if (dds_parse(request->data, size, &request->image)) {
+			if (request->image.compressed && !dds_is_supported(&request->image)) {
+				// Decode here rather than stalling the thread owning the context
+				struct dds_image decompressed;
+				char *pixels = dds_decompress(&request->image, request->data, request->flags, &decompressed, request->loader->pool);
+				free(request->data);
+				request->data = pixels;
+				request->image = decompressed;
+			}
+			else if (request->flags & DDS_FLIP_UVS) dds_flip(&request->image, request->data);
+		}
+		else {
+			free(request->data);
+			request->data = 0;
+		}
+	}
+
+	struct texloader *loader = request->loader;
+	mutex_lock(&loader->mutex);
+	if (loader->readyTail != 0) loader->readyTail->next = request;
+	else loader->readyHead = request;
+	loader->readyTail = request;
+	mutex_unlock(&loader->mutex);
+}
+
+static void freeRequest(struct request *request) {
+	free(request->path);
+	free(request->data);
+	free(request);
+}
+
+static void unlinkRequest(struct texloader *loader, struct request *request) {
+	if (request->prevRequest != 0) request->prevRequest->nextRequest = request->nextRequest;
+	else loader->firstRequest = request->nextRequest;
+	if (request->nextRequest != 0) request->nextRequest->prevRequest = request->prevRequest;
+	else loader->lastRequest = request->prevRequest;
+}
+
+static void pushRequest(struct texloader *loader, struct request *request) {
+	request->prevRequest = 0;
+	if ((request->nextRequest = loader->firstRequest) != 0) loader->firstRequest->prevRequest = request;
+	else loader->lastRequest = request;
+	loader->firstRequest = request;
+}
+
+static void pushStreaming(struct texloader *loader, struct request *request) {
+	request->streaming = 1;
+	request->next = 0;
+	if (loader->streamingTail != 0) loader->streamingTail->next = request;
+	else loader->streamingHead = request;
+	loader->streamingTail = request;
+}
+
+/** Returns whether a request is uploaded a level at a time, as only 2D and cube map textures are. */
+static int isProgressive(const struct request *request) {
+	return request->flags & TEXLOADER_PROGRESSIVE && (request->image.target == GL_TEXTURE_2D || request->image.target == GL_TEXTURE_CUBE_MAP);
+}
+
+/** Returns the number of bytes ::finishRead uploads for a finished read. */
+static size_t getUploadSize(const struct request *request) {
+	const struct dds_image *image = &request->image;
+	if (request->data == 0 || request->texture.status == TEXTURE_READY) return 0;
+	if (!isProgressive(request)) return image->size - image->mipmaps[0].offset;
+	size_t bytes = 0;
+	for (unsigned int i = dds_tail_level(image); i < image->levels; i++) bytes += image->faces * image->mipmaps[i].size;
+	return bytes;
+}
+
+/** Uploads the next larger mipmap level of a progressive texture. */
+static size_t streamLevel(struct texloader *loader, struct request *request) {
+	size_t bytes = dds_restore_level(&request->image, request->texture.texture, --request->baseLevel, request->data);
+	request->residentBytes += bytes;
+	loader->resident += bytes;
+	return bytes;
+}
+
+/** Releases the largest resident mipmap level of a progressive texture. */
+static void evictLevel(struct texloader *loader, struct request *request) {
+	size_t bytes = dds_evict_level(&request->image, request->texture.texture, request->baseLevel++);
+	request->residentBytes -= bytes;
+	loader->resident -= bytes;
+}
+
+/** Creates the texture of a finished read, returning the number of bytes uploaded. */
+static size_t finishRead(struct texloader *loader, struct request *request) {
+	struct streamed_texture *texture = &request->texture;
+	const struct dds_image *image = &request->image;
+	if (texture->status == TEXTURE_READY) {
+		// Reread to restore evicted levels
+		if (request->data != 0 && request->baseLevel > 0) pushStreaming(loader, request);
+		else {
+			free(request->data);
+			request->data = 0;
+		}
+		return 0;
+	}
+
+	GLuint name = 0;
+	size_t bytes = 0;
+	if (request->data == 0) texture->status = TEXTURE_FAILED;
+	else if (isProgressive(request)) {
+		// Upload the mip tail, making the texture usable, and stream the rest in later
+		glGenTextures(1, &name);
+		if (name != 0) {
+			glh_bind_texture(image->target, name);
+			request->baseLevel = dds_tail_level(image);
+			glTexParameteri(image->target, GL_TEXTURE_BASE_LEVEL, request->baseLevel);
+			glTexParameteri(image->target, GL_TEXTURE_MAX_LEVEL, image->levels - 1);
+			for (unsigned int i = request->baseLevel; i < image->levels; i++) bytes += dds_upload_level(image, i, request->data);
+			if (request->baseLevel > 0) pushStreaming(loader, request);
+		}
+	}
+	else if ((name = dds_upload(image, request->data, 0)) != 0) {
+		request->baseLevel = 0;
+		bytes = image->size - image->mipmaps[0].offset;
+	}
+
+	if (name != 0) {
+		texture->texture = name;
+		texture->target = image->target;
+		texture->width = image->width;
+		texture->height = image->height;
+		texture->status = TEXTURE_READY;
+		request->residentBytes = bytes;
+		loader->resident += bytes;
+	}
+	else texture->status = TEXTURE_FAILED;
+
+	if (!request->streaming) {
+		free(request->data);
+		request->data = 0;
+	}
+	return bytes;
+}
+
+struct texloader *create_texloader(struct threadpool *pool, GLuint placeholder) {
+	struct texloader *loader = malloc(sizeof(struct texloader));
+	if (loader == 0) return 0;
+	loader->pool = pool;
+	loader->placeholder = placeholder;
+	mutex_init(&loader->mutex);
+	loader->readyHead = loader->readyTail = loader->streamingHead = loader->streamingTail = 0;
+	loader->firstRequest = loader->lastRequest = 0;
+	loader->frame = 0;
+	loader->budget = loader->resident = 0;
+	return loader;
+}
+
+void destroy_texloader(struct texloader *loader) {
+	threadpool_wait(loader->pool);
+
+	// Released requests are only referenced by the queues
+	for (struct request *request = loader->readyHead, *next; request != 0; request = next) {
+		next = request->next;
+		if (request->released) freeRequest(request);
+		else request->reading = 0;
+	}
+	for (struct request *request = loader->streamingHead, *next; request != 0; request = next) {
+		next = request->next;
+		if (request->released && !request->reading) freeRequest(request);
+	}
+	for (struct request *request = loader->firstRequest, *next; request != 0; request = next) {
+		next = request->nextRequest;
+		if (request->texture.texture != loader->placeholder) glh_delete_textures(1, &request->texture.texture);
+		freeRequest(request);
+	}
+	mutex_destroy(&loader->mutex);
+	free(loader);
+}
+
+struct streamed_texture *texloader_load(struct texloader *loader, const char *path, int flags) {
+	struct request *request = malloc(sizeof(struct request));
+	if (request == 0) return 0;
+	if ((request->path = malloc(strlen(path) + 1)) == 0) {
+		free(request);
+		return 0;
+	}
+	strcpy(request->path, path);
+	request->texture.texture = loader->placeholder;
+	request->texture.target = GL_TEXTURE_2D;
+	request->texture.width = request->texture.height = 0;
+	request->texture.status = TEXTURE_PENDING;
+	request->loader = loader;
+	request->flags = flags;
+	request->reading = 1;
+	request->streaming = request->released = 0;
+	request->data = 0;
+	request->lastUse = loader->frame;
+	request->residentBytes = 0;
+	request->next = 0;
+
+	if (!threadpool_submit(loader->pool, loadRequest, request)) {
+		freeRequest(request);
+		return 0;
+	}
+	pushRequest(loader, request);
+	return &request->texture;
+}
+
+void texloader_release(struct texloader *loader, struct streamed_texture *texture) {
+	struct request *request = (struct request *) texture;
+	unlinkRequest(loader, request);
+	if (texture->texture != loader->placeholder) glh_delete_textures(1, &texture->texture);
+	texture->texture = loader->placeholder;
+	loader->resident -= request->residentBytes;
+	request->residentBytes = 0;
+
+	// The queues still reference reading and streaming requests
+	if (request->reading || request->streaming) request->released = 1;
+	else freeRequest(request);
+}
+
+void texloader_touch(struct texloader *loader, struct streamed_texture *texture) {
+	struct request *request = (struct request *) texture;
+	request->lastUse = loader->frame;
+	unlinkRequest(loader, request);
+	pushRequest(loader, request);
+
+	// Bring back evicted levels
+	if (texture->status == TEXTURE_READY && request->baseLevel > 0 && !request->reading && !request->streaming) {
+		request->reading = 1;
+		request->next = 0;
+		if (!threadpool_submit(loader->pool, loadRequest, request)) request->reading = 0;
+	}
+}
+
+void texloader_set_budget(struct texloader *loader, size_t budget) {
+	loader->budget = budget;
+}
+
+size_t texloader_resident(const struct texloader *loader) {
+	return loader->resident;
+}
+
+int texloader_update(struct texloader *loader, size_t byteBudget, unsigned int timeBudget) {
+	unsigned int start = getTicks();
+	size_t bytes = 0;
+	int count = 0, uploads = 0;
+
+	// Finished reads first, as the mip tails make textures usable
+	for (;;) {
+		mutex_lock(&loader->mutex);
+		struct request *request = loader->readyHead;
+		// Stop before the next upload would exceed the budget
+		if (request != 0 && uploads > 0 && byteBudget != 0 && bytes + getUploadSize(request) > byteBudget) request = 0;
+		if (request != 0 && (loader->readyHead = request->next) == 0) loader->readyTail = 0;
+		mutex_unlock(&loader->mutex);
+		if (request == 0) break;
+
+		request->reading = 0;
+		if (request->released) {
+			freeRequest(request);
+			continue;
+		}
+		int pending = request->texture.status == TEXTURE_PENDING;
+		bytes += finishRead(loader, request);
+		count += pending;
+		uploads++;
+
+		if (byteBudget != 0 && bytes >= byteBudget) break;
+		if (timeBudget != 0 && getTicks() - start >= timeBudget) break;
+	}
+
+	// Then stream in larger levels, one level per texture in turn
+	while (loader->streamingHead != 0) {
+		struct request *request = loader->streamingHead;
+		if (!request->released) {
+			size_t size = request->image.faces * request->image.mipmaps[request->baseLevel - 1].size;
+			if (uploads > 0 && ((byteBudget != 0 && bytes + size > byteBudget) || (timeBudget != 0 && getTicks() - start >= timeBudget))) break;
+			bytes += streamLevel(loader, request);
+			uploads++;
+		}
+
+		if ((loader->streamingHead = request->next) == 0) loader->streamingTail = 0;
+		if (request->released || request->baseLevel == 0) {
+			request->streaming = 0;
+			free(request->data);
+			request->data = 0;
+			if (request->released && !request->reading) freeRequest(request);
+		}
+		else pushStreaming(loader, request);
+	}
+
+	// Evict the largest levels of the least recently used textures until within the memory budget
+	for (struct request *request = loader->lastRequest; loader->budget != 0 && loader->resident > loader->budget && request != 0; request = request->prevRequest) {
+		if (request->lastUse == loader->frame) break; // The rest were used since the last update too
+		if (!isProgressive(request) || request->texture.status != TEXTURE_READY || request->streaming || request->reading) continue;
+		unsigned int tail = dds_tail_level(&request->image);
+		while (loader->resident > loader->budget && request->baseLevel < tail) evictLevel(loader, request);
+	}
+
+	loader->frame++; // Touches from now on count towards the next update
+	return count;
+}
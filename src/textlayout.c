@@ -0,0 +1,262 @@
+#include "textlayout.h"
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <stdint.h>
+
+/** A run of characters between spaces. */
+struct word {
+	size_t start, /**< The offset of the first byte in the paragraph. */
+		length; /**< The length in bytes. */
+	int width, /**< The advance of the characters. */
+		gap; /**< The advance of the spaces after the word, including the kerning on either side. */
+};
+
+struct paragraph {
+	char *text;
+	size_t length;
+	struct word *words;
+	unsigned int wordCount, wordCapacity;
+	unsigned int *lineStarts; /**< The first word of every line. */
+	unsigned int lineCount, lineCapacity;
+	int fitWidth, /**< The widest line of more than one word. */
+		breakWidth; /**< The narrowest a line would be with the word after it, the line breaks holding for widths in [fitWidth, breakWidth). */
+};
+
+struct text_document {
+	const struct bmfont *font;
+	unsigned int fallback; /**< The glyph index drawn for missing characters. */
+	int width;
+	struct paragraph *paragraphs;
+	unsigned int paragraphCount, paragraphCapacity;
+	unsigned int *tree; /**< The Fenwick tree of the line counts, indexed from \c 1. */
+};
+
+/** Grows an array to hold at least \a count elements, doubling the capacity. Fails if the capacity or the size in bytes would overflow. */
+static int reserve(void **array, unsigned int *capacity, unsigned int count, size_t elementSize) {
+	if (count <= *capacity) return 1;
+	size_t newCapacity = *capacity > 0 ? *capacity : 4;
+	do {
+		if (newCapacity > UINT_MAX / 2 || newCapacity * 2 > SIZE_MAX / elementSize) return 0;
+		newCapacity *= 2;
+	} while (newCapacity < count);
+	void *grown = realloc(*array, newCapacity * elementSize);
+	if (grown == 0) return 0;
+	*array = grown;
+	*capacity = (unsigned int) newCapacity;
+	return 1;
+}
+
+/** Splits the text of a paragraph into words and caches their widths. */
+static int measureWords(const struct text_document *document, struct paragraph *paragraph) {
+	const struct bmfont *font = document->font;
+	const char *text = paragraph->text;
+	struct word *word = 0;
+	unsigned int previous = 0;
+	int inGap = 0;
+	paragraph->wordCount = 0;
+	for (size_t i = 0; i < paragraph->length;) {
+		unsigned int codepoint, bytes = bmfont_decode_utf8(text + i, paragraph->length - i, &codepoint);
+		unsigned int index = bmfont_get_index(font, codepoint);
+		if (index == 0) index = document->fallback;
+		int kerning = bmfont_get_index_kerning(font, previous, index), advance = font->glyphs[index].xadvance;
+		previous = index;
+
+		if (word == 0 || (inGap && codepoint != ' ')) {
+			// Growing moves the words, so the previous one is found by index
+			if (!reserve((void **) &paragraph->words, &paragraph->wordCapacity, paragraph->wordCount + 1, sizeof(struct word))) return 0;
+			if (word != 0) paragraph->words[paragraph->wordCount - 1].gap += kerning;
+			word = paragraph->words + paragraph->wordCount++;
+			word->start = i;
+			word->length = word->width = word->gap = 0;
+			kerning = 0;
+		}
+		if (codepoint == ' ') {
+			// Leading spaces indent an empty first word
+			word->gap += kerning + advance;
+			inGap = 1;
+		}
+		else {
+			word->width += kerning + advance;
+			word->length = i + bytes - word->start;
+			inGap = 0;
+		}
+		i += bytes;
+	}
+	return 1;
+}
+
+static int addLine(struct paragraph *paragraph, unsigned int word) {
+	if (!reserve((void **) &paragraph->lineStarts, &paragraph->lineCapacity, paragraph->lineCount + 1, sizeof(unsigned int))) return 0;
+	paragraph->lineStarts[paragraph->lineCount++] = word;
+	return 1;
+}
+
+/** Breaks the words of a paragraph into lines greedily, from the cached widths alone. */
+static int wrap(struct paragraph *paragraph, int width) {
+	const struct word *words = paragraph->words;
+	paragraph->lineCount = 0;
+	paragraph->fitWidth = 0;
+	paragraph->breakWidth = INT_MAX;
+	if (!addLine(paragraph, 0)) return 0;
+	if (paragraph->wordCount == 0) return 1;
+
+	unsigned int first = 0;
+	int lineWidth = words[0].width;
+	for (unsigned int i = 1; i < paragraph->wordCount; i++) {
+		int extended = lineWidth + words[i - 1].gap + words[i].width;
+		if (extended <= width) {
+			lineWidth = extended;
+			continue;
+		}
+		if (extended < paragraph->breakWidth) paragraph->breakWidth = extended;
+		if (i - first > 1 && lineWidth > paragraph->fitWidth) paragraph->fitWidth = lineWidth;
+		if (!addLine(paragraph, i)) return 0;
+		first = i;
+		lineWidth = words[i].width;
+	}
+	if (paragraph->wordCount - first > 1 && lineWidth > paragraph->fitWidth) paragraph->fitWidth = lineWidth;
+	return 1;
+}
+
+/** Adds to the line count of a paragraph in the Fenwick tree. */
+static void updateTree(struct text_document *document, unsigned int paragraph, int delta) {
+	for (unsigned int i = paragraph + 1; i <= document->paragraphCount; i += i & -i) document->tree[i] += delta;
+}
+
+/** Returns the number of lines in the paragraphs before one. */
+static unsigned int sumTree(const struct text_document *document, unsigned int paragraph) {
+	unsigned int sum = 0;
+	for (unsigned int i = paragraph; i > 0; i -= i & -i) sum += document->tree[i];
+	return sum;
+}
+
+struct text_document *create_text_document(const struct bmfont *font, float width) {
+	struct text_document *document = calloc(1, sizeof(struct text_document));
+	if (document == 0) return 0;
+	document->font = font;
+	document->width = (int) width;
+	document->fallback = bmfont_get_index(font, 0xFFFD);
+	if (document->fallback == 0) document->fallback = bmfont_get_index(font, '?');
+	return document;
+}
+
+void destroy_text_document(struct text_document *document) {
+	for (unsigned int i = 0; i < document->paragraphCount; i++) {
+		struct paragraph *paragraph = document->paragraphs + i;
+		free(paragraph->text);
+		free(paragraph->words);
+		free(paragraph->lineStarts);
+	}
+	free(document->paragraphs);
+	free(document->tree);
+	free(document);
+}
+
+/** Copies the text into a paragraph and wraps it. */
+static int setText(struct text_document *document, struct paragraph *paragraph, const char *text, size_t length) {
+	char *copy = realloc(paragraph->text, length > 0 ? length : 1);
+	if (copy == 0) return 0;
+	memcpy(copy, text, length);
+	paragraph->text = copy;
+	paragraph->length = length;
+	return measureWords(document, paragraph) && wrap(paragraph, document->width);
+}
+
+int text_document_append(struct text_document *document, const char *text, size_t length) {
+	const char *end = text + length;
+	for (const char *line = text;; line++) {
+		const char *newline = memchr(line, '\n', end - line);
+		if (newline == 0) newline = end;
+		if (!reserve((void **) &document->paragraphs, &document->paragraphCapacity, document->paragraphCount + 1, sizeof(struct paragraph))) return 0;
+		// The tree shares the capacity of the paragraphs, plus the unused first element
+		unsigned int *tree = realloc(document->tree, (document->paragraphCapacity + 1) * sizeof(unsigned int));
+		if (tree == 0) return 0;
+		document->tree = tree;
+
+		struct paragraph *paragraph = document->paragraphs + document->paragraphCount;
+		memset(paragraph, 0, sizeof(struct paragraph));
+		if (!setText(document, paragraph, line, newline - line)) {
+			free(paragraph->text);
+			free(paragraph->words);
+			free(paragraph->lineStarts);
+			return 0;
+		}
+
+		// A new last node covers the nodes below it, which are all in place
+		unsigned int i = ++document->paragraphCount;
+		tree[i] = paragraph->lineCount + sumTree(document, i - 1) - sumTree(document, i - (i & -i));
+		if (newline == end) return 1;
+		line = newline;
+	}
+}
+
+int text_document_set(struct text_document *document, unsigned int paragraph, const char *text, size_t length) {
+	if (paragraph >= document->paragraphCount) return 0;
+	struct paragraph *target = document->paragraphs + paragraph;
+	unsigned int lines = target->lineCount;
+	int success = setText(document, target, text, length);
+	if (!success) {
+		// Keep the document consistent with an empty paragraph, or one without lines if even its line is out of memory
+		target->length = target->wordCount = 0;
+		if (!wrap(target, document->width)) {
+			target->lineCount = 0;
+			target->fitWidth = INT_MAX; // Wrap again at the next width
+		}
+	}
+	updateTree(document, paragraph, (int) target->lineCount - (int) lines);
+	return success;
+}
+
+void text_document_set_width(struct text_document *document, float width) {
+	document->width = (int) width;
+	for (unsigned int i = 0; i < document->paragraphCount; i++) {
+		struct paragraph *paragraph = document->paragraphs + i;
+		if (paragraph->fitWidth <= document->width && document->width < paragraph->breakWidth) continue;
+		unsigned int lines = paragraph->lineCount;
+		if (!wrap(paragraph, document->width)) paragraph->fitWidth = INT_MAX; // Keep the lines found so far, and wrap again at the next width
+		if (paragraph->lineCount != lines) updateTree(document, i, (int) paragraph->lineCount - (int) lines);
+	}
+}
+
+unsigned int text_document_paragraphs(const struct text_document *document) {
+	return document->paragraphCount;
+}
+
+unsigned int text_document_lines(const struct text_document *document) {
+	return sumTree(document, document->paragraphCount);
+}
+
+unsigned int text_document_first_line(const struct text_document *document, unsigned int paragraph) {
+	return sumTree(document, paragraph < document->paragraphCount ? paragraph : document->paragraphCount);
+}
+
+int text_document_line_at(const struct text_document *document, float y, unsigned int *paragraph, unsigned int *line) {
+	if (y < 0 || document->font->lineHeight == 0) return 0;
+	unsigned int remaining = (unsigned int) (y / document->font->lineHeight), position = 0, step = 1;
+	while (step * 2 <= document->paragraphCount) step *= 2;
+	// Descend the tree for the last paragraph starting at or before the line
+	for (; step > 0; step /= 2) {
+		if (position + step <= document->paragraphCount && document->tree[position + step] <= remaining) {
+			position += step;
+			remaining -= document->tree[position];
+		}
+	}
+	if (position >= document->paragraphCount) return 0;
+	*paragraph = position;
+	*line = remaining;
+	return 1;
+}
+
+const char *text_document_line(const struct text_document *document, unsigned int paragraph, unsigned int line, size_t *length) {
+	if (paragraph >= document->paragraphCount || line >= document->paragraphs[paragraph].lineCount) return 0;
+	const struct paragraph *p = document->paragraphs + paragraph;
+	if (p->wordCount == 0) {
+		*length = 0;
+		return p->text;
+	}
+	const struct word *first = p->words + p->lineStarts[line],
+		*last = p->words + (line + 1 < p->lineCount ? p->lineStarts[line + 1] : p->wordCount) - 1;
+	*length = last->start + last->length - first->start;
+	return p->text + first->start;
+}
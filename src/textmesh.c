@@ -0,0 +1,152 @@
+#include "textmesh.h"
+#include <stdlib.h>
+#include <string.h>
+
+/** The number of floats of the four vertices of a quad. */
+#define QUAD_FLOATS 16
+
+static struct text_mesh *createTextMesh(const struct bmfont *font, GLenum usage) {
+	if (font->pages == 0) return 0;
+	struct text_mesh *mesh = calloc(1, sizeof(struct text_mesh));
+	if (mesh == 0) return 0;
+	mesh->font = font;
+	mesh->usage = usage;
+	if ((mesh->pageStarts = calloc(font->pages + 1, sizeof(unsigned int))) == 0
+		|| (mesh->quads = create_text_quads(0)) == 0
+		|| (mesh->mesh = create_mesh(1)) == 0) {
+		destroy_text_mesh(mesh);
+		return 0;
+	}
+	return mesh;
+}
+
+struct text_mesh *create_text_mesh(const struct bmfont *font) {
+	return createTextMesh(font, GL_STATIC_DRAW);
+}
+
+struct text_mesh *create_text_batch(const struct bmfont *font) {
+	return createTextMesh(font, GL_STREAM_DRAW);
+}
+
+void destroy_text_mesh(struct text_mesh *mesh) {
+	if (mesh->mesh != 0) destroy_mesh(mesh->mesh);
+	if (mesh->quads != 0) destroy_text_quads(mesh->quads);
+	free(mesh->pageStarts);
+	free(mesh->text);
+	free(mesh);
+}
+
+int text_mesh_set(struct text_mesh *mesh, const char *text, size_t length, float x, float y) {
+	if (mesh->text != 0 && length == mesh->length && x == mesh->x && y == mesh->y && memcmp(text, mesh->text, length) == 0) return 1;
+	char *copy = realloc(mesh->text, length + 1);
+	if (copy == 0) return 0;
+	memcpy(copy, text, length);
+	mesh->text = copy;
+	mesh->length = length;
+	mesh->x = x;
+	mesh->y = y;
+	mesh->quads->count = 0;
+	mesh->dirty = 1;
+	if (!bmfont_layout(mesh->font, text, length, &x, &y, mesh->quads)) {
+		// Forget the text, so that setting it again lays it out again
+		mesh->length = 0;
+		free(mesh->text);
+		mesh->text = 0;
+		return 0;
+	}
+	return 1;
+}
+
+int text_batch_add(struct text_mesh *batch, const char *text, size_t length, float x, float y) {
+	batch->dirty = 1;
+	return bmfont_layout(batch->font, text, length, &x, &y, batch->quads);
+}
+
+/** Grows the buffers to hold the quads, filling the index buffer with two triangles for every quad. */
+static int reserveBuffers(struct text_mesh *mesh, unsigned int count) {
+	if (count <= mesh->capacity) return 1;
+	unsigned int capacity = mesh->capacity > 0 ? mesh->capacity : 64;
+	while (capacity < count) capacity *= 2;
+	GLuint *indices = malloc(6 * sizeof(GLuint) * capacity);
+	if (indices == 0) return 0;
+	for (GLuint i = 0; i < capacity; i++) {
+		GLuint *quad = indices + 6 * i, vertex = 4 * i;
+		quad[0] = vertex;
+		quad[1] = vertex + 1;
+		quad[2] = vertex + 2;
+		quad[3] = vertex + 2;
+		quad[4] = vertex + 1;
+		quad[5] = vertex + 3;
+	}
+	// Filled through the array buffer binding, which unlike the element array binding is not part of the bound vertex array object
+	glh_bind_buffer(GL_ARRAY_BUFFER, mesh->mesh->ibo);
+	glBufferData(GL_ARRAY_BUFFER, 6 * sizeof(GLuint) * capacity, indices, GL_STATIC_DRAW);
+	free(indices);
+	glh_bind_buffer(GL_ARRAY_BUFFER, mesh->mesh->vbo);
+	glBufferData(GL_ARRAY_BUFFER, QUAD_FLOATS * sizeof(float) * capacity, 0, mesh->usage);
+	mesh->capacity = capacity;
+	return 1;
+}
+
+/** Writes the vertices of the quads grouped by page, with a counting sort on the page. */
+static void tessellate(struct text_mesh *mesh, float *vertices) {
+	const struct text_quads *quads = mesh->quads;
+	unsigned int pages = mesh->font->pages, *starts = mesh->pageStarts;
+	memset(starts, 0, (pages + 1) * sizeof(unsigned int));
+	for (unsigned int i = 0; i < quads->count; i++) starts[quads->pages[i] < pages ? quads->pages[i] + 1u : pages]++;
+	for (unsigned int p = 1; p <= pages; p++) starts[p] += starts[p - 1];
+
+	// Shift to the first quad of every page while scattering, which leaves the starts in place
+	for (unsigned int p = pages; p > 0; p--) starts[p] = starts[p - 1];
+	starts[0] = 0;
+	for (unsigned int i = 0; i < quads->count; i++) {
+		unsigned int page = quads->pages[i] < pages ? quads->pages[i] : pages - 1;
+		float *v = vertices + QUAD_FLOATS * starts[page + 1]++;
+		const float *x = quads->x + 2 * i, *y = quads->y + 2 * i, *u = quads->u + 2 * i, *t = quads->v + 2 * i;
+		v[0] = x[0]; v[1] = y[0]; v[2] = u[0]; v[3] = t[0];
+		v[4] = x[1]; v[5] = y[0]; v[6] = u[1]; v[7] = t[0];
+		v[8] = x[0]; v[9] = y[1]; v[10] = u[0]; v[11] = t[1];
+		v[12] = x[1]; v[13] = y[1]; v[14] = u[1]; v[15] = t[1];
+	}
+}
+
+/** Tessellates the quads straight into the vertex buffer, invalidating its contents so that a batch need not wait for the previous frame to be drawn. */
+static int upload(struct text_mesh *mesh) {
+	unsigned int count = mesh->quads->count;
+	if (!reserveBuffers(mesh, count)) return 0;
+	if (count == 0) {
+		memset(mesh->pageStarts, 0, (mesh->font->pages + 1) * sizeof(unsigned int));
+		mesh->dirty = 0;
+		return 1;
+	}
+	glh_bind_buffer(GL_ARRAY_BUFFER, mesh->mesh->vbo);
+	float *vertices = glMapBufferRange(GL_ARRAY_BUFFER, 0, QUAD_FLOATS * sizeof(float) * count, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	if (vertices == 0) return 0;
+	tessellate(mesh, vertices);
+	if (glUnmapBuffer(GL_ARRAY_BUFFER) != GL_TRUE) return 0;
+	mesh->dirty = 0;
+	return 1;
+}
+
+void text_mesh_draw(struct text_mesh *mesh, const GLuint *textures, GLint position, GLint texCoord) {
+	if (mesh->dirty && !upload(mesh)) return;
+
+	struct attrib attributes[] = { { position, 2, 0 }, { texCoord, 2, 2 * sizeof(float) }, NULL_ATTRIB };
+	if (mesh->mesh->vao != 0 && (position != mesh->position || texCoord != mesh->texCoord)) mesh_set_layout(mesh->mesh, attributes, 4 * sizeof(float));
+	mesh->position = position;
+	mesh->texCoord = texCoord;
+	const unsigned int *starts = mesh->pageStarts;
+	with_mesh(mesh->mesh, attributes, 4 * sizeof(float),
+		for (unsigned int p = 0; p < mesh->font->pages; p++) {
+			if (starts[p + 1] == starts[p]) continue;
+			glh_bind_texture(GL_TEXTURE_2D, textures[p]);
+			glDrawElements(GL_TRIANGLES, 6 * (starts[p + 1] - starts[p]), GL_UNSIGNED_INT, BUFFER_OFFSET(6 * sizeof(GLuint) * starts[p]));
+		}
+	);
+
+	if (mesh->usage == GL_STREAM_DRAW) {
+		// Start the next frame's batch empty
+		mesh->quads->count = 0;
+		memset(mesh->pageStarts, 0, (mesh->font->pages + 1) * sizeof(unsigned int));
+	}
+}
@@ -0,0 +1,255 @@
+#include "threadpool.h"
+#include <stdlib.h>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+typedef CONDITION_VARIABLE condition;
+#define condition_init(c) InitializeConditionVariable(c)
+#define condition_destroy(c) ((void) 0)
+#define condition_wait(c, m) SleepConditionVariableCS(c, &(m)->handle, INFINITE)
+#define condition_signal(c) WakeConditionVariable(c)
+#define condition_broadcast(c) WakeAllConditionVariable(c)
+#else
+typedef pthread_cond_t condition;
+#define condition_init(c) pthread_cond_init(c, 0)
+#define condition_destroy(c) pthread_cond_destroy(c)
+#define condition_wait(c, m) pthread_cond_wait(c, &(m)->handle)
+#define condition_signal(c) pthread_cond_signal(c)
+#define condition_broadcast(c) pthread_cond_broadcast(c)
+#endif
+
+struct task {
+	void (*function)(void *);
+	void *arg;
+	struct task *next;
+};
+
+struct threadpool {
+	struct mutex mutex;
+	condition workAvailable, /**< Signalled when a task is queued or the pool is stopping. */
+		workDone; /**< Signalled when the pool becomes idle or a parallel loop makes progress. */
+	struct task *head, *tail;
+	int threadCount,
+		busy, /**< The number of tasks queued or running. */
+		stopping;
+#ifdef _WIN32
+	HANDLE
+#else
+	pthread_t
+#endif
+		*threads;
+};
+
+/** Shared state of one ::threadpool_parallel_for call. Freed by whoever drops the last reference. */
+struct parallel_for {
+	struct threadpool *pool;
+	void (*function)(void *, int);
+	void *arg;
+	int count, next,
+		running, /**< The number of indices currently being processed by helpers. */
+		references;
+};
+
+void mutex_init(struct mutex *mutex) {
+#ifdef _WIN32
+	InitializeCriticalSection(&mutex->handle);
+#else
+	pthread_mutex_init(&mutex->handle, 0);
+#endif
+}
+
+void mutex_destroy(struct mutex *mutex) {
+#ifdef _WIN32
+	DeleteCriticalSection(&mutex->handle);
+#else
+	pthread_mutex_destroy(&mutex->handle);
+#endif
+}
+
+void mutex_lock(struct mutex *mutex) {
+#ifdef _WIN32
+	EnterCriticalSection(&mutex->handle);
+#else
+	pthread_mutex_lock(&mutex->handle);
+#endif
+}
+
+void mutex_unlock(struct mutex *mutex) {
+#ifdef _WIN32
+	LeaveCriticalSection(&mutex->handle);
+#else
+	pthread_mutex_unlock(&mutex->handle);
+#endif
+}
+
+#ifdef _WIN32
+static DWORD WINAPI worker(LPVOID arg) {
+#else
+static void *worker(void *arg) {
+#endif
+	struct threadpool *pool = arg;
+	mutex_lock(&pool->mutex);
+	for (;;) {
+		while (pool->head == 0 && !pool->stopping) condition_wait(&pool->workAvailable, &pool->mutex);
+		struct task *task = pool->head;
+		if (task == 0) break; // Stopping and the queue is drained
+		if ((pool->head = task->next) == 0) pool->tail = 0;
+		mutex_unlock(&pool->mutex);
+
+		task->function(task->arg);
+		free(task);
+
+		mutex_lock(&pool->mutex);
+		if (--pool->busy == 0) condition_broadcast(&pool->workDone);
+	}
+	mutex_unlock(&pool->mutex);
+	return 0;
+}
+
+struct threadpool *create_threadpool(int threads) {
+	if (threads <= 0) {
+#ifdef _WIN32
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		threads = info.dwNumberOfProcessors;
+#else
+		threads = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+		if (threads <= 0) threads = 1;
+	}
+
+	struct threadpool *pool = malloc(sizeof(struct threadpool));
+	if (pool == 0) return 0;
+	if ((pool->threads = malloc(sizeof *pool->threads * threads)) == 0) {
+		free(pool);
+		return 0;
+	}
+	mutex_init(&pool->mutex);
+	condition_init(&pool->workAvailable);
+	condition_init(&pool->workDone);
+	pool->head = pool->tail = 0;
+	pool->busy = pool->stopping = 0;
+
+	for (pool->threadCount = 0; pool->threadCount < threads; pool->threadCount++) {
+#ifdef _WIN32
+		if ((pool->threads[pool->threadCount] = CreateThread(0, 0, worker, pool, 0, 0)) == 0) break;
+#else
+		if (pthread_create(pool->threads + pool->threadCount, 0, worker, pool) != 0) break;
+#endif
+	}
+	if (pool->threadCount == 0) {
+		destroy_threadpool(pool);
+		return 0;
+	}
+
+	return pool;
+}
+
+void destroy_threadpool(struct threadpool *pool) {
+	mutex_lock(&pool->mutex);
+	pool->stopping = 1;
+	condition_broadcast(&pool->workAvailable);
+	mutex_unlock(&pool->mutex);
+
+	for (int i = 0; i < pool->threadCount; i++) {
+#ifdef _WIN32
+		WaitForSingleObject(pool->threads[i], INFINITE);
+		CloseHandle(pool->threads[i]);
+#else
+		pthread_join(pool->threads[i], 0);
+#endif
+	}
+
+	condition_destroy(&pool->workAvailable);
+	condition_destroy(&pool->workDone);
+	mutex_destroy(&pool->mutex);
+	free(pool->threads);
+	free(pool);
+}
+
+int threadpool_size(const struct threadpool *pool) {
+	return pool->threadCount;
+}
+
+int threadpool_submit(struct threadpool *pool, void (*function)(void *arg), void *arg) {
+	struct task *task = malloc(sizeof(struct task));
+	if (task == 0) return 0;
+	task->function = function;
+	task->arg = arg;
+	task->next = 0;
+
+	mutex_lock(&pool->mutex);
+	if (pool->tail != 0) pool->tail->next = task;
+	else pool->head = task;
+	pool->tail = task;
+	pool->busy++;
+	condition_signal(&pool->workAvailable);
+	mutex_unlock(&pool->mutex);
+	return 1;
+}
+
+void threadpool_wait(struct threadpool *pool) {
+	mutex_lock(&pool->mutex);
+	while (pool->busy > 0) condition_wait(&pool->workDone, &pool->mutex);
+	mutex_unlock(&pool->mutex);
+}
+
+/** Processes indices of the loop until none are left. Must be called with the pool locked. */
+static void runParallelFor(struct threadpool *pool, struct parallel_for *loop, int helper) {
+	while (loop->next < loop->count) {
+		int i = loop->next++;
+		loop->running += helper;
+		mutex_unlock(&pool->mutex);
+		loop->function(loop->arg, i);
+		mutex_lock(&pool->mutex);
+		loop->running -= helper;
+	}
+}
+
+static void parallelForHelper(void *arg) {
+	struct parallel_for *loop = arg;
+	struct threadpool *pool = loop->pool;
+	mutex_lock(&pool->mutex);
+	runParallelFor(pool, loop, 1);
+	if (loop->running == 0) condition_broadcast(&pool->workDone);
+	int references = --loop->references;
+	mutex_unlock(&pool->mutex);
+	if (references == 0) free(loop);
+}
+
+void threadpool_parallel_for(struct threadpool *pool, int count, void (*function)(void *arg, int i), void *arg) {
+	int helpers = pool != 0 ? (count < pool->threadCount ? count : pool->threadCount) - 1 : 0;
+	struct parallel_for *loop = helpers > 0 ? malloc(sizeof(struct parallel_for)) : 0;
+	if (loop == 0) {
+		for (int i = 0; i < count; i++) function(arg, i);
+		return;
+	}
+	loop->pool = pool;
+	loop->function = function;
+	loop->arg = arg;
+	loop->count = count;
+	loop->next = loop->running = 0;
+	loop->references = 1;
+
+	for (int i = 0; i < helpers; i++) {
+		mutex_lock(&pool->mutex);
+		loop->references++;
+		mutex_unlock(&pool->mutex);
+		if (!threadpool_submit(pool, parallelForHelper, loop)) {
+			mutex_lock(&pool->mutex);
+			loop->references--;
+			mutex_unlock(&pool->mutex);
+			break;
+		}
+	}
+
+	// Help out, then wait only for indices already claimed: helpers that have not started yet will find nothing left
+	mutex_lock(&pool->mutex);
+	runParallelFor(pool, loop, 0);
+	while (loop->running > 0) condition_wait(&pool->workDone, &pool->mutex);
+	int references = --loop->references;
+	mutex_unlock(&pool->mutex);
+	if (references == 0) free(loop);
+}
@@ -0,0 +1,66 @@
+/** Builds BMFont files in memory for tests.
+	@file bmfontdata.h */
+
+#ifndef BMFONTDATA_H
+#define BMFONTDATA_H
+
+#include <string.h>
+#include <stdint.h>
+#include <vector>
+
+// Appends up to the 4 lowest bytes of a value in little endian order
+static void put(std::vector<char> &data, uint32_t value, int bytes) {
+	for (int i = 0; i < bytes && i < 4; i++) data.push_back((char) (value >> 8 * i));
+}
+
+// Builds a binary BMFont file of ASCII on one page, a couple of characters beyond it on another, and kerning between capitals
+static std::vector<char> makeFont() {
+	std::vector<uint32_t> ids;
+	for (uint32_t c = 32; c < 127; c++) ids.push_back(c);
+	ids.push_back(0x4E2D);
+	ids.push_back(0x1F600);
+
+	std::vector<char> data(4);
+	memcpy(&data[0], "BMF\003", 4);
+	data.push_back(2);
+	put(data, 15, 4);
+	put(data, 20, 2); // lineHeight
+	put(data, 16, 2); // base
+	put(data, 256, 2);
+	put(data, 128, 2);
+	put(data, 2, 2); // pages
+	data.insert(data.end(), 5, 0); // bitField and channels
+	data.push_back(3);
+	put(data, 2 * 7, 4);
+	data.insert(data.end(), "p0.dds", "p0.dds" + 7);
+	data.insert(data.end(), "p1.dds", "p1.dds" + 7);
+
+	data.push_back(4);
+	put(data, 20 * ids.size(), 4);
+	for (size_t i = 0; i < ids.size(); i++) {
+		put(data, ids[i], 4);
+		put(data, i % 16 * 16, 2);
+		put(data, i / 16 % 8 * 16, 2);
+		put(data, 8 + ids[i] % 5, 2);
+		put(data, 14, 2);
+		put(data, (uint32_t) -1, 2); // xoffset
+		put(data, 2, 2);
+		put(data, 9 + ids[i] % 5, 2); // xadvance
+		data.push_back(ids[i] > 127); // page
+		data.push_back(15);
+	}
+
+	data.push_back(5);
+	put(data, 10 * 26 * 26, 4);
+	for (uint32_t a = 'Z'; a >= 'A'; a--) {
+		for (uint32_t b = 'A'; b <= 'Z'; b++) {
+			put(data, a, 4);
+			put(data, b, 4);
+			put(data, (uint32_t) -(int) ((a + b) % 3), 2);
+		}
+	}
+	data.push_back(0);
+	return data;
+}
+
+#endif
@@ -0,0 +1,58 @@
+/** Creates a headless OpenGL context for tests, e.g. on Mesa's software rasterizer.
+	@file glcontext.h */
+
+#ifndef GLCONTEXT_H
+#define GLCONTEXT_H
+
+#include <GL/glew.h>
+#include <stdio.h>
+
+#ifdef HAVE_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+/** Makes a surfaceless OpenGL context current, returning \c false if none is available. */
+static bool createHeadlessContext() {
+#ifdef HAVE_EGL
+	static int created = -1;
+	if (created != -1) return created;
+	created = 0;
+
+	EGLDisplay display = EGL_NO_DISPLAY;
+#ifdef EGL_PLATFORM_SURFACELESS_MESA
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (getPlatformDisplay != 0) display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, 0);
+#endif
+	if (display == EGL_NO_DISPLAY) display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	EGLint major, minor;
+	if (!eglInitialize(display, &major, &minor) || !eglBindAPI(EGL_OPENGL_API)) return false;
+
+	EGLint configAttribs[] = { EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+	EGLConfig config;
+	EGLint configCount = 0;
+	eglChooseConfig(display, configAttribs, &config, 1, &configCount);
+	EGLint contextAttribs[] = { EGL_CONTEXT_MAJOR_VERSION, 4, EGL_CONTEXT_MINOR_VERSION, 4, EGL_NONE };
+	EGLContext context = eglCreateContext(display, configCount > 0 ? config : (EGLConfig) 0, EGL_NO_CONTEXT, contextAttribs);
+	if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) return false;
+
+	// GLEW may fail to find a GLX display, but the GL entry points are loaded by then
+	glewExperimental = GL_TRUE;
+	glewInit();
+	created = glGetString(GL_VERSION) != 0;
+	return created;
+#else
+	return false;
+#endif
+}
+
+/** Returns from the current test if no OpenGL context could be created. */
+#define REQUIRE_GL_CONTEXT() \
+	do { \
+		if (!createHeadlessContext()) { \
+			printf("No headless OpenGL context available, skipping.\n"); \
+			return; \
+		} \
+	} while (0)
+
+#endif
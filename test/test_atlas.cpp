@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+#include <atlas.h>
+#include <bitmap_dds.h>
+#include "glcontext.h"
+#include <stdlib.h>
+#include <vector>
+
+static bool overlaps(const struct atlas_sprite *a, const struct atlas_sprite *b, int padding) {
+	return a->page == b->page && a->x - padding < b->x + b->width + padding && b->x - padding < a->x + a->width + padding
+		&& a->y - padding < b->y + b->height + padding && b->y - padding < a->y + a->height + padding;
+}
+
+TEST(Atlas, PacksWithoutOverlap) {
+	struct atlas *atlas = create_atlas(256, 256, 0, 1);
+	std::vector<int> ids;
+	srand(1);
+	for (int i = 0; i < 300; i++) ids.push_back(atlas_insert(atlas, 4 + rand() % 28, 4 + rand() % 28));
+	EXPECT_EQ(-1, atlas_insert(atlas, 255, 8)); // Too wide with padding
+
+	for (size_t i = 0; i < ids.size(); i++) {
+		const struct atlas_sprite *a = atlas_get(atlas, ids[i]);
+		ASSERT_GE(a->page, 0);
+		EXPECT_GE(a->x, 1);
+		EXPECT_LE(a->y + a->height, 255);
+		EXPECT_FLOAT_EQ(a->x / 256.0f, a->u0);
+		EXPECT_FLOAT_EQ((a->y + a->height) / 256.0f, a->v1);
+		for (size_t j = 0; j < i; j++) ASSERT_FALSE(overlaps(a, atlas_get(atlas, ids[j]), 1)) << i << " and " << j;
+	}
+	destroy_atlas(atlas);
+}
+
+TEST(Atlas, ReusesRemovedRoom) {
+	struct atlas *atlas = create_atlas(128, 128, 0, 0);
+	std::vector<int> ids;
+	for (int i = 0; i < 64; i++) ids.push_back(atlas_insert(atlas, 16, 16));
+	EXPECT_EQ(1, atlas_page_count(atlas));
+
+	// Freeing a 2x2 group of sprites makes room for a larger one on the same page
+	struct atlas_sprite first = *atlas_get(atlas, ids[0]);
+	EXPECT_EQ(1, atlas_remove(atlas, ids[0]));
+	EXPECT_EQ(1, atlas_remove(atlas, ids[1]));
+	EXPECT_EQ(1, atlas_remove(atlas, ids[8]));
+	EXPECT_EQ(1, atlas_remove(atlas, ids[9]));
+	EXPECT_EQ(0, atlas_remove(atlas, ids[9]));
+	EXPECT_EQ(-1, atlas_get(atlas, ids[0])->page);
+	int id = atlas_insert(atlas, 32, 32);
+	EXPECT_EQ(1, atlas_page_count(atlas));
+	EXPECT_EQ(first.x, atlas_get(atlas, id)->x);
+	EXPECT_EQ(first.y, atlas_get(atlas, id)->y);
+	EXPECT_EQ(ids[9], id); // Ids are recycled
+
+	EXPECT_EQ(1, atlas_get(atlas, atlas_insert(atlas, 16, 16))->page); // The first page is full
+	EXPECT_EQ(2, atlas_page_count(atlas));
+	destroy_atlas(atlas);
+}
+
+TEST(Atlas, CopiesBlocksOfCompressedImages) {
+	REQUIRE_GL_CONTEXT();
+	std::vector<unsigned char> rgba(6 * 6 * 4);
+	for (size_t i = 0; i < rgba.size(); i++) rgba[i] = (unsigned char) (i * 7);
+	size_t size;
+	char *data = dds_encode(&rgba[0], 6, 6, GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, 0, &size, 0);
+
+	struct atlas *atlas = create_atlas(64, 64, GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, 1);
+	ASSERT_GE(atlas_add_dds(atlas, data, size, 0), 0);
+	int b = atlas_add_dds(atlas, data, size, 0);
+	ASSERT_GE(b, 0);
+	const struct atlas_sprite *sprite = atlas_get(atlas, b);
+	EXPECT_EQ(0, sprite->x % 4);
+	EXPECT_EQ(0, sprite->y % 4);
+	EXPECT_EQ(6, sprite->width);
+
+	// The 2x2 blocks of the image are found at the block position of the sprite
+	std::vector<char> page(16 * 16 * 8);
+	glBindTexture(GL_TEXTURE_2D, atlas_page_texture(atlas, 0));
+	glGetCompressedTexImage(GL_TEXTURE_2D, 0, &page[0]);
+	int bx = sprite->x / 4, by = sprite->y / 4;
+	EXPECT_EQ(0, memcmp(&data[128], &page[8 * (by * 16 + bx)], 16));
+	EXPECT_EQ(0, memcmp(&data[128 + 16], &page[8 * ((by + 1) * 16 + bx)], 16));
+	EXPECT_EQ((GLenum) GL_NO_ERROR, glGetError());
+	destroy_atlas(atlas);
+	free(data);
+}
+
+TEST(Atlas, PlacesFlippedBlocksAtTheImage) {
+	REQUIRE_GL_CONTEXT();
+	std::vector<unsigned char> rgba(6 * 6 * 4);
+	for (size_t i = 0; i < rgba.size(); i++) rgba[i] = (unsigned char) (i * 5);
+	size_t size;
+	char *data = dds_encode(&rgba[0], 6, 6, GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, 0, &size, 0);
+	struct dds_image image;
+	ASSERT_EQ(1, dds_parse(data, size, &image));
+	std::vector<char> flipped(data, data + size);
+	dds_flip(&image, &flipped[0]);
+
+	// The two rows past the image end up below it once the blocks are flipped
+	struct atlas *atlas = create_atlas(64, 64, GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, 1);
+	int id = atlas_add_dds(atlas, data, size, DDS_FLIP_UVS);
+	ASSERT_GE(id, 0);
+	struct atlas_sprite sprite = *atlas_get(atlas, id);
+	EXPECT_EQ(0, sprite.x % 4);
+	EXPECT_EQ(2, sprite.y % 4);
+	EXPECT_EQ(6, sprite.height);
+	EXPECT_FLOAT_EQ(sprite.y / 64.0f, sprite.v0);
+	EXPECT_FLOAT_EQ((sprite.y + 6) / 64.0f, sprite.v1);
+
+	std::vector<char> page(16 * 16 * 8);
+	glBindTexture(GL_TEXTURE_2D, atlas_page_texture(atlas, 0));
+	glGetCompressedTexImage(GL_TEXTURE_2D, 0, &page[0]);
+	int bx = sprite.x / 4, by = sprite.y / 4;
+	EXPECT_EQ(0, memcmp(&flipped[128], &page[8 * (by * 16 + bx)], 16));
+	EXPECT_EQ(0, memcmp(&flipped[128 + 16], &page[8 * ((by + 1) * 16 + bx)], 16));
+
+	// Removing frees the whole room
+	EXPECT_EQ(1, atlas_remove(atlas, id));
+	id = atlas_add_dds(atlas, data, size, 0);
+	EXPECT_EQ(sprite.x, atlas_get(atlas, id)->x);
+	EXPECT_EQ(sprite.y - 2, atlas_get(atlas, id)->y);
+	EXPECT_EQ((GLenum) GL_NO_ERROR, glGetError());
+	destroy_atlas(atlas);
+	free(data);
+}
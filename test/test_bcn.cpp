@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+#include <bcn.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+#include <stdlib.h>
+
+TEST(BCn, DecodesBC1Palette) {
+	// Red and blue endpoints, first row uses all four palette entries
+	const unsigned char block[8] = { 0x00, 0xf8, 0x1f, 0x00, 0xe4, 0, 0, 0 };
+	unsigned char rgba[64];
+	bcn_decode_block(BCN_BC1, block, rgba);
+	const unsigned char expected[16] = { 255, 0, 0, 255, 0, 0, 255, 255, 170, 0, 85, 255, 85, 0, 170, 255 };
+	EXPECT_EQ(0, memcmp(expected, rgba, 16));
+	EXPECT_EQ(0, memcmp(rgba, rgba + 16, 4)); // Index 0 elsewhere
+}
+
+TEST(BCn, DecodesBC1PunchThroughAlpha) {
+	// color0 <= color1 selects the three color mode, index 3 is transparent black
+	const unsigned char block[8] = { 0x1f, 0x00, 0x00, 0xf8, 0xff, 0xff, 0xff, 0xff };
+	unsigned char rgba[64];
+	bcn_decode_block(BCN_BC1, block, rgba);
+	for (int i = 0; i < 16; i++) EXPECT_EQ(0, rgba[4 * i] | rgba[4 * i + 1] | rgba[4 * i + 2] | rgba[4 * i + 3]);
+}
+
+TEST(BCn, DecodesBC4Ramp) {
+	// Indices 0, 1, 2, 7 for the first four pixels
+	const unsigned char block[8] = { 255, 0, 0x88, 0x0e, 0, 0, 0, 0 };
+	unsigned char rgba[64];
+	bcn_decode_block(BCN_BC4, block, rgba);
+	EXPECT_EQ(255, rgba[0]);
+	EXPECT_EQ(0, rgba[4]);
+	EXPECT_EQ(219, rgba[8]);
+	EXPECT_EQ(36, rgba[12]);
+	EXPECT_EQ(0, rgba[1] | rgba[2]);
+	EXPECT_EQ(255, rgba[3]);
+}
+
+TEST(BCn, DecodesPartialBlocksUpsideDown) {
+	// 6x5 pixels span 2x2 blocks of distinct colors
+	const unsigned int width = 6, height = 5;
+	const unsigned short colors[4] = { 0xf800, 0x07e0, 0x001f, 0xffff };
+	std::vector<unsigned char> blocks(4 * 8, 0);
+	for (int i = 0; i < 4; i++) {
+		blocks[8 * i] = blocks[8 * i + 2] = colors[i] & 0xff;
+		blocks[8 * i + 1] = blocks[8 * i + 3] = colors[i] >> 8;
+	}
+	std::vector<unsigned char> upright(width * height * 4), flipped(width * height * 4);
+
+	struct threadpool *pool = create_threadpool(2);
+	bcn_decode(BCN_BC1, &blocks[0], width, height, &upright[0], width * 4, pool);
+	bcn_decode(BCN_BC1, &blocks[0], width, height, &flipped[(height - 1) * width * 4], -(ptrdiff_t) width * 4, pool);
+	destroy_threadpool(pool);
+
+	for (unsigned int y = 0; y < height; y++) EXPECT_EQ(0, memcmp(&upright[y * width * 4], &flipped[(height - 1 - y) * width * 4], width * 4));
+	EXPECT_NE(0, memcmp(&upright[0], &upright[4 * width * 4], 4)); // Bottom blocks differ from the top ones
+	EXPECT_NE(0, memcmp(&upright[0], &upright[4 * 4], 4)); // Right blocks differ from the left ones
+}
+
+TEST(BCn, EncodesWithinErrorBound) {
+	// A diagonal gradient, whose colors lie on a line in every block, plus partial blocks at the edges
+	const unsigned int width = 18, height = 10;
+	std::vector<unsigned char> rgba(width * height * 4), decoded(width * height * 4);
+	for (unsigned int i = 0; i < width * height; i++) {
+		unsigned int x = i % width, y = i / width;
+		rgba[4 * i] = (unsigned char) ((x + y) * 9);
+		rgba[4 * i + 1] = (unsigned char) (200 - (x + y) * 7);
+		rgba[4 * i + 2] = (unsigned char) (64 + (x + y) * 3);
+		rgba[4 * i + 3] = (unsigned char) (255 - x * y);
+	}
+	std::vector<unsigned char> blocks(((width + 3) / 4) * ((height + 3) / 4) * 16);
+
+	const enum bcn_format formats[] = { BCN_BC1, BCN_BC3, BCN_BC5 };
+	for (int f = 0; f < 3; f++) {
+		for (int flags = 0; flags <= BCN_QUALITY; flags++) {
+			bcn_encode(formats[f], &rgba[0], width, height, width * 4, &blocks[0], flags, 0);
+			bcn_decode(formats[f], &blocks[0], width, height, &decoded[0], width * 4, 0);
+			int channels = formats[f] == BCN_BC5 ? 2 : formats[f] == BCN_BC3 ? 4 : 3, worst = 0;
+			for (unsigned int i = 0; i < width * height; i++) {
+				if (formats[f] == BCN_BC1 && rgba[4 * i + 3] < 128) continue; // Transparent
+				for (int k = 0; k < channels; k++) worst = std::max(worst, abs(rgba[4 * i + k] - decoded[4 * i + k]));
+			}
+			EXPECT_LE(worst, 16) << "format " << formats[f] << ", flags " << flags;
+		}
+	}
+}
+
+TEST(BCn, EncodesBC1Transparency) {
+	unsigned char rgba[64], decoded[64], block[8];
+	for (int i = 0; i < 16; i++) {
+		rgba[4 * i] = rgba[4 * i + 1] = rgba[4 * i + 2] = (unsigned char) (i * 16);
+		rgba[4 * i + 3] = i % 2 ? 255 : 0;
+	}
+	bcn_encode_block(BCN_BC1, rgba, block, BCN_QUALITY);
+	bcn_decode_block(BCN_BC1, block, decoded);
+	for (int i = 0; i < 16; i++) EXPECT_EQ(rgba[4 * i + 3], decoded[4 * i + 3]);
+}
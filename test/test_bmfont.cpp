@@ -0,0 +1,168 @@
+#include <gtest/gtest.h>
+#include <bmfont.h>
+#include <atlas.h>
+#include "bmfontdata.h"
+#include <string.h>
+#include <stdlib.h>
+#include <vector>
+
+TEST(BMFont, LooksUpGlyphsAndKerning) {
+	std::vector<char> data = makeFont();
+	struct bmfont *font = create_bmfont(&data[0]);
+	ASSERT_TRUE(font != 0);
+	EXPECT_EQ(20u, font->lineHeight);
+	EXPECT_EQ(16u, font->base);
+	EXPECT_EQ(256u, font->scaleW);
+	EXPECT_EQ(128u, font->scaleH);
+	ASSERT_EQ(2u, font->pages);
+	EXPECT_STREQ("p1.dds", bmfont_page_name(font, 1));
+	EXPECT_EQ(0, bmfont_page_name(font, 2));
+	EXPECT_EQ(95u + 2 + 1, font->glyphCount);
+
+	const struct glyph *glyph = bmfont_get_glyph(font, 'A');
+	ASSERT_TRUE(glyph != 0);
+	EXPECT_EQ((unsigned) 'A', glyph->id);
+	EXPECT_EQ('A' % 5 + 8, glyph->width);
+	EXPECT_EQ(-1, glyph->xoffset);
+	EXPECT_EQ(('A' - 32) / 16 * 16, glyph->y);
+	glyph = bmfont_get_glyph(font, 0x1F600);
+	ASSERT_TRUE(glyph != 0);
+	EXPECT_EQ(0x1F600u, glyph->id);
+	EXPECT_EQ(0, bmfont_get_glyph(font, 0x1F601));
+	EXPECT_EQ(0, bmfont_get_glyph(font, 0x4E2E));
+	EXPECT_EQ(0, bmfont_get_glyph(font, 0x10FFFF));
+	EXPECT_EQ(0, bmfont_get_glyph(font, 0xFFFFFFFF));
+	EXPECT_EQ(0, bmfont_get_glyph(font, 127));
+
+	for (unsigned int a = 'A'; a <= 'Z'; a++) {
+		for (unsigned int b = 'A'; b <= 'Z'; b++) ASSERT_EQ(-(int) ((a + b) % 3), bmfont_get_kerning(font, a, b));
+	}
+	EXPECT_EQ(0, bmfont_get_kerning(font, 'A', 'a'));
+	EXPECT_EQ(0, bmfont_get_kerning(font, 'a', 'A'));
+	EXPECT_EQ(0, bmfont_get_kerning(font, 0x4E2D, 'A'));
+	destroy_bmfont(font);
+}
+
+TEST(BMFont, OpensBakedFontsInPlace) {
+	std::vector<char> data = makeFont();
+	data.push_back('\0');
+	struct bmfont *font = bmfont_open(&data[0], data.size());
+	ASSERT_TRUE(font != 0);
+	size_t size;
+	char *baked = bmfont_bake(font, &size);
+	ASSERT_TRUE(baked != 0);
+	std::vector<unsigned int> blob((size + 3) / 4);
+	memcpy(&blob[0], baked, size);
+	free(baked);
+
+	struct bmfont opened;
+	ASSERT_EQ(1, bmfont_open_baked((const char *) &blob[0], size, &opened));
+	EXPECT_EQ(font->lineHeight, opened.lineHeight);
+	EXPECT_EQ(font->glyphCount, opened.glyphCount);
+	EXPECT_STREQ("p0.dds", bmfont_page_name(&opened, 0));
+	EXPECT_STREQ("p1.dds", bmfont_page_name(&opened, 1));
+	for (unsigned int c = 0; c < 0x20000; c++) ASSERT_EQ(bmfont_get_index(font, c), bmfont_get_index(&opened, c));
+	EXPECT_EQ(0, memcmp(font->glyphs, opened.glyphs, font->glyphCount * sizeof(struct glyph)));
+	for (unsigned int a = 'A'; a <= 'Z'; a++) ASSERT_EQ(bmfont_get_kerning(font, a, 'V'), bmfont_get_kerning(&opened, a, 'V'));
+	destroy_bmfont(font);
+
+	struct bmfont *reopened = bmfont_open((const char *) &blob[0], size);
+	ASSERT_TRUE(reopened != 0);
+	EXPECT_EQ(0, reopened->storage);
+	destroy_bmfont(reopened);
+
+	// Reject truncated blobs, other versions and corrupt indices
+	EXPECT_EQ(0, bmfont_open_baked((const char *) &blob[0], size - 4, &opened));
+	blob[1]++;
+	EXPECT_EQ(0, bmfont_open_baked((const char *) &blob[0], size, &opened));
+	blob[1]--;
+	opened.map[0] = 0xFFFF;
+	EXPECT_EQ(0, bmfont_open_baked((const char *) &blob[0], size, &opened));
+}
+
+TEST(BMFont, GrowsGlyphsByTheSpread) {
+	std::vector<char> data = makeFont();
+	struct bmfont *font = create_bmfont(&data[0]);
+	ASSERT_TRUE(font != 0);
+	struct glyph before = *bmfont_get_glyph(font, 'A'), corner = *bmfont_get_glyph(font, ' ');
+	bmfont_set_spread(font, 4);
+	EXPECT_EQ(4u, font->spread);
+	const struct glyph *glyph = bmfont_get_glyph(font, 'A');
+	EXPECT_EQ(before.x - 4, glyph->x);
+	EXPECT_EQ(before.y - 4, glyph->y);
+	EXPECT_EQ(before.width + 8, glyph->width);
+	EXPECT_EQ(before.xoffset - 4, glyph->xoffset);
+	EXPECT_EQ(before.xadvance, glyph->xadvance);
+	// Clamped at the corner of the page
+	glyph = bmfont_get_glyph(font, ' ');
+	EXPECT_EQ(0, glyph->x);
+	EXPECT_EQ(corner.width + 4, glyph->width);
+
+	bmfont_set_spread(font, 0);
+	EXPECT_EQ(0, memcmp(&before, bmfont_get_glyph(font, 'A'), sizeof before));
+	destroy_bmfont(font);
+}
+
+TEST(BMFont, MovesPagesIntoAtlas) {
+	std::vector<char> data = makeFont();
+	struct bmfont *font = create_bmfont(&data[0]);
+	ASSERT_TRUE(font != 0);
+	struct atlas *atlas = create_atlas(512, 512, 0, 0);
+	struct atlas_sprite pages[2];
+	atlas_insert(atlas, 100, 50);
+	pages[0] = *atlas_get(atlas, atlas_insert(atlas, font->scaleW, font->scaleH));
+	pages[1] = *atlas_get(atlas, atlas_insert(atlas, font->scaleW, font->scaleH));
+
+	struct glyph first = *bmfont_get_glyph(font, '!'), last = *bmfont_get_glyph(font, 0x1F600);
+	bmfont_move_pages(font, pages, 512, 512);
+	EXPECT_EQ(512u, font->scaleW);
+	const struct glyph *glyph = bmfont_get_glyph(font, '!');
+	EXPECT_EQ(first.x + pages[0].x, glyph->x);
+	EXPECT_EQ(first.y + 512 - pages[0].y - 128, glyph->y);
+	glyph = bmfont_get_glyph(font, 0x1F600);
+	EXPECT_EQ(1, last.page);
+	EXPECT_EQ(pages[1].page, glyph->page);
+	EXPECT_EQ(last.x + pages[1].x, glyph->x);
+	EXPECT_EQ(last.y + 512 - pages[1].y - 128, glyph->y);
+	destroy_atlas(atlas);
+	destroy_bmfont(font);
+}
+
+TEST(BMFont, LaysOutUTF8WithKerning) {
+	std::vector<char> data = makeFont();
+	struct bmfont *font = create_bmfont(&data[0]);
+	ASSERT_TRUE(font != 0);
+	struct text_quads *quads = create_text_quads(0);
+	const char *text = "AV \n\xE4\xB8\xAD\xFF";
+	float x = 10, y = 5;
+	ASSERT_TRUE(bmfont_layout(font, text, strlen(text), &x, &y, quads));
+	ASSERT_EQ(5u, quads->count);
+
+	// A is 8 wide, advances 9 and is kerned by -1 against V
+	EXPECT_FLOAT_EQ(10 - 1, quads->x[0]);
+	EXPECT_FLOAT_EQ(10 - 1 + 8, quads->x[1]);
+	EXPECT_FLOAT_EQ(5 + 2, quads->y[0]);
+	EXPECT_FLOAT_EQ(5 + 2 + 14, quads->y[1]);
+	EXPECT_FLOAT_EQ(10 + 9 - 1 - 1, quads->x[2]);
+	EXPECT_FLOAT_EQ(('A' - 32) % 16 * 16 / 256.0f, quads->u[0]);
+	EXPECT_FLOAT_EQ(1 - ('A' - 32) / 16 * 16 / 128.0f, quads->v[0]);
+	EXPECT_FLOAT_EQ(1 - (('A' - 32) / 16 * 16 + 14) / 128.0f, quads->v[1]);
+	EXPECT_EQ(0, quads->pages[0]);
+
+	// The CJK character starts the next line, followed by '?' for the malformed byte
+	EXPECT_FLOAT_EQ(10 - 1, quads->x[6]);
+	EXPECT_FLOAT_EQ(5 + 20 + 2, quads->y[6]);
+	EXPECT_FLOAT_EQ(240 / 256.0f, quads->u[6]);
+	EXPECT_EQ(1, quads->pages[3]);
+	EXPECT_FLOAT_EQ(10 + 9 + 0x4E2D % 5 - 1, quads->x[8]);
+	EXPECT_FLOAT_EQ(('?' - 32) % 16 * 16 / 256.0f, quads->u[8]);
+	EXPECT_FLOAT_EQ(10 + 9 + 0x4E2D % 5 + 9 + '?' % 5, x);
+	EXPECT_FLOAT_EQ(25, y);
+
+	// Appending continues from the pen
+	ASSERT_TRUE(bmfont_layout(font, "A", 1, &x, &y, quads));
+	EXPECT_EQ(6u, quads->count);
+	EXPECT_FLOAT_EQ(9 - 1 + 10 + 11, bmfont_measure(font, "AV \n\xE4\xB8\xAD", 7));
+	destroy_text_quads(quads);
+	destroy_bmfont(font);
+}
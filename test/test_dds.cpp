@@ -0,0 +1,298 @@
+#include <gtest/gtest.h>
+#include <bitmap_dds.h>
+#include "glcontext.h"
+#include <string.h>
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+
+static void put32(std::vector<char> &data, size_t offset, uint32_t value) {
+	memcpy(&data[offset], &value, sizeof value);
+}
+
+// Builds a legacy DDS header followed by zeroed pixel data
+static std::vector<char> makeDDS(uint32_t width, uint32_t height, uint32_t mipMapCount, const char *fourCC, size_t dataSize) {
+	std::vector<char> data(4 + 124 + dataSize);
+	memcpy(&data[0], "DDS ", 4);
+	put32(data, 4, 124); // dwSize
+	put32(data, 8, 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000); // dwFlags
+	put32(data, 12, height);
+	put32(data, 16, width);
+	put32(data, 28, mipMapCount);
+	put32(data, 76, 32); // ddpfPixelFormat.dwSize
+	put32(data, 80, 0x4); // DDPF_FOURCC
+	memcpy(&data[84], fourCC, 4);
+	return data;
+}
+
+// Builds a DX10 extended header followed by zeroed pixel data
+static std::vector<char> makeDX10(uint32_t width, uint32_t height, uint32_t mipMapCount, uint32_t dxgiFormat, uint32_t arraySize, size_t dataSize) {
+	std::vector<char> data = makeDDS(width, height, mipMapCount, "DX10", 20 + dataSize);
+	put32(data, 128, dxgiFormat);
+	put32(data, 132, 3); // DDS_DIMENSION_TEXTURE2D
+	put32(data, 140, arraySize);
+	return data;
+}
+
+TEST(DDS, ParsesMipmapChain) {
+	// 16x8 DXT1: 64 + 16 + 8 + 8 + 8 bytes
+	std::vector<char> data = makeDDS(16, 8, 5, "DXT1", 104);
+	struct dds_image image;
+	ASSERT_EQ(1, dds_parse(&data[0], data.size(), &image));
+	EXPECT_EQ((GLenum) GL_TEXTURE_2D, image.target);
+	EXPECT_EQ((GLenum) GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, image.internalformat);
+	EXPECT_EQ(1u, image.faces);
+	EXPECT_EQ(5u, image.levels);
+	EXPECT_EQ(128u, image.mipmaps[0].offset);
+	EXPECT_EQ(64u, image.mipmaps[0].size);
+	EXPECT_EQ(8u, image.mipmaps[1].width);
+	EXPECT_EQ(4u, image.mipmaps[1].height);
+	EXPECT_EQ(192u, image.mipmaps[1].offset);
+	EXPECT_EQ(1u, image.mipmaps[4].width);
+	EXPECT_EQ(8u, image.mipmaps[4].size);
+	EXPECT_EQ(data.size(), image.size);
+}
+
+TEST(DDS, RejectsTruncatedData) {
+	std::vector<char> data = makeDDS(16, 16, 1, "DXT5", 256);
+	struct dds_image image;
+	EXPECT_EQ(1, dds_parse(&data[0], data.size(), &image));
+	EXPECT_EQ(0, dds_parse(&data[0], data.size() - 1, &image));
+	EXPECT_EQ(0, dds_parse(&data[0], 64, &image));
+	memcpy(&data[84], "XYZW", 4);
+	EXPECT_EQ(0, dds_parse(&data[0], data.size(), &image));
+}
+
+TEST(DDS, RejectsTruncatedAndOverflowingHeaders) {
+	// Every prefix of a DX10 array with mipmaps is too short
+	std::vector<char> data = makeDX10(8, 8, 4, 71, 3, 3 * (32 + 8 + 8 + 8));
+	struct dds_image image;
+	ASSERT_EQ(1, dds_parse(&data[0], data.size(), &image));
+	for (size_t size = 0; size < data.size(); size++) EXPECT_EQ(0, dds_parse(&data[0], size, &image)) << size;
+
+	// A DXT5 volume whose level size wraps around to a small number
+	std::vector<char> volume = makeDDS(1 << 20, 1 << 30, 1, "DXT5", 64);
+	put32(volume, 8, 0x1 | 0x2 | 0x4 | 0x1000 | 0x800000); // DDSD_DEPTH
+	put32(volume, 24, 1 << 14);
+	EXPECT_EQ(0, dds_parse(&volume[0], volume.size(), &image));
+
+	// Uncompressed levels, and faces times layers
+	std::vector<char> rgba = makeDX10(1u << 31, 1u << 31, 1, 28, 1, 64);
+	EXPECT_EQ(0, dds_parse(&rgba[0], rgba.size(), &image));
+	std::vector<char> layers = makeDX10(1 << 28, 1 << 28, 1, 71, 2048, 64);
+	EXPECT_EQ(0, dds_parse(&layers[0], layers.size(), &image));
+}
+
+TEST(DDS, ParsesDX10Array) {
+	// Three layers of 8x8 BC7 with two levels: 64 + 16 bytes each
+	std::vector<char> data = makeDX10(8, 8, 2, 98, 3, 240);
+	struct dds_image image;
+	ASSERT_EQ(1, dds_parse(&data[0], data.size(), &image));
+	EXPECT_EQ((GLenum) GL_TEXTURE_2D_ARRAY, image.target);
+	EXPECT_EQ((GLenum) GL_COMPRESSED_RGBA_BPTC_UNORM, image.internalformat);
+	EXPECT_EQ(16, image.blockSize);
+	EXPECT_EQ(3u, image.layers);
+	EXPECT_EQ(148u, image.mipmaps[0].offset);
+	EXPECT_EQ(80u, image.faceSize);
+	EXPECT_EQ(148u + 2 * 80 + 64, DDS_OFFSET(&image, 2, 1));
+	EXPECT_EQ(data.size(), image.size);
+
+	put32(data, 128, 1234); // Unknown DXGI format
+	EXPECT_EQ(0, dds_parse(&data[0], data.size(), &image));
+}
+
+TEST(DDS, FlipsDXT1InPlace) {
+	std::vector<char> data = makeDDS(4, 8, 1, "DXT1", 16);
+	for (int i = 0; i < 16; i++) data[128 + i] = (char) i;
+	struct dds_image image;
+	ASSERT_EQ(1, dds_parse(&data[0], data.size(), &image));
+	dds_flip(&image, &data[0]);
+	const char expected[] = { 8, 9, 10, 11, 15, 14, 13, 12, 0, 1, 2, 3, 7, 6, 5, 4 };
+	EXPECT_EQ(0, memcmp(expected, &data[128], sizeof expected));
+}
+
+static void flipColorBlock(unsigned char *block) {
+	std::swap(block[4], block[7]);
+	std::swap(block[5], block[6]);
+}
+
+// Reverses the four 12-bit lines of the index bits of a BC4 block or the alpha half of a DXT5 block
+static void flipAlphaBlock(unsigned char *block) {
+	uint64_t bits = 0, flipped = 0;
+	for (int i = 0; i < 6; i++) bits |= (uint64_t) block[2 + i] << 8 * i;
+	for (int line = 0; line < 4; line++) flipped |= (bits >> 12 * line & 0xfff) << 12 * (3 - line);
+	for (int i = 0; i < 6; i++) block[2 + i] = (unsigned char) (flipped >> 8 * i);
+}
+
+// Flips one block at a time, as a reference for the row flips
+static void flipBlock(GLenum internalformat, unsigned char *block) {
+	switch (internalformat) {
+	case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+		flipColorBlock(block);
+		break;
+	case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
+		for (int line = 0; line < 2; line++) {
+			std::swap(block[2 * line], block[6 - 2 * line]);
+			std::swap(block[2 * line + 1], block[7 - 2 * line]);
+		}
+		flipColorBlock(block + 8);
+		break;
+	case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+		flipAlphaBlock(block);
+		flipColorBlock(block + 8);
+		break;
+	case GL_COMPRESSED_RED_RGTC1:
+		flipAlphaBlock(block);
+		break;
+	case GL_COMPRESSED_RG_RGTC2:
+		flipAlphaBlock(block);
+		flipAlphaBlock(block + 8);
+		break;
+	}
+}
+
+// Checks the in place and copying flips of a file of random blocks against flipping block by block
+static void checkFlip(std::vector<char> data) {
+	struct dds_image image;
+	ASSERT_EQ(1, dds_parse(&data[0], data.size(), &image));
+	size_t base = image.mipmaps[0].offset;
+	for (size_t i = base; i < data.size(); i++) data[i] = (char) (i * 2654435761u >> 13);
+	std::vector<char> expected(data);
+	for (unsigned int level = 0; level < image.levels; level++) {
+		const struct dds_mipmap *mipmap = image.mipmaps + level;
+		size_t rows = (mipmap->height + 3) / 4, rowSize = (mipmap->width + 3) / 4 * image.blockSize;
+		for (size_t row = 0; row < rows; row++) {
+			unsigned char *target = (unsigned char *) &expected[mipmap->offset + (rows - 1 - row) * rowSize];
+			memcpy(target, &data[mipmap->offset + row * rowSize], rowSize);
+			for (size_t block = 0; block < rowSize; block += image.blockSize) flipBlock(image.internalformat, target + block);
+		}
+	}
+
+	std::vector<char> flipped(data);
+	dds_flip(&image, &flipped[0]);
+	EXPECT_EQ(0, memcmp(&expected[base], &flipped[base], data.size() - base)) << std::hex << image.internalformat;
+
+	if (!createHeadlessContext()) return;
+	GLuint texture = dds_load_texture_from_memory(&data[0], 0, 0, DDS_FLIP_UVS);
+	ASSERT_NE(0u, texture);
+	for (unsigned int level = 0; level < image.levels; level++) {
+		std::vector<char> blocks(image.mipmaps[level].size);
+		glGetCompressedTexImage(GL_TEXTURE_2D, level, &blocks[0]);
+		EXPECT_EQ(0, memcmp(&expected[image.mipmaps[level].offset], &blocks[0], blocks.size())) << std::hex << image.internalformat << " level " << level;
+	}
+	glDeleteTextures(1, &texture);
+}
+
+TEST(DDS, FlipsRowsOfEveryFormat) {
+	// 259 blocks wide, past the scratch buffer of an in place flip with an odd tail for the vector paths, and an odd number of block rows
+	const uint32_t width = 4 * 259, height = 12;
+	const char *fourCCs[] = { "DXT1", "DXT3", "DXT5" };
+	const size_t blockSizes[] = { 8, 16, 16 };
+	for (int i = 0; i < 3; i++) checkFlip(makeDDS(width, height, 2, fourCCs[i], (259 * 3 + 130 * 2) * blockSizes[i]));
+	checkFlip(makeDX10(width, height, 2, 80, 1, (259 * 3 + 130 * 2) * 8)); // BC4_UNORM
+	checkFlip(makeDX10(width, height, 2, 83, 1, (259 * 3 + 130 * 2) * 16)); // BC5_UNORM
+}
+
+// Writes a DDS file, loads it flipped and compares its first level with the flipped source
+static void checkFileLoad(std::vector<char> data) {
+	const char *path = "test_dds_file.dds";
+	FILE *file = fopen(path, "wb");
+	ASSERT_TRUE(file != 0);
+	fwrite(&data[0], 1, data.size(), file);
+	fclose(file);
+
+	int width, height;
+	GLuint texture = dds_load_texture_from_file(path, &width, &height, DDS_FLIP_UVS);
+	remove(path);
+	ASSERT_NE(0u, texture);
+	struct dds_image image;
+	ASSERT_EQ(1, dds_parse(&data[0], data.size(), &image));
+	EXPECT_EQ((int) image.width, width);
+	EXPECT_EQ((int) image.height, height);
+	EXPECT_EQ((GLenum) GL_NO_ERROR, glGetError());
+
+	dds_flip(&image, &data[0]);
+	std::vector<char> pixels(image.mipmaps[0].size);
+	glGetCompressedTexImage(GL_TEXTURE_2D, 0, &pixels[0]);
+	EXPECT_EQ(0, memcmp(&data[128], &pixels[0], pixels.size()));
+	glDeleteTextures(1, &texture);
+}
+
+TEST(DDS, LoadsFileThroughPixelBuffer) {
+	REQUIRE_GL_CONTEXT();
+	std::vector<char> data = makeDDS(8, 8, 2, "DXT5", 80);
+	for (int i = 0; i < 80; i++) data[128 + i] = (char) (i * 7);
+	checkFileLoad(data);
+
+	// Later loads reuse the buffer, growing it for a larger file and writing it again only once the uploads before have read it
+	std::vector<char> large = makeDDS(64, 32, 1, "DXT5", 2048);
+	for (int i = 0; i < 2048; i++) large[128 + i] = (char) (i * 13);
+	checkFileLoad(large);
+	checkFileLoad(data);
+	checkFileLoad(large);
+
+	dds_release_staging_buffer();
+	checkFileLoad(data);
+	dds_release_staging_buffer();
+	EXPECT_EQ((GLenum) GL_NO_ERROR, glGetError());
+}
+
+TEST(DDS, EncodesReadableFile) {
+	const unsigned int width = 12, height = 8;
+	std::vector<unsigned char> rgba(width * height * 4);
+	for (size_t i = 0; i < rgba.size(); i++) rgba[i] = (unsigned char) (i * 5);
+	size_t size;
+	char *data = dds_encode(&rgba[0], width, height, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, DDS_MIPMAPS, &size, 0);
+	ASSERT_TRUE(data != 0);
+
+	struct dds_image image;
+	ASSERT_EQ(1, dds_parse(data, size, &image));
+	EXPECT_EQ((GLenum) GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, image.internalformat);
+	EXPECT_EQ(4u, image.levels);
+	EXPECT_EQ(1u, image.mipmaps[3].width);
+	EXPECT_EQ(size, image.size);
+
+	if (createHeadlessContext()) {
+		int imageWidth, imageHeight;
+		GLuint texture = dds_load_texture_from_memory(data, &imageWidth, &imageHeight, 0);
+		ASSERT_NE(0u, texture);
+		EXPECT_EQ((int) width, imageWidth);
+		EXPECT_EQ((int) height, imageHeight);
+		std::vector<char> blocks(image.mipmaps[0].size);
+		glGetCompressedTexImage(GL_TEXTURE_2D, 0, &blocks[0]);
+		EXPECT_EQ(0, memcmp(data + image.mipmaps[0].offset, &blocks[0], blocks.size()));
+		glDeleteTextures(1, &texture);
+	}
+	free(data);
+}
+
+TEST(DDS, LoadsArrayLayersAndVolumeLevels) {
+	REQUIRE_GL_CONTEXT();
+	// Two layers of 2x2 RGBA8
+	std::vector<char> data = makeDX10(2, 2, 1, 28, 2, 32);
+	for (int i = 0; i < 32; i++) data[148 + i] = (char) i;
+	GLuint texture = dds_load_texture_from_memory(&data[0], 0, 0, 0);
+	ASSERT_NE(0u, texture);
+	char pixels[32];
+	glGetTexImage(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+	EXPECT_EQ(0, memcmp(&data[148], pixels, sizeof pixels));
+	glDeleteTextures(1, &texture);
+
+	// A 2x2x2 BGRA volume with two levels
+	data = makeDDS(2, 2, 2, "\0\0\0\0", 36);
+	put32(data, 8, 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x800000);
+	put32(data, 24, 2); // dwDepth
+	put32(data, 80, 0x41); // DDPF_RGB | DDPF_ALPHAPIXELS
+	put32(data, 88, 32);
+	put32(data, 92, 0x00ff0000);
+	put32(data, 96, 0x0000ff00);
+	put32(data, 100, 0x000000ff);
+	put32(data, 104, 0xff000000);
+	for (int i = 0; i < 36; i++) data[128 + i] = (char) i;
+	texture = dds_load_texture_from_memory(&data[0], 0, 0, 0);
+	ASSERT_NE(0u, texture);
+	EXPECT_EQ((GLenum) GL_NO_ERROR, glGetError());
+	glGetTexImage(GL_TEXTURE_3D, 1, GL_BGRA, GL_UNSIGNED_BYTE, pixels);
+	EXPECT_EQ(0, memcmp(&data[128 + 32], pixels, 4));
+	glDeleteTextures(1, &texture);
+}
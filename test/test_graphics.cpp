@@ -1,8 +1,83 @@
 #include <gtest/gtest.h>
 #include <glh.h>
+#include "glcontext.h"
+#include <thread>
 
 TEST(Graphics, CalculatingStride) {
 	struct attrib attributes[] = { { 0, 3, 0 }, { 0, 2, 0}, NULL_ATTRIB };
 	GLsizei stride = calculate_stride(attributes);
 	EXPECT_EQ(20, stride);
-}
\ No newline at end of file
+}
+
+TEST(Graphics, MeshesKeepTheirLayout) {
+	REQUIRE_GL_CONTEXT();
+	glh_reset_state();
+	struct mesh *mesh = create_mesh(1);
+	ASSERT_TRUE(mesh != 0);
+	struct attrib attributes[] = { { 1, 2, 0 }, { 3, 2, 8 }, NULL_ATTRIB };
+	GLint enabled = 0, bound = 0;
+	with_mesh(mesh, attributes, 16, );
+	ASSERT_NE(0u, mesh->vao);
+	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &bound);
+	EXPECT_EQ((GLint) mesh->vao, bound);
+	glGetVertexAttribiv(3, GL_VERTEX_ATTRIB_ARRAY_ENABLED, &enabled);
+	EXPECT_EQ(GL_TRUE, enabled);
+	glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &bound);
+	EXPECT_EQ((GLint) mesh->ibo, bound);
+
+	// Drawing again only binds the vertex array object, which is bound already
+	struct glh_state_counters before = glh_get_state_counters();
+	with_mesh(mesh, attributes, 16, );
+	struct glh_state_counters after = glh_get_state_counters();
+	EXPECT_EQ(before.issued, after.issued);
+	EXPECT_EQ(before.skipped + 1, after.skipped);
+
+	// A new layout starts with the other attributes disabled
+	struct attrib other[] = { { 2, 4, 0 }, NULL_ATTRIB };
+	ASSERT_TRUE(mesh_set_layout(mesh, other, 16));
+	glGetVertexAttribiv(3, GL_VERTEX_ATTRIB_ARRAY_ENABLED, &enabled);
+	EXPECT_EQ(GL_FALSE, enabled);
+	destroy_mesh(mesh);
+	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &bound);
+	EXPECT_EQ(0, bound);
+	EXPECT_EQ((GLenum) GL_NO_ERROR, glGetError());
+}
+
+TEST(Graphics, SkipsRedundantBindings) {
+	REQUIRE_GL_CONTEXT();
+	glh_reset_state();
+	GLuint textures[2];
+	glGenTextures(2, textures);
+	glh_active_texture(0);
+	glh_bind_texture(GL_TEXTURE_2D, textures[0]);
+	struct glh_state_counters before = glh_get_state_counters();
+	glh_bind_texture(GL_TEXTURE_2D, textures[0]);
+	glh_active_texture(0);
+	EXPECT_EQ(before.skipped + 2, glh_get_state_counters().skipped);
+
+	// Every unit has a binding of its own
+	glh_active_texture(1);
+	glh_bind_texture(GL_TEXTURE_2D, textures[1]);
+	glh_active_texture(0);
+	before = glh_get_state_counters();
+	glh_bind_texture(GL_TEXTURE_2D, textures[0]);
+	EXPECT_EQ(before.skipped + 1, glh_get_state_counters().skipped);
+
+	// A deleted texture is unbound, even if its name comes back
+	glh_delete_textures(1, textures);
+	glGenTextures(1, textures);
+	before = glh_get_state_counters();
+	glh_bind_texture(GL_TEXTURE_2D, textures[0]);
+	EXPECT_EQ(before.issued + 1, glh_get_state_counters().issued);
+	GLint bound;
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &bound);
+	EXPECT_EQ((GLint) textures[0], bound);
+	glh_delete_textures(2, textures);
+	EXPECT_EQ((GLenum) GL_NO_ERROR, glGetError());
+
+	// Other threads, with contexts of their own, have caches of their own
+	struct glh_state_counters other = { 1, 1 };
+	std::thread([&other] { other = glh_get_state_counters(); }).join();
+	EXPECT_EQ(0ul, other.issued);
+	EXPECT_EQ(0ul, other.skipped);
+}
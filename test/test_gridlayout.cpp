@@ -0,0 +1,298 @@
+#include <gtest/gtest.h>
+#include <gridlayout.h>
+#include <string.h>
+#include <vector>
+
+/** A widget with fixed intrinsic sizes. */
+struct box {
+	struct widget widget;
+	float minWidth, maxWidth, minHeight, maxHeight;
+};
+
+static int measureCount;
+
+static float boxMinWidth(struct widget *widget) {
+	measureCount++;
+	return ((struct box *) widget)->minWidth;
+}
+static float boxMaxWidth(struct widget *widget) { return ((struct box *) widget)->maxWidth; }
+static float boxMinHeight(struct widget *widget) { return ((struct box *) widget)->minHeight; }
+static float boxMaxHeight(struct widget *widget) { return ((struct box *) widget)->maxHeight; }
+
+static struct gridlayout makeGrid(struct size *columns, int columnCount, struct size *rows, int rowCount, struct item *items, int itemCount) {
+	struct gridlayout grid = {};
+	grid.columns = columnCount;
+	grid.rows = rowCount;
+	grid.templateColumns = columns;
+	grid.templateRows = rows;
+	grid.items = items;
+	grid.itemCount = itemCount;
+	grid.minWidth = boxMinWidth;
+	grid.maxWidth = boxMaxWidth;
+	grid.minHeight = boxMinHeight;
+	grid.maxHeight = boxMaxHeight;
+	return grid;
+}
+
+TEST(GridLayout, PositionsSpanningItems) {
+	struct size columns[] = { { 50, 50 }, AUTO, { 0, FLEX(1) } }, rows[] = { { 20, 20 }, { 30, 30 } };
+	struct box boxes[4] = {
+		{ { 0 }, 0, 0, 0, 0 },
+		{ { 0 }, 40, 60, 10, 10 },
+		{ { 0 }, 0, 0, 0, 0 },
+		{ { 0 }, 10, 10, 10, 10 }
+	};
+	struct item items[] = {
+		{ 0, 0, 1, 1, ALIGN_LEFT | ALIGN_TOP, 1, 1, &boxes[0].widget },
+		{ 1, 0, 1, 1, ALIGN_CENTER, 0.5f, 1, &boxes[1].widget },
+		{ 0, 1, 3, 1, ALIGN_RIGHT | ALIGN_BOTTOM, 0.5f, 0.5f, &boxes[2].widget },
+		{ 2, 0, 1, 2, ALIGN_RIGHT | ALIGN_TOP, 1, 1, &boxes[3].widget }
+	};
+	struct gridlayout grid = makeGrid(columns, 3, rows, 2, items, 4);
+	layoutGrid(&grid, 10, 5, 300, 50);
+
+	EXPECT_FLOAT_EQ(50 + 40, grid.gridMinWidth);
+	EXPECT_FLOAT_EQ(50, grid.gridMinHeight);
+	// The auto column grows to its maximum and the flexible column takes the rest
+	EXPECT_FLOAT_EQ(10, boxes[0].widget.x);
+	EXPECT_FLOAT_EQ(5, boxes[0].widget.y);
+	EXPECT_FLOAT_EQ(50, boxes[0].widget.width);
+	EXPECT_FLOAT_EQ(20, boxes[0].widget.height);
+	EXPECT_FLOAT_EQ(30, boxes[1].widget.width);
+	EXPECT_FLOAT_EQ(10 + 50 + 15, boxes[1].widget.x);
+	EXPECT_FLOAT_EQ(10, boxes[1].widget.height);
+	EXPECT_FLOAT_EQ(5 + 5, boxes[1].widget.y);
+
+	// Spans are measured across all their tracks, and right alignment is to the end of the span
+	EXPECT_FLOAT_EQ(150, boxes[2].widget.width);
+	EXPECT_FLOAT_EQ(10 + 300 - 150, boxes[2].widget.x);
+	EXPECT_FLOAT_EQ(15, boxes[2].widget.height);
+	EXPECT_FLOAT_EQ(5 + 50 - 15, boxes[2].widget.y);
+	EXPECT_FLOAT_EQ(10, boxes[3].widget.width);
+	EXPECT_FLOAT_EQ(10 + 300 - 10, boxes[3].widget.x);
+	EXPECT_FLOAT_EQ(5, boxes[3].widget.y);
+	freeGridLayout(&grid);
+}
+
+TEST(GridLayout, PositionsLargeGrids) {
+	const int columnCount = 20, rowCount = 500;
+	std::vector<struct size> columns(columnCount), rows(rowCount);
+	for (int i = 0; i < columnCount; i++) columns[i].min = columns[i].max = 10.0f + i;
+	for (int i = 0; i < rowCount; i++) rows[i].min = rows[i].max = 8;
+	std::vector<struct box> boxes(columnCount * rowCount);
+	std::vector<struct item> items(boxes.size());
+	for (size_t i = 0; i < items.size(); i++) {
+		struct item item = { (int) (i % columnCount), (int) (i / columnCount), 1, 1, ALIGN_LEFT | ALIGN_TOP, 1, 1, &boxes[i].widget };
+		items[i] = item;
+	}
+	// An item outside the grid is left alone
+	struct box outside = { { -1, -1, -1, -1 }, 0, 0, 0, 0 };
+	struct item stray = { columnCount, 0, 1, 1, 0, 1, 1, &outside.widget };
+	items.push_back(stray);
+
+	struct gridlayout grid = makeGrid(&columns[0], columnCount, &rows[0], rowCount, &items[0], (int) items.size());
+	layoutGrid(&grid, 0, 0, 1000, 4000);
+	for (int row = 0; row < rowCount; row++) {
+		float x = 0;
+		for (int column = 0; column < columnCount; column++) {
+			const struct widget &widget = boxes[row * columnCount + column].widget;
+			ASSERT_FLOAT_EQ(x, widget.x);
+			ASSERT_FLOAT_EQ(8.0f * row, widget.y);
+			ASSERT_FLOAT_EQ(10.0f + column, widget.width);
+			x += widget.width;
+		}
+	}
+	EXPECT_EQ(-1, outside.widget.x);
+	freeGridLayout(&grid);
+}
+
+TEST(GridLayout, MeasuresOnlyInvalidatedItems) {
+	struct size columns[] = { AUTO, { 0, FLEX(1) } }, rows[] = { AUTO };
+	struct box boxes[2] = { { { 0 }, 40, 60, 10, 20 }, { { 0 }, 10, 10, 10, 10 } };
+	struct item items[] = {
+		{ 0, 0, 1, 1, ALIGN_LEFT, 1, 1, &boxes[0].widget },
+		{ 1, 0, 1, 1, ALIGN_LEFT, 1, 1, &boxes[1].widget }
+	};
+	struct gridlayout grid = makeGrid(columns, 2, rows, 1, items, 2);
+	measureCount = 0;
+	layoutGrid(&grid, 0, 0, 200, 50);
+	EXPECT_EQ(2, measureCount);
+	EXPECT_FLOAT_EQ(60, boxes[0].widget.width);
+	EXPECT_FLOAT_EQ(60, boxes[1].widget.x);
+
+	// Moving and resizing the grid reuses the measurements
+	layoutGrid(&grid, 5, 0, 100, 50);
+	layoutGrid(&grid, 5, 0, 100, 50);
+	EXPECT_EQ(2, measureCount);
+	EXPECT_FLOAT_EQ(65, boxes[1].widget.x);
+
+	boxes[0].maxWidth = 80;
+	invalidateGridItem(&grid, 0);
+	layoutGrid(&grid, 0, 0, 200, 50);
+	EXPECT_EQ(3, measureCount);
+	EXPECT_FLOAT_EQ(80, boxes[0].widget.width);
+	EXPECT_FLOAT_EQ(80, boxes[1].widget.x);
+
+	// Templates are only read again when invalidated
+	columns[0].min = columns[0].max = 30;
+	layoutGrid(&grid, 0, 0, 200, 50);
+	EXPECT_FLOAT_EQ(80, boxes[1].widget.x);
+	invalidateGrid(&grid);
+	layoutGrid(&grid, 0, 0, 200, 50);
+	EXPECT_EQ(3, measureCount);
+	EXPECT_FLOAT_EQ(30, boxes[1].widget.x);
+	freeGridLayout(&grid);
+}
+
+TEST(GridLayout, LaysOutInCallerMemory) {
+	// The first flexible track would get less than its base size, so it is treated as inflexible
+	struct size columns[] = { { 100, FLEX(0.25f) }, { 0, FLEX(0.75f) } }, rows[] = { { 0, FLEX(1) } };
+	struct box boxes[2] = {};
+	struct item items[] = {
+		{ 0, 0, 1, 1, ALIGN_LEFT, 1, 1, &boxes[0].widget },
+		{ 1, 0, 1, 1, ALIGN_LEFT, 1, 1, &boxes[1].widget }
+	};
+	struct gridlayout grid = makeGrid(columns, 2, rows, 1, items, 2);
+	double storage[64];
+	ASSERT_LE(gridLayoutSize(&grid), sizeof storage);
+	EXPECT_EQ(0, initGridLayout(&grid, storage, gridLayoutSize(&grid) - 1));
+	ASSERT_EQ(1, initGridLayout(&grid, storage, sizeof storage));
+	layoutGrid(&grid, 0, 0, 200, 40);
+	EXPECT_EQ((void *) storage, (void *) grid.cache);
+	EXPECT_FLOAT_EQ(100, boxes[0].widget.width);
+	EXPECT_FLOAT_EQ(100, boxes[1].widget.x);
+	EXPECT_FLOAT_EQ(75, boxes[1].widget.width);
+	EXPECT_FLOAT_EQ(40, boxes[1].widget.height);
+
+	// Both are flexible once there is room
+	layoutGrid(&grid, 0, 0, 800, 40);
+	EXPECT_FLOAT_EQ(200, boxes[0].widget.width);
+	EXPECT_FLOAT_EQ(600, boxes[1].widget.width);
+
+	// A smaller grid still fits
+	grid.itemCount = 1;
+	layoutGrid(&grid, 0, 0, 800, 40);
+	EXPECT_EQ((void *) storage, (void *) grid.cache);
+	freeGridLayout(&grid);
+	EXPECT_EQ(0, grid.cache);
+}
+
+TEST(GridLayout, LaysOutNestedGrids) {
+	// A row of panels, each a column of fixed-size boxes, in an auto-sized column and a flexible column
+	const int panelCount = 8, boxCount = 5;
+	struct size autoSize = AUTO, rootColumns[] = { AUTO, { 0, FLEX(1) } }, rootRows[panelCount], panelColumns[] = { AUTO }, panelRows[boxCount];
+	for (int i = 0; i < panelCount; i++) rootRows[i] = autoSize;
+	for (int i = 0; i < boxCount; i++) panelRows[i] = autoSize;
+	std::vector<struct box> boxes(panelCount * boxCount), panels(2 * panelCount);
+	std::vector<struct item> boxItems(boxes.size()), panelItems(panels.size());
+	std::vector<struct gridlayout> grids(panels.size());
+	for (int p = 0; p < 2 * panelCount; p++) {
+		int column = p % 2, row = p / 2;
+		struct item *items = &boxItems[row * boxCount];
+		if (column == 0) {
+			for (int b = 0; b < boxCount; b++) {
+				struct box box = { { 0 }, 20.0f + row, 20.0f + row, 10, 10 };
+				boxes[row * boxCount + b] = box;
+				struct item item = { 0, b, 1, 1, ALIGN_LEFT | ALIGN_TOP, 1, 1, &boxes[row * boxCount + b].widget };
+				items[b] = item;
+			}
+		}
+		grids[p] = makeGrid(panelColumns, 1, panelRows, column == 0 ? boxCount : 0, items, column == 0 ? boxCount : 0);
+		struct item item = { column, row, 1, 1, ALIGN_LEFT | ALIGN_TOP, 1, 1, &panels[p].widget, &grids[p] };
+		panelItems[p] = item;
+	}
+	struct gridlayout root = makeGrid(rootColumns, 2, rootRows, panelCount, &panelItems[0], 2 * panelCount);
+
+	struct threadpool *pool = create_threadpool(3);
+	layoutGridTree(&root, 10, 0, 500, 1000, pool);
+	// The auto column fits the widest panel, whose height is the sum of its boxes
+	EXPECT_FLOAT_EQ(20.0f + panelCount - 1, panels[0].widget.width);
+	EXPECT_FLOAT_EQ(5 * 10.0f, grids[0].gridMinHeight);
+	for (int row = 0; row < panelCount; row++) {
+		for (int b = 0; b < boxCount; b++) {
+			const struct widget &widget = boxes[row * boxCount + b].widget;
+			ASSERT_FLOAT_EQ(10, widget.x);
+			ASSERT_FLOAT_EQ(panels[2 * row].widget.y + 10.0f * b, widget.y);
+			ASSERT_FLOAT_EQ(20.0f + row, widget.width);
+		}
+	}
+	EXPECT_FLOAT_EQ(10 + 27 + 473, panels[1].widget.x + panels[1].widget.width);
+
+	// A box grown in a nested grid resizes the column of the root
+	boxes[0].minWidth = boxes[0].maxWidth = 40;
+	invalidateGridItem(&grids[0], 0);
+	layoutGrid(&root, 10, 0, 500, 1000);
+	EXPECT_FLOAT_EQ(40, panels[0].widget.width);
+	EXPECT_FLOAT_EQ(50, panels[1].widget.x);
+
+	// Laying out on the pool gives the same positions
+	std::vector<struct box> serial(boxes);
+	for (size_t i = 0; i < boxes.size(); i++) boxes[i].widget.x = boxes[i].widget.y = -1;
+	layoutGridTree(&root, 10, 0, 500, 1000, pool);
+	for (size_t i = 0; i < boxes.size(); i++) ASSERT_EQ(0, memcmp(&serial[i].widget, &boxes[i].widget, sizeof(struct widget)));
+	destroy_threadpool(pool);
+
+	for (size_t i = 0; i < grids.size(); i++) freeGridLayout(&grids[i]);
+	freeGridLayout(&root);
+}
+
+/** Shows the row index in the width of the first cell. */
+static void bindTableRow(struct virtualgrid *grid, int row) {
+	struct box *cells = (struct box *) grid->user;
+	cells[0].minWidth = cells[0].maxWidth = (float) (row % 100);
+	cells[0].minHeight = cells[0].maxHeight = row % 2 == 0 ? 30.0f : 10.0f;
+	invalidateGridItem(grid->row, 0);
+}
+
+TEST(GridLayout, LaysOutRowsInView) {
+	struct size columns[] = { AUTO, { 0, FLEX(1) } }, rows[] = { AUTO };
+	struct box cells[2] = { { { 0 }, 0, 0, 0, 0 }, { { 0 }, 5, 5, 5, 5 } };
+	struct item items[] = {
+		{ 0, 0, 1, 1, ALIGN_LEFT | ALIGN_TOP, 1, 1, &cells[0].widget },
+		{ 1, 0, 1, 1, ALIGN_LEFT | ALIGN_TOP, 1, 1, &cells[1].widget }
+	};
+	struct gridlayout rowGrid = makeGrid(columns, 2, rows, 1, items, 2);
+	struct virtualgrid table = {};
+	table.row = &rowGrid;
+	table.bindRow = bindTableRow;
+	table.user = cells;
+	table.rowHeight = 20;
+	ASSERT_EQ(1, setVirtualGridRows(&table, 1000000));
+	EXPECT_EQ(0, table.tree);
+
+	// Far rows keep exact offsets and only the rows in view are laid out
+	EXPECT_DOUBLE_EQ(20.0 * 1000000, getVirtualGridRowOffset(&table, 1000000));
+	EXPECT_EQ(987654, getVirtualGridRowAt(&table, 20.0 * 987654 + 19.5));
+	EXPECT_EQ(-1, getVirtualGridRowAt(&table, 20.0 * 1000000));
+	EXPECT_EQ(6, layoutVirtualGrid(&table, 0, 100, 300, 100, 20.0 * 987654 + 10));
+	EXPECT_FLOAT_EQ(59, cells[0].widget.width);
+	EXPECT_FLOAT_EQ(100 - 10 + 5 * 20, cells[0].widget.y);
+
+	ASSERT_EQ(1, setVirtualGridRowHeight(&table, 10, 50));
+	ASSERT_EQ(1, setVirtualGridRowHeight(&table, 999990, 0));
+	EXPECT_FLOAT_EQ(50, getVirtualGridRowHeight(&table, 10));
+	EXPECT_DOUBLE_EQ(20.0 * 10, getVirtualGridRowOffset(&table, 10));
+	EXPECT_DOUBLE_EQ(20.0 * 10 + 50, getVirtualGridRowOffset(&table, 11));
+	EXPECT_DOUBLE_EQ(20.0 * 1000000 + 30 - 20, getVirtualGridRowOffset(&table, 1000000));
+	EXPECT_EQ(10, getVirtualGridRowAt(&table, 20.0 * 10 + 49));
+	EXPECT_EQ(11, getVirtualGridRowAt(&table, 20.0 * 10 + 50));
+	EXPECT_EQ(999991, getVirtualGridRowAt(&table, 20.0 * 999990 + 30));
+
+	// Added rows have the default height
+	ASSERT_EQ(1, setVirtualGridRows(&table, 1000003));
+	EXPECT_DOUBLE_EQ(20.0 * 1000003 + 30 - 20, getVirtualGridRowOffset(&table, 1000003));
+	ASSERT_EQ(1, setVirtualGridRows(&table, 12));
+	ASSERT_EQ(1, setVirtualGridRows(&table, 40));
+	EXPECT_DOUBLE_EQ(20.0 * 40 + 30, getVirtualGridRowOffset(&table, 40));
+
+	// Rows fitted to their content as they come into view
+	table.fitRows = 1;
+	EXPECT_EQ(5, layoutVirtualGrid(&table, 0, 0, 300, 100, 0));
+	EXPECT_FLOAT_EQ(30, getVirtualGridRowHeight(&table, 4));
+	EXPECT_FLOAT_EQ(10, getVirtualGridRowHeight(&table, 3));
+	EXPECT_FLOAT_EQ(20, getVirtualGridRowHeight(&table, 5));
+	EXPECT_FLOAT_EQ(30 + 10 + 30 + 10, cells[0].widget.y);
+	EXPECT_DOUBLE_EQ(110, getVirtualGridRowOffset(&table, 5));
+	freeVirtualGrid(&table);
+	freeGridLayout(&rowGrid);
+}
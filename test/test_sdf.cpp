@@ -0,0 +1,62 @@
+#include <gtest/gtest.h>
+#include <sdf.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+
+/** Returns the signed distance of a pixel by brute force, positive outside. */
+static float bruteForce(const std::vector<unsigned char> &coverage, int width, int height, int x, int y) {
+	bool inside = coverage[y * width + x] >= 128;
+	float best = 1e10f;
+	for (int j = 0; j < height; j++) {
+		for (int i = 0; i < width; i++) {
+			if ((coverage[j * width + i] >= 128) == inside) continue;
+			best = std::min(best, sqrtf((float) ((i - x) * (i - x) + (j - y) * (j - y))));
+		}
+	}
+	return inside ? 0.5f - best : best - 0.5f;
+}
+
+TEST(SDF, MatchesBruteForce) {
+	// A ring with a gap, whose holes and thin parts exercise both fields
+	const int width = 70, height = 50;
+	const float spread = 6;
+	std::vector<unsigned char> coverage(width * height);
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			float r = hypotf(x - 30.0f, y - 24.0f);
+			coverage[y * width + x] = r > 8 && r < 18 && x < 44 ? 255 : 0;
+		}
+	}
+	std::vector<unsigned char> field(width * height);
+	ASSERT_EQ(1, sdf_generate(&coverage[0], width, height, width, 1, spread, &field[0], 0));
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			float expected = 127.5f - bruteForce(coverage, width, height, x, y) * 127.5f / spread;
+			expected = std::max(0.0f, std::min(255.0f, expected));
+			ASSERT_NEAR(expected, field[y * width + x], 1.0f) << x << ", " << y;
+		}
+	}
+	EXPECT_EQ(0, field[0]);
+	EXPECT_GT(field[24 * width + 30 - 13], 200);
+	EXPECT_LT(field[24 * width + 30], 64);
+
+	// Shrinking averages the distances, and splitting the work changes nothing
+	std::vector<unsigned char> shrunk(width / 4 * (height / 4)), pooled(shrunk.size());
+	ASSERT_EQ(1, sdf_generate(&coverage[0], width, height, width, 4, spread, &shrunk[0], 0));
+	struct threadpool *pool = create_threadpool(3);
+	ASSERT_EQ(1, sdf_generate(&coverage[0], width, height, width, 4, spread, &pooled[0], pool));
+	destroy_threadpool(pool);
+	EXPECT_EQ(shrunk, pooled);
+	for (int y = 0; y < height / 4; y++) {
+		for (int x = 0; x < width / 4; x++) {
+			float sum = 0;
+			for (int j = 0; j < 4; j++) {
+				for (int i = 0; i < 4; i++) sum += bruteForce(coverage, width, height, 4 * x + i, 4 * y + j);
+			}
+			float expected = std::max(0.0f, std::min(255.0f, 127.5f - sum / 16 * 127.5f / spread));
+			ASSERT_NEAR(expected, shrunk[y * (width / 4) + x], 1.0f) << x << ", " << y;
+		}
+	}
+	EXPECT_EQ(0, sdf_generate(&coverage[0], width, height, width, 0, spread, &shrunk[0], 0));
+}
@@ -0,0 +1,149 @@
+#include <gtest/gtest.h>
+#include <spritebatch.h>
+#include "glcontext.h"
+#include <vector>
+
+static const char *vertexShader = GLSL(330,
+	uniform vec2 viewport;
+	layout(location = 0) in vec4 rect;
+	layout(location = 1) in vec4 uvs;
+	layout(location = 2) in vec4 tint;
+	out vec2 uv;
+	out vec4 color;
+	void main() {
+		vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+		vec2 position = rect.xy + corner * rect.zw;
+		uv = mix(uvs.xw, uvs.zy, corner);
+		color = tint;
+		gl_Position = vec4(position.x / viewport.x * 2 - 1, 1 - position.y / viewport.y * 2, 0, 1);
+	});
+
+static const char *fragmentShader = GLSL(330,
+	uniform sampler2D page;
+	in vec2 uv;
+	in vec4 color;
+	out vec4 fragColor;
+	void main() {
+		fragColor = texture(page, uv) * color;
+	});
+
+static struct sprite_instance makeSprite(float x, float y, float size) {
+	struct sprite_instance sprite = { x, y, size, size, 0, 0, 65535, 65535, { 255, 255, 255, 255 } };
+	return sprite;
+}
+
+TEST(SpriteBatch, SortsByDepthProgramAndTexture) {
+	struct sprite_batch *batch = create_sprite_batch(0);
+	ASSERT_TRUE(batch != 0);
+	// Textures 1 and 2 of programs 5 and 6, at depths 0 and 300 so that both bytes of the depth sort
+	const GLuint programs[] = { 6, 5, 6, 5, 6, 6 }, textures[] = { 2, 1, 1, 2, 2, 1 };
+	const unsigned short depths[] = { 300, 0, 0, 300, 0, 300 };
+	for (int i = 0; i < 6; i++) {
+		struct sprite_instance sprite = makeSprite((float) i, 0, 1);
+		ASSERT_TRUE(sprite_batch_add(batch, programs[i], textures[i], depths[i], &sprite));
+	}
+	EXPECT_EQ(6u, sprite_batch_count(batch));
+
+	// Programs sort by the order they were first added in, and equal sprites keep their order
+	std::vector<struct sprite_instance> instances(6);
+	EXPECT_EQ(6u, sprite_batch_prepare(batch, &instances[0]));
+	const float expected[] = { 2, 4, 1, 5, 0, 3 };
+	for (int i = 0; i < 6; i++) EXPECT_EQ(expected[i], instances[i].x);
+
+	// Preparing again, and after adding, sorts the sprites as added
+	EXPECT_EQ(6u, sprite_batch_prepare(batch, &instances[0]));
+	for (int i = 0; i < 6; i++) EXPECT_EQ(expected[i], instances[i].x);
+	struct sprite_instance last = makeSprite(6, 0, 1);
+	ASSERT_TRUE(sprite_batch_add(batch, 5, 1, 0, &last));
+	instances.resize(7);
+	EXPECT_EQ(6u, sprite_batch_prepare(batch, &instances[0]));
+	const float added[] = { 2, 4, 1, 6, 5, 0, 3 };
+	for (int i = 0; i < 7; i++) EXPECT_EQ(added[i], instances[i].x);
+
+	sprite_batch_clear(batch);
+	EXPECT_EQ(0u, sprite_batch_prepare(batch, &instances[0]));
+	destroy_sprite_batch(batch);
+}
+
+TEST(SpriteBatch, PreparesTheSameOrderTwice) {
+	struct sprite_batch *batch = create_sprite_batch(0);
+	const unsigned short depths[] = { 3, 1, 2, 0 };
+	for (int i = 0; i < 4; i++) {
+		struct sprite_instance sprite = makeSprite((float) i, 0, 1);
+		ASSERT_TRUE(sprite_batch_add(batch, 1, 1, depths[i], &sprite));
+	}
+	std::vector<struct sprite_instance> instances(4);
+	for (int pass = 0; pass < 2; pass++) {
+		EXPECT_EQ(1u, sprite_batch_prepare(batch, &instances[0]));
+		const float expected[] = { 3, 1, 2, 0 };
+		for (int i = 0; i < 4; i++) EXPECT_EQ(expected[i], instances[i].x) << pass;
+	}
+	destroy_sprite_batch(batch);
+}
+
+TEST(SpriteBatch, DrawsRunsInstanced) {
+	REQUIRE_GL_CONTEXT();
+	GLuint program = create_program(vertexShader, fragmentShader), renderbuffer, framebuffer, textures[2];
+	ASSERT_NE(0u, program);
+	glUseProgram(program);
+	glUniform2f(glGetUniformLocation(program, "viewport"), 32, 32);
+	glGenRenderbuffers(1, &renderbuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, renderbuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, 32, 32);
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffer);
+	glViewport(0, 0, 32, 32);
+	glClearColor(0, 0, 0, 0);
+	glClear(GL_COLOR_BUFFER_BIT);
+	const unsigned char colors[][4] = { { 255, 0, 0, 255 }, { 0, 255, 0, 255 } };
+	glGenTextures(2, textures);
+	for (int i = 0; i < 2; i++) {
+		glBindTexture(GL_TEXTURE_2D, textures[i]);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, colors[i]);
+	}
+	glh_reset_state();
+
+	struct stream_buffer *stream = create_stream_buffer(4096);
+	struct sprite_batch *batch = create_sprite_batch(16);
+	ASSERT_TRUE(stream != 0 && batch != 0);
+	// A red sprite in front of a green one, and a row of red sprites behind
+	struct sprite_instance front = makeSprite(0, 0, 16), back = makeSprite(8, 8, 16);
+	front.color[2] = 0;
+	sprite_batch_add(batch, program, textures[0], 1, &front);
+	sprite_batch_add(batch, program, textures[1], 0, &back);
+	for (int i = 0; i < 4; i++) {
+		struct sprite_instance sprite = makeSprite(8.0f * i, 28, 4);
+		sprite_batch_add(batch, program, textures[0], 0, &sprite);
+	}
+	EXPECT_EQ(3, sprite_batch_draw(batch, stream));
+	EXPECT_EQ(0u, sprite_batch_count(batch));
+	stream_buffer_end_frame(stream);
+
+	uint32_t pixels[32 * 32];
+	glReadPixels(0, 0, 32, 32, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+	EXPECT_EQ(0xFF0000FFu, pixels[(31 - 4) * 32 + 4]);
+	EXPECT_EQ(0xFF0000FFu, pixels[(31 - 12) * 32 + 12]); // The front sprite covers the back one
+	EXPECT_EQ(0xFF00FF00u, pixels[(31 - 20) * 32 + 20]);
+	EXPECT_EQ(0xFF0000FFu, pixels[(31 - 30) * 32 + 25]);
+	EXPECT_EQ(0u, pixels[(31 - 30) * 32 + 29]);
+
+	// Sprites of one texture take a single call
+	for (int i = 0; i < 16; i++) {
+		struct sprite_instance sprite = makeSprite(2.0f * i, 0, 1);
+		sprite_batch_add(batch, program, textures[1], (unsigned short) (i % 3), &sprite);
+	}
+	EXPECT_EQ(1, sprite_batch_draw(batch, stream));
+	stream_buffer_end_frame(stream);
+	EXPECT_EQ((GLenum) GL_NO_ERROR, glGetError());
+
+	destroy_sprite_batch(batch);
+	destroy_stream_buffer(stream);
+	glh_delete_textures(2, textures);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDeleteFramebuffers(1, &framebuffer);
+	glDeleteRenderbuffers(1, &renderbuffer);
+	glDeleteProgram(program);
+	glh_reset_state();
+}
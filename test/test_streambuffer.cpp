@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+#include <streambuffer.h>
+#include "glcontext.h"
+#include <string.h>
+
+static const char *vertexShader = GLSL(330,
+	in vec2 position;
+	void main() {
+		gl_Position = vec4(position, 0, 1);
+	});
+
+static const char *fragmentShader = GLSL(330,
+	layout(std140) uniform Tint {
+		vec4 tint;
+	};
+	out vec4 color;
+	void main() {
+		color = tint;
+	});
+
+TEST(StreamBuffer, StreamsFramesThroughTheRing) {
+	REQUIRE_GL_CONTEXT();
+	struct stream_buffer *stream = create_stream_buffer(1000);
+	ASSERT_TRUE(stream != 0);
+	EXPECT_EQ(1024u, stream->frameSize);
+	EXPECT_EQ(0, (void *) stream_buffer_alloc(stream, 1025, 1, 0));
+
+	GLuint program = create_program(vertexShader, fragmentShader), renderbuffer, framebuffer, vertexArray;
+	ASSERT_NE(0u, program);
+	glUniformBlockBinding(program, glGetUniformBlockIndex(program, "Tint"), 0);
+	GLint position = glGetAttribLocation(program, "position");
+	glh_reset_state();
+	glh_use_program(program);
+	glGenRenderbuffers(1, &renderbuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, renderbuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, 4, 4);
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffer);
+	glViewport(0, 0, 4, 4);
+	glGenVertexArrays(1, &vertexArray);
+	glh_bind_vertex_array(vertexArray);
+	glEnableVertexAttribArray(position);
+
+	// Every frame draws a triangle covering the framebuffer in a color of its own
+	const float triangle[] = { -1, -1, 3, -1, -1, 3 };
+	const GLushort indices[] = { 0, 1, 2 };
+	for (int frame = 0; frame < 2 * STREAM_BUFFER_FRAMES; frame++) {
+		GLintptr vertexOffset, indexOffset, uniformOffset;
+		void *vertices = stream_buffer_alloc(stream, sizeof(triangle), 2 * sizeof(float), &vertexOffset);
+		void *elements = stream_buffer_alloc(stream, sizeof(indices), sizeof(GLushort), &indexOffset);
+		float *tint = (float *) stream_buffer_alloc(stream, 4 * sizeof(float), stream->uniformAlignment, &uniformOffset);
+		ASSERT_TRUE(vertices != 0 && elements != 0 && tint != 0);
+		EXPECT_EQ(frame % STREAM_BUFFER_FRAMES, (int) (vertexOffset / stream->frameSize));
+		EXPECT_EQ(0, uniformOffset % stream->uniformAlignment);
+		memcpy(vertices, triangle, sizeof(triangle));
+		memcpy(elements, indices, sizeof(indices));
+		tint[0] = frame / 8.0f;
+		tint[1] = tint[2] = 0;
+		tint[3] = 1;
+
+		glh_bind_buffer(GL_ARRAY_BUFFER, stream->buffer);
+		glVertexAttribPointer(position, 2, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(vertexOffset));
+		glh_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, stream->buffer);
+		glh_bind_buffer_range(GL_UNIFORM_BUFFER, 0, stream->buffer, uniformOffset, 4 * sizeof(float));
+		glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_SHORT, BUFFER_OFFSET(indexOffset));
+		stream_buffer_end_frame(stream);
+
+		unsigned char pixel[4];
+		glReadPixels(1, 1, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixel);
+		EXPECT_NEAR(frame * 255 / 8, pixel[0], 1);
+		EXPECT_EQ(255, pixel[3]);
+	}
+	EXPECT_EQ((GLenum) GL_NO_ERROR, glGetError());
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDeleteFramebuffers(1, &framebuffer);
+	glDeleteRenderbuffers(1, &renderbuffer);
+	glDeleteVertexArrays(1, &vertexArray);
+	glDeleteProgram(program);
+	glh_reset_state();
+	destroy_stream_buffer(stream);
+}
@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+#include <texcache.h>
+#include <bitmap_dds.h>
+#include "glcontext.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+// Encodes a 256x256 BC1 texture with a full mipmap chain, distinct for every seed
+static std::vector<char> makeTexture(int seed) {
+	std::vector<unsigned char> rgba(256 * 256 * 4);
+	for (size_t i = 0; i < rgba.size(); i++) rgba[i] = (unsigned char) (i * seed);
+	size_t size;
+	char *data = dds_encode(&rgba[0], 256, 256, GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, DDS_MIPMAPS, &size, 0);
+	std::vector<char> file(data, data + size);
+	free(data);
+	return file;
+}
+
+static void writeFile(const char *path, const std::vector<char> &data) {
+	FILE *file = fopen(path, "wb");
+	fwrite(&data[0], 1, data.size(), file);
+	fclose(file);
+}
+
+// 32768 + 8192 + 2048 + 512 + 128 + 32 + 8 + 8 + 8 bytes
+static const size_t TEXTURE_BYTES = 43704, TAIL_BYTES = 2048 + 512 + 128 + 32 + 8 + 8 + 8;
+
+TEST(TexCache, SharesByPathAndContent) {
+	REQUIRE_GL_CONTEXT();
+	std::vector<char> data = makeTexture(1);
+	writeFile("texcache_a.dds", data);
+	writeFile("texcache_b.dds", data);
+
+	struct texcache *cache = create_texcache(0);
+	struct cached_texture *texture = texcache_load_memory(cache, &data[0], data.size(), 0);
+	ASSERT_TRUE(texture != 0);
+	EXPECT_EQ(TEXTURE_BYTES, texture->bytes);
+	EXPECT_EQ(texture, texcache_load_memory(cache, &data[0], data.size(), 0));
+	EXPECT_EQ(texture, texcache_load_file(cache, "texcache_a.dds", 0));
+	EXPECT_EQ(texture, texcache_load_file(cache, "texcache_b.dds", 0));
+	EXPECT_EQ(TEXTURE_BYTES, texcache_resident(cache));
+
+	struct cached_texture *flipped = texcache_load_file(cache, "texcache_a.dds", DDS_FLIP_UVS);
+	ASSERT_TRUE(flipped != 0);
+	EXPECT_NE(texture, flipped);
+	EXPECT_EQ(2 * TEXTURE_BYTES, texcache_resident(cache));
+	destroy_texcache(cache);
+	remove("texcache_a.dds");
+	remove("texcache_b.dds");
+}
+
+TEST(TexCache, EvictsUnusedTexturesThenLargestLevels) {
+	REQUIRE_GL_CONTEXT();
+	std::vector<char> first = makeTexture(1), second = makeTexture(3);
+	writeFile("texcache_c.dds", second);
+
+	struct texcache *cache = create_texcache(TEXTURE_BYTES * 3 / 2);
+	struct cached_texture *texture = texcache_load_memory(cache, &first[0], first.size(), 0);
+	ASSERT_TRUE(texture != 0);
+	texcache_release(cache, texture);
+	EXPECT_EQ(TEXTURE_BYTES, texcache_resident(cache)); // Kept while within budget
+
+	texture = texcache_load_file(cache, "texcache_c.dds", 0);
+	ASSERT_TRUE(texture != 0);
+	EXPECT_EQ(TEXTURE_BYTES, texcache_resident(cache)); // The unused texture made room
+
+	// Only the mip tail of a texture in use survives
+	texcache_set_budget(cache, 4096);
+	EXPECT_EQ(TAIL_BYTES, texture->bytes);
+	EXPECT_EQ(TAIL_BYTES, texcache_resident(cache));
+	GLint baseLevel;
+	glBindTexture(GL_TEXTURE_2D, texture->texture);
+	glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, &baseLevel);
+	EXPECT_EQ(2, baseLevel);
+
+	// Touching brings the levels back from the file once they fit
+	texcache_set_budget(cache, 0);
+	texcache_touch(cache, texture);
+	EXPECT_EQ(TEXTURE_BYTES, texture->bytes);
+	glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, &baseLevel);
+	EXPECT_EQ(0, baseLevel);
+	std::vector<char> pixels(32768);
+	glGetCompressedTexImage(GL_TEXTURE_2D, 0, &pixels[0]);
+	EXPECT_EQ(0, memcmp(&second[128], &pixels[0], pixels.size()));
+	EXPECT_EQ((GLenum) GL_NO_ERROR, glGetError());
+
+	destroy_texcache(cache);
+	remove("texcache_c.dds");
+}
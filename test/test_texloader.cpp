@@ -0,0 +1,247 @@
+#include <gtest/gtest.h>
+#include <texloader.h>
+#include <bitmap_dds.h>
+#include <glh.h>
+#include "glcontext.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+// 32768 + 8192 + 2048 + 512 + 128 + 32 + 8 + 8 + 8 bytes
+static const size_t TEXTURE_BYTES = 43704, TAIL_BYTES = 2048 + 512 + 128 + 32 + 8 + 8 + 8;
+
+// Encodes a 256x256 BC1 texture with a full mipmap chain, distinct for every seed
+static std::vector<char> makeTexture(int seed) {
+	std::vector<unsigned char> rgba(256 * 256 * 4);
+	for (size_t i = 0; i < rgba.size(); i++) rgba[i] = (unsigned char) (i * seed);
+	size_t size;
+	char *data = dds_encode(&rgba[0], 256, 256, GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, DDS_MIPMAPS, &size, 0);
+	std::vector<char> file(data, data + size);
+	free(data);
+	return file;
+}
+
+// Builds a DX10 array of 256x256 BC1 layers with a full mipmap chain
+static std::vector<char> makeArray(uint32_t layers) {
+	std::vector<char> data(148 + layers * TEXTURE_BYTES);
+	uint32_t header[] = { 0x20534444, 124, 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000, 256, 256, 0, 0, 9 };
+	memcpy(&data[0], header, sizeof(header));
+	uint32_t pixelFormat[] = { 32, 0x4, 0x30315844 }; // DDPF_FOURCC "DX10"
+	memcpy(&data[76], pixelFormat, sizeof(pixelFormat));
+	uint32_t dx10[] = { 71, 3, 0, layers, 0 }; // DXGI_FORMAT_BC1_UNORM, DDS_DIMENSION_TEXTURE2D
+	memcpy(&data[128], dx10, sizeof(dx10));
+	for (size_t i = 148; i < data.size(); i++) data[i] = (char) (i * 31);
+	return data;
+}
+
+static void writeFile(const char *path, const std::vector<char> &data) {
+	FILE *file = fopen(path, "wb");
+	fwrite(&data[0], 1, data.size(), file);
+	fclose(file);
+}
+
+static GLint getBaseLevel(const struct streamed_texture *texture) {
+	GLint baseLevel;
+	glBindTexture(GL_TEXTURE_2D, texture->texture);
+	glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, &baseLevel);
+	return baseLevel;
+}
+
+class TexLoader : public ::testing::Test {
+protected:
+	struct threadpool *pool;
+	GLuint placeholder;
+	struct texloader *loader;
+
+	void SetUp() {
+		pool = 0;
+		loader = 0;
+		if (!createHeadlessContext()) return;
+		glh_reset_state();
+		glGenTextures(1, &placeholder);
+		pool = create_threadpool(2);
+		loader = create_texloader(pool, placeholder);
+	}
+
+	void TearDown() {
+		if (loader == 0) return;
+		destroy_texloader(loader);
+		destroy_threadpool(pool);
+		glDeleteTextures(1, &placeholder);
+	}
+};
+
+TEST_F(TexLoader, HandsOutThePlaceholderUntilUploaded) {
+	REQUIRE_GL_CONTEXT();
+	std::vector<char> data = makeTexture(1);
+	writeFile("texloader_a.dds", data);
+
+	struct streamed_texture *texture = texloader_load(loader, "texloader_a.dds", 0);
+	ASSERT_TRUE(texture != 0);
+	EXPECT_EQ(TEXTURE_PENDING, texture->status);
+	EXPECT_EQ(placeholder, texture->texture);
+
+	// Reads finish on the workers, but only an update uploads them
+	threadpool_wait(pool);
+	EXPECT_EQ(TEXTURE_PENDING, texture->status);
+	EXPECT_EQ(1, texloader_update(loader, 0, 0));
+	EXPECT_EQ(TEXTURE_READY, texture->status);
+	EXPECT_NE(placeholder, texture->texture);
+	EXPECT_EQ((GLenum) GL_TEXTURE_2D, texture->target);
+	EXPECT_EQ(256, texture->width);
+	EXPECT_EQ(256, texture->height);
+	EXPECT_EQ(TEXTURE_BYTES, texloader_resident(loader));
+
+	std::vector<char> pixels(32768);
+	glBindTexture(GL_TEXTURE_2D, texture->texture);
+	glGetCompressedTexImage(GL_TEXTURE_2D, 0, &pixels[0]);
+	EXPECT_EQ(0, memcmp(&data[128], &pixels[0], pixels.size()));
+	EXPECT_EQ(0, texloader_update(loader, 0, 0));
+
+	texloader_release(loader, texture);
+	EXPECT_EQ(0u, texloader_resident(loader));
+	EXPECT_EQ((GLenum) GL_NO_ERROR, glGetError());
+	remove("texloader_a.dds");
+}
+
+TEST_F(TexLoader, UploadsWithinTheByteBudget) {
+	REQUIRE_GL_CONTEXT();
+	writeFile("texloader_b.dds", makeTexture(3));
+	struct streamed_texture *textures[3];
+	for (int i = 0; i < 3; i++) ASSERT_TRUE((textures[i] = texloader_load(loader, "texloader_b.dds", 0)) != 0);
+	threadpool_wait(pool);
+
+	// One upload is made even if it exceeds the budget
+	EXPECT_EQ(1, texloader_update(loader, 1, 0));
+	EXPECT_EQ(TEXTURE_BYTES, texloader_resident(loader));
+	EXPECT_EQ(1, texloader_update(loader, 3 * TEXTURE_BYTES / 2, 0));
+	EXPECT_EQ(2 * TEXTURE_BYTES, texloader_resident(loader));
+	EXPECT_EQ(1, texloader_update(loader, 0, 0));
+	for (int i = 0; i < 3; i++) EXPECT_EQ(TEXTURE_READY, textures[i]->status);
+	EXPECT_EQ(3 * TEXTURE_BYTES, texloader_resident(loader));
+	remove("texloader_b.dds");
+}
+
+TEST_F(TexLoader, FailsOnMissingAndCorruptFiles) {
+	REQUIRE_GL_CONTEXT();
+	std::vector<char> data = makeTexture(5);
+	data.resize(data.size() / 2);
+	writeFile("texloader_c.dds", data);
+	writeFile("texloader_d.dds", std::vector<char>(256, 'x'));
+
+	struct streamed_texture *textures[] = {
+		texloader_load(loader, "texloader_missing.dds", 0),
+		texloader_load(loader, "texloader_c.dds", 0),
+		texloader_load(loader, "texloader_d.dds", 0)
+	};
+	threadpool_wait(pool);
+	EXPECT_EQ(3, texloader_update(loader, 0, 0));
+	for (int i = 0; i < 3; i++) {
+		ASSERT_TRUE(textures[i] != 0);
+		EXPECT_EQ(TEXTURE_FAILED, textures[i]->status);
+		EXPECT_EQ(placeholder, textures[i]->texture);
+	}
+	EXPECT_EQ(0u, texloader_resident(loader));
+	texloader_release(loader, textures[0]);
+	remove("texloader_c.dds");
+	remove("texloader_d.dds");
+}
+
+TEST_F(TexLoader, ReleasesPendingLoads) {
+	REQUIRE_GL_CONTEXT();
+	writeFile("texloader_e.dds", makeTexture(7));
+	struct streamed_texture *released = texloader_load(loader, "texloader_e.dds", 0),
+		*kept = texloader_load(loader, "texloader_e.dds", 0);
+	ASSERT_TRUE(released != 0 && kept != 0);
+	texloader_release(loader, released);
+
+	// The read completes, but is dropped instead of uploaded
+	threadpool_wait(pool);
+	EXPECT_EQ(1, texloader_update(loader, 0, 0));
+	EXPECT_EQ(TEXTURE_READY, kept->status);
+	EXPECT_EQ(TEXTURE_BYTES, texloader_resident(loader));
+
+	// A load released before any update is freed along with the loader
+	texloader_release(loader, texloader_load(loader, "texloader_e.dds", 0));
+	remove("texloader_e.dds");
+}
+
+TEST_F(TexLoader, StreamsLevelsInAndEvictsThem) {
+	REQUIRE_GL_CONTEXT();
+	std::vector<char> data = makeTexture(9);
+	writeFile("texloader_f.dds", data);
+	struct streamed_texture *texture = texloader_load(loader, "texloader_f.dds", TEXLOADER_PROGRESSIVE);
+	ASSERT_TRUE(texture != 0);
+	threadpool_wait(pool);
+
+	// The 64x64 mip tail comes first, with the levels clamped to it
+	EXPECT_EQ(1, texloader_update(loader, TAIL_BYTES, 0));
+	EXPECT_EQ(TEXTURE_READY, texture->status);
+	EXPECT_EQ(2, getBaseLevel(texture));
+	EXPECT_EQ(TAIL_BYTES, texloader_resident(loader));
+
+	// A larger level streams in per update
+	EXPECT_EQ(0, texloader_update(loader, 8192, 0));
+	EXPECT_EQ(1, getBaseLevel(texture));
+	EXPECT_EQ(TAIL_BYTES + 8192, texloader_resident(loader));
+	EXPECT_EQ(0, texloader_update(loader, 8192, 0));
+	EXPECT_EQ(0, getBaseLevel(texture));
+	EXPECT_EQ(TEXTURE_BYTES, texloader_resident(loader));
+
+	// Unused levels are evicted down to the tail when over budget
+	texloader_set_budget(loader, 4096);
+	texloader_update(loader, 0, 0);
+	EXPECT_EQ(2, getBaseLevel(texture));
+	EXPECT_EQ(TAIL_BYTES, texloader_resident(loader));
+
+	// Touching rereads the file to restore them
+	texloader_set_budget(loader, 0);
+	texloader_touch(loader, texture);
+	threadpool_wait(pool);
+	EXPECT_EQ(0, texloader_update(loader, 0, 0));
+	EXPECT_EQ(0, getBaseLevel(texture));
+	EXPECT_EQ(TEXTURE_BYTES, texloader_resident(loader));
+	std::vector<char> pixels(32768);
+	glGetCompressedTexImage(GL_TEXTURE_2D, 0, &pixels[0]);
+	EXPECT_EQ(0, memcmp(&data[128], &pixels[0], pixels.size()));
+	EXPECT_EQ((GLenum) GL_NO_ERROR, glGetError());
+	remove("texloader_f.dds");
+}
+
+TEST_F(TexLoader, ChargesOnlyTheTailsAgainstTheBudget) {
+	REQUIRE_GL_CONTEXT();
+	writeFile("texloader_g.dds", makeTexture(11));
+	struct streamed_texture *first = texloader_load(loader, "texloader_g.dds", TEXLOADER_PROGRESSIVE),
+		*second = texloader_load(loader, "texloader_g.dds", TEXLOADER_PROGRESSIVE);
+	ASSERT_TRUE(first != 0 && second != 0);
+	threadpool_wait(pool);
+
+	EXPECT_EQ(2, texloader_update(loader, 2 * TAIL_BYTES, 0));
+	EXPECT_EQ(TEXTURE_READY, first->status);
+	EXPECT_EQ(TEXTURE_READY, second->status);
+	EXPECT_EQ(2 * TAIL_BYTES, texloader_resident(loader));
+	remove("texloader_g.dds");
+}
+
+TEST_F(TexLoader, UploadsArraysWhole) {
+	REQUIRE_GL_CONTEXT();
+	writeFile("texloader_h.dds", makeArray(3));
+	struct streamed_texture *texture = texloader_load(loader, "texloader_h.dds", TEXLOADER_PROGRESSIVE);
+	ASSERT_TRUE(texture != 0);
+	threadpool_wait(pool);
+	EXPECT_EQ(1, texloader_update(loader, 0, 0));
+	EXPECT_EQ(TEXTURE_READY, texture->status);
+	EXPECT_EQ((GLenum) GL_TEXTURE_2D_ARRAY, texture->target);
+	EXPECT_EQ(3 * TEXTURE_BYTES, texloader_resident(loader));
+
+	// Arrays have no levels to evict or stream back in
+	texloader_set_budget(loader, 4096);
+	texloader_update(loader, 0, 0);
+	EXPECT_EQ(3 * TEXTURE_BYTES, texloader_resident(loader));
+	texloader_touch(loader, texture);
+	threadpool_wait(pool);
+	texloader_update(loader, 0, 0);
+	EXPECT_EQ(3 * TEXTURE_BYTES, texloader_resident(loader));
+	EXPECT_EQ((GLenum) GL_NO_ERROR, glGetError());
+	remove("texloader_h.dds");
+}
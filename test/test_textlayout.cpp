@@ -0,0 +1,106 @@
+#include <gtest/gtest.h>
+#include <textlayout.h>
+#include "bmfontdata.h"
+#include <string>
+
+static std::string getLine(struct text_document *document, unsigned int paragraph, unsigned int line) {
+	size_t length;
+	const char *text = text_document_line(document, paragraph, line, &length);
+	return text != 0 ? std::string(text, length) : "<none>";
+}
+
+TEST(TextLayout, WrapsGreedily) {
+	std::vector<char> data = makeFont();
+	struct bmfont *font = create_bmfont(&data[0]);
+	const char *text = "The quick brown fox jumps over the lazy dog";
+	float width = bmfont_measure(font, "The quick", 9);
+	struct text_document *document = create_text_document(font, width);
+	ASSERT_TRUE(text_document_append(document, text, strlen(text)));
+	EXPECT_EQ(1u, text_document_paragraphs(document));
+
+	// Every line is as long as fits, and no longer
+	std::string joined;
+	for (unsigned int line = 0; line < text_document_lines(document); line++) {
+		std::string s = getLine(document, 0, line);
+		EXPECT_LE(bmfont_measure(font, s.data(), s.size()), width) << s;
+		if (line + 1 < text_document_lines(document)) {
+			std::string longer = s + " " + getLine(document, 0, line + 1).substr(0, getLine(document, 0, line + 1).find(' '));
+			EXPECT_GT(bmfont_measure(font, longer.data(), longer.size()), width) << longer;
+		}
+		joined += (line > 0 ? " " : "") + s;
+	}
+	EXPECT_EQ("The quick", getLine(document, 0, 0));
+	EXPECT_EQ(text, joined);
+
+	// Widening to fit everything makes a single line, and words wider than the line get their own
+	text_document_set_width(document, 10000);
+	EXPECT_EQ(1u, text_document_lines(document));
+	EXPECT_EQ(text, getLine(document, 0, 0));
+	text_document_set_width(document, 1);
+	EXPECT_EQ(9u, text_document_lines(document));
+	EXPECT_EQ("quick", getLine(document, 0, 1));
+	destroy_text_document(document);
+	destroy_bmfont(font);
+}
+
+TEST(TextLayout, KeepsWordGapsWhileGrowing) {
+	std::vector<char> data = makeFont();
+	struct bmfont *font = create_bmfont(&data[0]);
+	// More words than the first allocation holds, kerned across the spaces
+	std::string text;
+	for (int i = 0; i < 40; i++) text += i > 0 ? " AV" : "AV";
+	struct text_document *document = create_text_document(font, 10000);
+	ASSERT_TRUE(text_document_append(document, text.data(), text.size()));
+	EXPECT_EQ(1u, text_document_lines(document));
+	EXPECT_EQ(text, getLine(document, 0, 0));
+
+	// Wrapping at the width of every prefix breaks exactly where measuring the text does
+	for (size_t words = 1; words < 40; words++) {
+		std::string prefix = text.substr(0, 3 * words - 1);
+		text_document_set_width(document, bmfont_measure(font, prefix.data(), prefix.size()));
+		EXPECT_EQ(prefix, getLine(document, 0, 0)) << words;
+	}
+	destroy_text_document(document);
+	destroy_bmfont(font);
+}
+
+TEST(TextLayout, FindsLinesOfEditedParagraphs) {
+	std::vector<char> data = makeFont();
+	struct bmfont *font = create_bmfont(&data[0]);
+	struct text_document *document = create_text_document(font, bmfont_measure(font, "aaaa", 4));
+	for (int i = 0; i < 1000; i++) {
+		// Paragraphs of 1 to 3 lines
+		std::string text = i % 3 == 0 ? "aaaa" : i % 3 == 1 ? "aaaa bbbb" : "aaaa bbbb\ncccc dddd eeee";
+		ASSERT_TRUE(text_document_append(document, text.data(), text.size()));
+	}
+	ASSERT_EQ(1000u / 3 * 4 + 1, text_document_paragraphs(document));
+
+	// Walk every line through the tree
+	unsigned int lines = text_document_lines(document), paragraph = 0, line = 0;
+	for (unsigned int i = 0; i < lines; i++) {
+		unsigned int p, l;
+		ASSERT_TRUE(text_document_line_at(document, i * font->lineHeight + 0.5f, &p, &l));
+		ASSERT_EQ(paragraph, p) << i;
+		ASSERT_EQ(line, l) << i;
+		size_t length;
+		if (text_document_line(document, paragraph, line + 1, &length) != 0) line++;
+		else {
+			paragraph++;
+			line = 0;
+		}
+	}
+	unsigned int p, l;
+	EXPECT_FALSE(text_document_line_at(document, lines * font->lineHeight, &p, &l));
+	EXPECT_FALSE(text_document_line_at(document, -1, &p, &l));
+
+	// Editing a paragraph of two lines into six moves the lines after it
+	unsigned int first = text_document_first_line(document, 500);
+	ASSERT_TRUE(text_document_set(document, 10, "aaaa bbbb cccc dddd eeee ffff", 29));
+	EXPECT_EQ(first + 4, text_document_first_line(document, 500));
+	EXPECT_EQ(lines + 4, text_document_lines(document));
+	ASSERT_TRUE(text_document_line_at(document, text_document_first_line(document, 500) * font->lineHeight, &p, &l));
+	EXPECT_EQ(500u, p);
+	EXPECT_EQ(0u, l);
+	destroy_text_document(document);
+	destroy_bmfont(font);
+}
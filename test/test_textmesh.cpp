@@ -0,0 +1,163 @@
+#include <gtest/gtest.h>
+#include <textmesh.h>
+#include "bmfontdata.h"
+#include "glcontext.h"
+
+static const char *vertexShader = GLSL(330,
+	uniform vec2 viewport;
+	in vec2 position;
+	in vec2 texCoord;
+	out vec2 uv;
+	void main() {
+		uv = texCoord;
+		gl_Position = vec4(position.x / viewport.x * 2 - 1, 1 - position.y / viewport.y * 2, 0, 1);
+	});
+
+static const char *fragmentShader = GLSL(330,
+	uniform sampler2D page;
+	in vec2 uv;
+	out vec4 color;
+	void main() {
+		color = texture(page, uv);
+	});
+
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__)
+#define FAILING_REALLOC
+extern "C" void *__libc_realloc(void *pointer, size_t size);
+static size_t failingSize = 0;
+
+// Fails reallocations of at least failingSize bytes while it is non-zero
+extern "C" void *realloc(void *pointer, size_t size) {
+	return failingSize != 0 && size >= failingSize ? 0 : __libc_realloc(pointer, size);
+}
+#endif
+
+/** Renders into a framebuffer with a solid color texture for every font page. */
+class TextMeshTest : public ::testing::Test {
+protected:
+	GLuint program, framebuffer, renderbuffer, vertexArray, textures[2];
+	GLint position, texCoord;
+
+	bool setUpGL() {
+		if (!createHeadlessContext()) return false;
+		program = create_program(vertexShader, fragmentShader);
+		glUseProgram(program);
+		glUniform2f(glGetUniformLocation(program, "viewport"), 64, 32);
+		position = glGetAttribLocation(program, "position");
+		texCoord = glGetAttribLocation(program, "texCoord");
+		glGenVertexArrays(1, &vertexArray);
+		glBindVertexArray(vertexArray);
+
+		glGenRenderbuffers(1, &renderbuffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, renderbuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, 64, 32);
+		glGenFramebuffers(1, &framebuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffer);
+		glViewport(0, 0, 64, 32);
+		glClearColor(0, 0, 0, 0);
+		glClear(GL_COLOR_BUFFER_BIT);
+
+		const unsigned char colors[][4] = { { 255, 0, 0, 255 }, { 0, 255, 0, 255 } };
+		glGenTextures(2, textures);
+		for (int i = 0; i < 2; i++) {
+			glBindTexture(GL_TEXTURE_2D, textures[i]);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, colors[i]);
+		}
+		glh_reset_state();
+		return program != 0;
+	}
+
+	void TearDown() {
+		if (!createHeadlessContext()) return;
+		glDeleteTextures(2, textures);
+		glDeleteFramebuffers(1, &framebuffer);
+		glDeleteRenderbuffers(1, &renderbuffer);
+		glDeleteVertexArrays(1, &vertexArray);
+		glDeleteProgram(program);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	}
+
+	// Returns the pixel at a position measured from the top left
+	uint32_t pixel(int x, int y) {
+		uint32_t color;
+		glReadPixels(x, 31 - y, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, &color);
+		return color;
+	}
+};
+
+TEST_F(TextMeshTest, DrawsEveryPage) {
+	if (!setUpGL()) return;
+	std::vector<char> data = makeFont();
+	struct bmfont *font = create_bmfont(&data[0]);
+	struct text_mesh *mesh = create_text_mesh(font);
+	ASSERT_TRUE(mesh != 0);
+
+	// A is on the first page and the CJK character on the second
+	const char *text = "A\xE4\xB8\xAD" "A";
+	ASSERT_TRUE(text_mesh_set(mesh, text, strlen(text), 1, 0));
+	EXPECT_TRUE(mesh->dirty);
+	text_mesh_draw(mesh, textures, position, texCoord);
+	EXPECT_FALSE(mesh->dirty);
+	EXPECT_EQ(0u, mesh->pageStarts[0]);
+	EXPECT_EQ(2u, mesh->pageStarts[1]);
+	EXPECT_EQ(3u, mesh->pageStarts[2]);
+	EXPECT_EQ(0xFF0000FFu, pixel(4, 8));
+	EXPECT_EQ(0xFF00FF00u, pixel(13, 8));
+	EXPECT_EQ(0xFF0000FFu, pixel(24, 8));
+	EXPECT_EQ(0u, pixel(4, 30));
+
+	// Setting the same text keeps the buffers
+	ASSERT_TRUE(text_mesh_set(mesh, text, strlen(text), 1, 0));
+	EXPECT_FALSE(mesh->dirty);
+	ASSERT_TRUE(text_mesh_set(mesh, text, strlen(text), 1, 1));
+	EXPECT_TRUE(mesh->dirty);
+	EXPECT_EQ((GLenum) GL_NO_ERROR, glGetError());
+	destroy_text_mesh(mesh);
+	destroy_bmfont(font);
+}
+
+TEST_F(TextMeshTest, BatchesTextOfAFrame) {
+	if (!setUpGL()) return;
+	std::vector<char> data = makeFont();
+	struct bmfont *font = create_bmfont(&data[0]);
+	struct text_mesh *batch = create_text_batch(font);
+	ASSERT_TRUE(batch != 0);
+
+	ASSERT_TRUE(text_batch_add(batch, "A", 1, 1, 0));
+	ASSERT_TRUE(text_batch_add(batch, "\xE4\xB8\xAD", 3, 1, 16));
+	text_mesh_draw(batch, textures, position, texCoord);
+	EXPECT_EQ(0xFF0000FFu, pixel(4, 8));
+	EXPECT_EQ(0xFF00FF00u, pixel(4, 24));
+	EXPECT_EQ(0u, batch->quads->count);
+
+	// The next frame starts empty
+	glClear(GL_COLOR_BUFFER_BIT);
+	text_mesh_draw(batch, textures, position, texCoord);
+	EXPECT_EQ(0u, pixel(4, 8));
+	EXPECT_EQ((GLenum) GL_NO_ERROR, glGetError());
+	destroy_text_mesh(batch);
+	destroy_bmfont(font);
+}
+
+#ifdef FAILING_REALLOC
+TEST_F(TextMeshTest, LaysOutAgainAfterFailing) {
+	if (!setUpGL()) return;
+	std::vector<char> data = makeFont();
+	struct bmfont *font = create_bmfont(&data[0]);
+	struct text_mesh *mesh = create_text_mesh(font);
+	ASSERT_TRUE(mesh != 0);
+
+	// The text itself fits, but not the quads laid out from it
+	std::string text(4096, 'A');
+	failingSize = text.size() + 2;
+	EXPECT_FALSE(text_mesh_set(mesh, text.data(), text.size(), 0, 0));
+	failingSize = 0;
+	ASSERT_TRUE(text_mesh_set(mesh, text.data(), text.size(), 0, 0));
+	EXPECT_EQ(text.size(), mesh->quads->count);
+	destroy_text_mesh(mesh);
+	destroy_bmfont(font);
+}
+#endif
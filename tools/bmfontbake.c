@@ -0,0 +1,61 @@
+/** Bakes a binary AngelCode BMFont file into a runtime blob, for use as an offline font build step.
+	Usage: bmfontbake <input file> <output file>
+	The blob is loaded in place with bmfont_open() on machines of the same byte order.
+	@file bmfontbake.c */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "bmfont.h"
+
+/** Reads a file followed by a zero byte, which ends the blocks of a font file. */
+static char *readFile(const char *path, size_t *size) {
+	FILE *file = fopen(path, "rb");
+	if (file == 0) return 0;
+	char *data = 0;
+	long length;
+	if (fseek(file, 0, SEEK_END) != 0 || (length = ftell(file)) < 0 || fseek(file, 0, SEEK_SET) != 0) goto close;
+	if ((data = malloc(length + 1)) == 0) goto close;
+	if (fread(data, 1, length, file) != (size_t) length) {
+		free(data);
+		data = 0;
+		goto close;
+	}
+	data[length] = '\0';
+	*size = length + 1;
+close:
+	fclose(file);
+	return data;
+}
+
+int main(int argc, char *argv[]) {
+	if (argc != 3) {
+		fprintf(stderr, "Usage: %s <input file> <output file>\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	size_t size;
+	char *data = readFile(argv[1], &size);
+	if (data == 0) {
+		fprintf(stderr, "%s: cannot read file\n", argv[1]);
+		return EXIT_FAILURE;
+	}
+	struct bmfont *font = bmfont_open(data, size);
+	if (font == 0) {
+		fprintf(stderr, "%s: not a binary BMFont file\n", argv[1]);
+		free(data);
+		return EXIT_FAILURE;
+	}
+
+	int result = 0;
+	char *baked = bmfont_bake(font, &size);
+	FILE *file = baked != 0 ? fopen(argv[2], "wb") : 0;
+	if (file != 0) {
+		result = fwrite(baked, 1, size, file) == size;
+		result &= fclose(file) == 0;
+	}
+	if (!result) fprintf(stderr, "%s: cannot write file\n", argv[2]);
+	else printf("%s -> %s (%u glyphs, %lu bytes)\n", argv[1], argv[2], font->glyphCount - 1, (unsigned long) size);
+	free(baked);
+	destroy_bmfont(font);
+	free(data);
+	return result ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,131 @@
+/** Block compresses every uncompressed RGBA DDS file of a directory, for use as an offline texture build step.
+	Usage: ddsconvert [-bc1 | -bc3 | -bc5] [-quality] [-nomips] <input directory> <output directory>
+	Without a format, images with transparency become BC3 and the rest BC1.
+	@file ddsconvert.c */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bitmap_dds.h"
+#include "threadpool.h"
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#endif
+
+/** Converts a single file, returning \c 0 on failure. */
+static int convert(const char *input, const char *output, GLenum internalformat, int flags, struct threadpool *pool) {
+	size_t size;
+	char *data = dds_read_file(input, &size);
+	if (data == 0) {
+		fprintf(stderr, "%s: cannot read file\n", input);
+		return 0;
+	}
+
+	int result = 0;
+	struct dds_image image;
+	if (!dds_parse(data, size, &image) || image.compressed || image.target != GL_TEXTURE_2D || image.bitsPerPixel != 32
+		|| image.type != GL_UNSIGNED_BYTE || (image.format != GL_RGBA && image.format != GL_BGRA)) {
+		fprintf(stderr, "%s: not an uncompressed 32-bit RGBA image\n", input);
+		goto done;
+	}
+
+	// Only the top level is read, the mipmaps are filtered anew
+	unsigned char *rgba = (unsigned char *) data + image.mipmaps[0].offset;
+	size_t pixels = (size_t) image.width * image.height;
+	int transparent = 0;
+	for (size_t i = 0; i < pixels; i++) {
+		if (image.format == GL_BGRA) {
+			unsigned char b = rgba[4 * i];
+			rgba[4 * i] = rgba[4 * i + 2];
+			rgba[4 * i + 2] = b;
+		}
+		transparent |= rgba[4 * i + 3] != 255;
+	}
+	if (internalformat == 0) internalformat = transparent ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+
+	char *encoded = dds_encode(rgba, image.width, image.height, internalformat, flags, &size, pool);
+	FILE *file = encoded != 0 ? fopen(output, "wb") : 0;
+	if (file != 0) {
+		result = fwrite(encoded, 1, size, file) == size;
+		result &= fclose(file) == 0;
+	}
+	if (!result) fprintf(stderr, "%s: cannot write file\n", output);
+	else printf("%s -> %s\n", input, output);
+	free(encoded);
+done:
+	free(data);
+	return result;
+}
+
+/** Returns non-zero if the file name ends in .dds, ignoring case. */
+static int isDDS(const char *name) {
+	size_t length = strlen(name);
+	if (length < 4) return 0;
+	const char *extension = name + length - 4;
+	return extension[0] == '.' && (extension[1] | 0x20) == 'd' && (extension[2] | 0x20) == 'd' && (extension[3] | 0x20) == 's';
+}
+
+static int convertFile(const char *inputDir, const char *outputDir, const char *name, GLenum internalformat, int flags, struct threadpool *pool) {
+	char input[4096], output[4096];
+	if (snprintf(input, sizeof input, "%s/%s", inputDir, name) >= (int) sizeof input
+		|| snprintf(output, sizeof output, "%s/%s", outputDir, name) >= (int) sizeof output) {
+		fprintf(stderr, "%s: path too long\n", name);
+		return 0;
+	}
+	return convert(input, output, internalformat, flags, pool);
+}
+
+int main(int argc, char **argv) {
+	GLenum internalformat = 0;
+	int flags = DDS_MIPMAPS, i;
+	for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+		if (strcmp(argv[i], "-bc1") == 0) internalformat = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+		else if (strcmp(argv[i], "-bc3") == 0) internalformat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+		else if (strcmp(argv[i], "-bc5") == 0) internalformat = GL_COMPRESSED_RG_RGTC2;
+		else if (strcmp(argv[i], "-quality") == 0) flags |= DDS_HIGH_QUALITY;
+		else if (strcmp(argv[i], "-nomips") == 0) flags &= ~DDS_MIPMAPS;
+		else break;
+	}
+	if (argc - i != 2) {
+		fprintf(stderr, "Usage: %s [-bc1 | -bc3 | -bc5] [-quality] [-nomips] <input directory> <output directory>\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	const char *inputDir = argv[i], *outputDir = argv[i + 1];
+
+	struct threadpool *pool = create_threadpool(0);
+	int converted = 0, failed = 0;
+#ifdef _WIN32
+	char pattern[4096];
+	snprintf(pattern, sizeof pattern, "%s\\*.dds", inputDir);
+	WIN32_FIND_DATAA entry;
+	HANDLE find = FindFirstFileA(pattern, &entry);
+	if (find != INVALID_HANDLE_VALUE) {
+		do {
+			if (entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY || !isDDS(entry.cFileName)) continue;
+			if (convertFile(inputDir, outputDir, entry.cFileName, internalformat, flags, pool)) converted++;
+			else failed++;
+		} while (FindNextFileA(find, &entry));
+		FindClose(find);
+	}
+#else
+	DIR *dir = opendir(inputDir);
+	if (dir == 0) {
+		fprintf(stderr, "%s: cannot open directory\n", inputDir);
+		destroy_threadpool(pool);
+		return EXIT_FAILURE;
+	}
+	struct dirent *entry;
+	while ((entry = readdir(dir)) != 0) {
+		if (!isDDS(entry->d_name)) continue;
+		if (convertFile(inputDir, outputDir, entry->d_name, internalformat, flags, pool)) converted++;
+		else failed++;
+	}
+	closedir(dir);
+#endif
+	destroy_threadpool(pool);
+
+	printf("%d converted, %d failed\n", converted, failed);
+	return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}